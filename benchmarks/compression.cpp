@@ -0,0 +1,194 @@
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <iostream>
+#include <string_view>
+
+#include "ce2103/network.hpp"
+
+#include "ce2103/mm/client.hpp"
+
+namespace
+{
+	constexpr std::size_t PAGE = 4096;
+
+	//! Fills pages with contents of the given kind
+	std::string make_pages(std::string_view kind, std::size_t pages)
+	{
+		std::mt19937_64 generator{42};
+		std::string contents(pages * PAGE, '\0');
+
+		if(kind == "strings")
+		{
+			// Words drawn from a small vocabulary, as in managed strings
+			const char* words[] = {"remote ", "memory ", "pointer ", "object ", "page ", "the ", "of ", "a "};
+			for(std::size_t at = 0; at < contents.size();)
+			{
+				const char* word = words[generator() % (sizeof words / sizeof words[0])];
+				for(; *word != '\0' && at < contents.size(); ++word)
+				{
+					contents[at++] = *word;
+				}
+			}
+		} else if(kind == "structs")
+		{
+			// Records of a heap pointer, a small count and a double
+			struct record
+			{
+				std::uint64_t next;
+				std::uint32_t count;
+				std::uint32_t flags;
+				double        value;
+			};
+
+			for(std::size_t at = 0; at + sizeof(record) <= contents.size(); at += sizeof(record))
+			{
+				record item{0x7f3a'0000'0000 + generator() % 4096 * 32, static_cast<std::uint32_t>(generator() % 100),
+				            0, static_cast<double>(generator() % 1000) / 4};
+
+				std::memcpy(&contents[at], &item, sizeof item);
+			}
+		} else if(kind == "random")
+		{
+			for(char& byte : contents)
+			{
+				byte = static_cast<char>(generator());
+			}
+		}
+
+		return contents;
+	}
+}
+
+/* Measures overwrite() and fetch_many() of 4KiB objects with and without
+ * compressed contents, for pages of zeros, of text, of small structures
+ * and of random bytes. Besides throughput, reports the compression ratio
+ * and the compression and decompression cost per page that the client
+ * measured. Requires MM_SERVER and MM_PSK, but talks to the server through
+ * client sessions of its own.
+ *
+ * Usage: bench_compression [objects] [rounds]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::socket;
+	using ce2103::ip_endpoint;
+	using ce2103::mm::client_session;
+
+	const char* server = std::getenv("MM_SERVER");
+	const char* secret = std::getenv("MM_PSK");
+
+	std::optional<ip_endpoint> endpoint;
+	if(server == nullptr || secret == nullptr || !(endpoint = ip_endpoint::try_from(server)))
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t objects = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+	std::size_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20;
+
+	auto seconds_since = [](auto start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	std::cout << "contents\tcompressed\toverwrite MiB/s\tfetch MiB/s\tratio\tpack us/page\tunpack us/page\n";
+	for(const char* kind : {"zeros", "strings", "structs", "random"})
+	{
+		auto contents = make_pages(kind, objects);
+		for(bool compression : {false, true})
+		{
+			socket client_socket;
+			if(!client_socket.connect(*endpoint))
+			{
+				std::cerr << "Connection to server failed\n";
+				return 1;
+			}
+
+			client_session session{std::move(client_socket), secret, true, compression};
+			if(session.is_lost())
+			{
+				std::cerr << "Handshake failed\n";
+				return 1;
+			} else if(session.is_compressed() != compression)
+			{
+				std::cerr << "The server doesn't support compression\n";
+				return 1;
+			}
+
+			auto first = session.allocate(PAGE, objects, 0, "bench");
+			if(!first)
+			{
+				std::cerr << "Allocation failed\n";
+				return 1;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			for(std::size_t round = 0; round < rounds; ++round)
+			{
+				for(std::size_t i = 0; i < objects; ++i)
+				{
+					session.overwrite(*first + i, std::string_view{contents}.substr(i * PAGE, PAGE));
+				}
+			}
+
+			double overwrite_time = seconds_since(start);
+
+			std::vector<char> output(objects * PAGE);
+			std::vector<std::pair<std::size_t, char*>> targets;
+
+			for(std::size_t i = 0; i < objects; ++i)
+			{
+				targets.emplace_back(*first + i, &output[i * PAGE]);
+			}
+
+			start = std::chrono::steady_clock::now();
+			for(std::size_t round = 0; round < rounds; ++round)
+			{
+				session.fetch_many(targets, PAGE, [](std::size_t, auto) {});
+			}
+
+			double fetch_time = seconds_since(start);
+
+			if(std::memcmp(output.data(), contents.data(), contents.length()) != 0)
+			{
+				std::cerr << "Fetched contents differ\n";
+				return 1;
+			}
+
+			// The first part starts with an additional reference
+			session.drop(*first);
+			for(std::size_t i = 0; i < objects; ++i)
+			{
+				session.drop(*first + i);
+			}
+
+			auto stats = session.get_compression_stats();
+			session.finalize();
+
+			double mebibytes = static_cast<double>(objects * rounds * PAGE) / (1 << 20);
+			auto ratio = stats.packed_wire + stats.unpacked_wire > 0
+			           ? static_cast<double>(stats.packed_bytes + stats.unpacked_bytes)
+			           / static_cast<double>(stats.packed_wire + stats.unpacked_wire) : 1.0;
+
+			auto cost = [](std::uint64_t nanoseconds, std::uint64_t pages)
+			{
+				return pages > 0 ? static_cast<double>(nanoseconds) / 1000 / pages : 0.0;
+			};
+
+			std::cout << kind << '\t' << (compression ? "yes" : "no") << '\t'
+			          << mebibytes / overwrite_time << '\t' << mebibytes / fetch_time << '\t' << ratio << '\t'
+			          << cost(stats.packing_ns, stats.packed_pages) << '\t'
+			          << cost(stats.unpacking_ns, stats.unpacked_pages) << '\n';
+		}
+	}
+
+	return 0;
+}
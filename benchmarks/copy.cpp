@@ -0,0 +1,85 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+/* Measures VSPtr<T> copy/destroy throughput as the number of threads
+ * grows. First each thread works on its own objects, so the only shared
+ * state is the memory manager itself. Then all threads copy the same
+ * objects. Passing 'deferred' selects deferred reference counting.
+ *
+ * Usage: bench_copy [max threads] [copies per thread] [immediate|deferred]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::VSPtr;
+
+	unsigned max_threads = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+	std::size_t copies = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1'000'000;
+
+	ce2103::mm::options settings;
+	if(argc > 3 && std::strcmp(argv[3], "deferred") == 0)
+	{
+		settings.local_references = ce2103::mm::refcounting::deferred;
+	}
+
+	ce2103::mm::initialize(settings);
+
+	constexpr std::size_t OBJECTS_PER_THREAD = 64;
+
+	std::vector<VSPtr<int>> shared;
+	for(std::size_t i = 0; i < OBJECTS_PER_THREAD; ++i)
+	{
+		shared.push_back(VSPtr<int>::New(static_cast<int>(i)));
+	}
+
+	std::cout << "objects\tthreads\tms\tMcopies/s\n";
+	for(bool is_shared : {false, true})
+	{
+		for(unsigned threads = 1; threads <= max_threads; threads *= 2)
+		{
+			auto work = [copies, is_shared, &shared]
+			{
+				std::vector<VSPtr<int>> objects = shared;
+				if(!is_shared)
+				{
+					for(auto& object : objects)
+					{
+						object = VSPtr<int>::New(*object);
+					}
+				}
+
+				for(std::size_t i = 0; i < copies; ++i)
+				{
+					// Copy, then destroy the copy
+					VSPtr<int> copy = objects[i % OBJECTS_PER_THREAD];
+				}
+			};
+
+			auto start = std::chrono::steady_clock::now();
+
+			std::vector<std::thread> workers;
+			for(unsigned i = 0; i < threads; ++i)
+			{
+				workers.emplace_back(work);
+			}
+
+			for(auto& worker : workers)
+			{
+				worker.join();
+			}
+
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			auto milliseconds = std::chrono::duration<double, std::milli>(elapsed).count();
+
+			std::cout << (is_shared ? "shared" : "private") << '\t' << threads << '\t'
+			          << milliseconds << '\t' << threads * copies / (milliseconds * 1e3) << '\n';
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/slab.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+namespace
+{
+	struct node
+	{
+		ce2103::mm::VSPtr<node> next;
+		char payload[48];
+
+		void trace(ce2103::mm::tracer& visitor) const
+		{
+			visitor(this->next);
+		}
+	};
+
+	//! Bytes currently handed out by the slab allocator
+	std::size_t get_live_bytes()
+	{
+		using ce2103::mm::slab_allocator;
+
+		std::size_t live = 0;
+		for(std::size_t size_class = 0; size_class <= slab_allocator::CLASS_COUNT; ++size_class)
+		{
+			live += slab_allocator::get_instance().get_stats(size_class).live;
+		}
+
+		return live;
+	}
+}
+
+/* Repeatedly creates and abandons rings of managed objects, then
+ * collects. Live memory should stay flat when cycle collection is
+ * enabled, and grow by every abandoned ring otherwise (which the GC
+ * then reports as leaked at exit).
+ *
+ * Usage: bench_cycles [rounds] [rings per round] [--no-cycles]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::garbage_collector;
+
+	ce2103::mm::initialize_local();
+	auto& gc = garbage_collector::get_instance();
+
+	std::size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10;
+	std::size_t rings = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100'000;
+	bool cycles = argc <= 3 || std::strcmp(argv[3], "--no-cycles") != 0;
+
+	gc.set_cycle_collection(cycles);
+
+	std::cout << "round\tfreed\tms\tlive KiB\n";
+	for(std::size_t round = 0; round < rounds; ++round)
+	{
+		for(std::size_t i = 0; i < rings; ++i)
+		{
+			auto first = VSPtr<node>::New();
+			auto second = VSPtr<node>::New();
+			auto third = VSPtr<node>::New();
+
+			first->next = second;
+			second->next = third;
+			third->next = first;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		// No other thread touches managed objects
+		std::size_t freed = cycles ? gc.collect_cycles(garbage_collector::stopped_world{}) : gc.collect();
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		std::cout << round << '\t' << freed << '\t'
+		          << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1e3
+		          << '\t' << get_live_bytes() / 1024 << '\n';
+	}
+}
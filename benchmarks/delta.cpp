@@ -0,0 +1,103 @@
+#include <chrono>
+#include <string>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+namespace
+{
+	//! Bytes written by this process so far, sockets included
+	std::size_t get_written_bytes()
+	{
+		std::ifstream stats{"/proc/self/io"};
+
+		std::string key;
+		std::size_t value;
+
+		while(stats >> key >> value)
+		{
+			if(key == "wchar:")
+			{
+				return value;
+			}
+		}
+
+		return 0;
+	}
+}
+
+/* Changes N ints in each page of a resident remote array, for N in powers
+ * of four, and reports the bytes sent per page and the time taken by the
+ * flush() that follows. Some pages might be written back before flush(),
+ * so the time is only indicative. Requires MM_SERVER and MM_PSK.
+ *
+ * Usage: bench_delta [pages] [rounds]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::memory_manager;
+
+	ce2103::mm::initialize();
+
+	auto& manager = memory_manager::get_default(at::any);
+	if(manager.get_locality() != at::remote)
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t pages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+	std::size_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20;
+
+	const std::size_t page_ints = ::sysconf(_SC_PAGESIZE) / sizeof(int);
+
+	auto array = VSPtr<int[]>::New(pages * page_ints);
+	int* raw = &array[0];
+
+	// Random-looking contents, so that zero runs don't shrink full writes
+	for(std::size_t i = 0; i < pages * page_ints; ++i)
+	{
+		raw[i] = static_cast<int>(i * 2654435761u);
+	}
+
+	manager.flush();
+
+	std::cout << "ints/page\tbytes/page\tus/flush\n";
+	for(std::size_t changes = 1; changes <= page_ints; changes *= 4)
+	{
+		std::size_t bytes = 0;
+		double microseconds = 0;
+
+		for(std::size_t round = 0; round < rounds; ++round)
+		{
+			// Some writebacks might start before flush()
+			auto written = get_written_bytes();
+			for(std::size_t page = 0; page < pages; ++page)
+			{
+				for(std::size_t i = 0; i < changes; ++i)
+				{
+					++raw[page * page_ints + i * (page_ints / changes)];
+				}
+			}
+
+			auto start = std::chrono::steady_clock::now();
+
+			manager.flush();
+
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			microseconds += std::chrono::duration<double, std::micro>(elapsed).count();
+			bytes += get_written_bytes() - written;
+		}
+
+		std::cout << changes << '\t' << bytes / (rounds * pages) << '\t' << microseconds / rounds << '\n';
+	}
+}
@@ -0,0 +1,107 @@
+#include <chrono>
+#include <thread>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+#include <unistd.h>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+#include "ce2103/mm/client.hpp"
+
+/* Measures the latency of page faults on remote memory for the given
+ * backend. Misses touch more pages than the resident set holds, in an
+ * order that defeats readahead, so that every access is a network fetch.
+ * Upgrades write to resident read-only pages, which involves no network
+ * traffic and thus measures fault delivery alone. Requires MM_SERVER and
+ * MM_PSK, and MM_REMOTE_PAGES must be left at its default.
+ *
+ * Usage: bench_fault [signals|userfaultfd] [rounds]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::paging;
+	using ce2103::mm::remote_manager;
+	using ce2103::mm::memory_manager;
+
+	ce2103::mm::options settings;
+	if(argc > 1 && std::string_view{argv[1]} == "userfaultfd")
+	{
+		settings.remote_paging = paging::userfaultfd;
+	}
+
+	ce2103::mm::initialize(settings);
+	if(memory_manager::get_default(at::any).get_locality() != at::remote)
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20;
+
+	constexpr std::size_t PAGES = 1024;
+	constexpr std::size_t UPGRADED_PAGES = 64;
+	constexpr std::size_t STEP = 37;
+
+	// Written back pages become read-only after this long
+	constexpr std::chrono::milliseconds SETTLE_TIME{20};
+
+	const std::size_t page_ints = ::sysconf(_SC_PAGESIZE) / sizeof(int);
+
+	auto array = VSPtr<int[]>::New(PAGES * page_ints);
+	int* raw = &array[0];
+
+	auto mean_fault = [](std::size_t faults, auto&& body)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration<double, std::micro>(elapsed).count() / faults;
+	};
+
+	double miss_total = 0;
+	double upgrade_total = 0;
+
+	long sum = 0;
+	for(std::size_t round = 0; round < rounds; ++round)
+	{
+		std::this_thread::sleep_for(SETTLE_TIME);
+		miss_total += mean_fault(PAGES, [&]
+		{
+			for(std::size_t i = 0; i < PAGES; ++i)
+			{
+				sum += raw[(i * STEP % PAGES) * page_ints];
+			}
+		});
+
+		// The last pages read are still resident, and read-only
+		for(std::size_t i = 0; i < UPGRADED_PAGES; ++i)
+		{
+			sum += raw[i * page_ints];
+		}
+
+		std::this_thread::sleep_for(SETTLE_TIME);
+		upgrade_total += mean_fault(UPGRADED_PAGES, [&]
+		{
+			for(std::size_t i = 0; i < UPGRADED_PAGES; ++i)
+			{
+				raw[i * page_ints] = static_cast<int>(round);
+			}
+		});
+	}
+
+	bool uses_userfaultfd = remote_manager::get_instance().get_paging() == paging::userfaultfd;
+
+	std::cout << "backend\tfault\tus\n";
+	std::cout << (uses_userfaultfd ? "userfaultfd" : "signals") << "\tmiss\t" << miss_total / rounds << '\n';
+	std::cout << (uses_userfaultfd ? "userfaultfd" : "signals") << "\tupgrade\t" << upgrade_total / rounds << '\n';
+
+	return sum < 0;
+}
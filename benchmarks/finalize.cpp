@@ -0,0 +1,76 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+namespace
+{
+	//! Long enough to defeat the small string optimization
+	const std::string PROTOTYPE(40, 'x');
+
+	//! Creates 'count' strings in arrays of 'per_array', drops them and times the sweep.
+	double measure(std::size_t count, std::size_t per_array)
+	{
+		using ce2103::mm::VSPtr;
+		auto& gc = ce2103::mm::garbage_collector::get_instance();
+
+		{
+			std::vector<VSPtr<std::string[]>> arrays;
+			arrays.reserve(count / per_array);
+
+			for(std::size_t i = 0; i < count / per_array; ++i)
+			{
+				arrays.push_back(VSPtr<std::string[]>::New(per_array, PROTOTYPE));
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		gc.collect();
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1e3;
+	}
+}
+
+/* Destroys millions of managed strings, both as single objects and
+ * as large arrays, with an increasing number of finalizer threads.
+ *
+ * Usage: bench_finalize [strings] [max finalizer threads]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::garbage_collector;
+
+	ce2103::mm::initialize_local();
+	auto& gc = garbage_collector::get_instance();
+
+	std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+	std::size_t max_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+
+	std::cout << "strings: " << count << "\n"
+	          << "finalizers\tsingle ms\tarrays of 1M ms\n";
+
+	for(std::size_t threads = 0; threads <= max_threads; ++threads)
+	{
+		// Only explicit collections are measured
+		auto tuning = gc.get_tuning();
+		tuning.dead_count = tuning.dead_bytes = SIZE_MAX;
+		tuning.min_period = tuning.max_period = std::chrono::hours{1};
+		tuning.finalizer_threads = threads;
+
+		gc.set_tuning(tuning);
+		gc.collect();
+
+		double single = measure(count, 1);
+		double arrays = measure(count, 1'000'000);
+
+		std::cout << threads << '\t' << single << '\t' << arrays << '\n';
+	}
+}
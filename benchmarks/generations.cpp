@@ -0,0 +1,89 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+/* Runs an allocation-heavy load for a while: most objects die right
+ * after being created, while a long-lived set is slowly replaced. Then
+ * reports what the collector thread did for each generation, and
+ * how the scheduler behaved during the load and a following idle period.
+ *
+ * Usage: bench_generations [seconds] [long-lived objects] [idle seconds]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::generation;
+	using ce2103::mm::garbage_collector;
+
+	ce2103::mm::initialize_local();
+	auto& gc = garbage_collector::get_instance();
+
+	auto duration = std::chrono::seconds{argc > 1 ? std::strtoll(argv[1], nullptr, 10) : 12};
+	std::size_t old_count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100'000;
+	auto idle = std::chrono::seconds{argc > 3 ? std::strtoll(argv[3], nullptr, 10) : 10};
+
+	std::vector<VSPtr<int>> old_objects;
+	old_objects.reserve(old_count);
+
+	for(std::size_t i = 0; i < old_count; ++i)
+	{
+		old_objects.push_back(VSPtr<int>::New(static_cast<int>(i)));
+	}
+
+	std::size_t created = 0;
+	std::size_t replaced = 0;
+
+	auto end = std::chrono::steady_clock::now() + duration;
+	while(std::chrono::steady_clock::now() < end)
+	{
+		{
+			std::vector<VSPtr<int>> temporaries;
+			temporaries.reserve(1'000);
+
+			for(int i = 0; i < 1'000; ++i)
+			{
+				temporaries.push_back(VSPtr<int>::New(i));
+			}
+
+			created += temporaries.size();
+		}
+
+		// One long-lived object is replaced for every thousand temporaries
+		old_objects[replaced++ % old_count] = VSPtr<int>::New(0);
+		++created;
+	}
+
+	std::cout << "created: " << created << "\n"
+	          << "generation\tsweeps\tfreed\tpromoted\tmean pause ms\tmax pause ms\n";
+
+	for(auto which : {generation::young, generation::old})
+	{
+		auto stats = gc.get_stats(which);
+		auto mean = stats.total_pause / std::max<std::size_t>(stats.sweeps, 1);
+
+		std::cout << (which == generation::young ? "young" : "old") << '\t' << stats.sweeps
+		          << '\t' << stats.freed << '\t' << stats.promoted << '\t' << mean.count() / 1e6
+		          << '\t' << stats.max_pause.count() / 1e6 << '\n';
+	}
+
+	auto print_schedule = [&gc](const char* phase)
+	{
+		auto stats = gc.get_schedule_stats();
+		std::cout << phase << '\t' << stats.timeouts << '\t' << stats.triggers << '\t'
+		          << stats.requests << '\t' << stats.sweeps << '\t' << stats.idle << '\n';
+	};
+
+	std::cout << "\nphase\ttimeouts\ttriggers\trequests\tsweeps\tidle sweeps\n";
+	print_schedule("load");
+
+	std::this_thread::sleep_for(idle);
+	print_schedule("idle");
+}
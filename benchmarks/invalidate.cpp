@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* Measures the cost of a remote page switch without any network traffic:
+ * a page of a trap region like the fault handler's is made writable,
+ * written to and then invalidated. Invalidation is done either the old
+ * way, remapping the whole region and punching a hole over all of it,
+ * or by protecting and punching just the affected page.
+ *
+ * Usage: bench_invalidate [switches] [region order, ie log2 of bytes]
+ */
+int main(int argc, const char* const argv[])
+{
+	std::size_t switches = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000;
+	std::size_t order = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 40;
+
+	const std::size_t page_size = ::sysconf(_SC_PAGESIZE);
+	const std::size_t region_size = sizeof(char) << order;
+
+	constexpr auto MMAP_FLAGS = MAP_SHARED | MAP_NORESERVE;
+	constexpr auto FALLOCATE_FLAGS = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+
+	int fd = ::memfd_create("landing", MFD_CLOEXEC);
+	if(fd == -1 || ::ftruncate(fd, region_size) == -1)
+	{
+		std::cerr << "Failed to create the landing file\n";
+		return 1;
+	}
+
+	auto* base = static_cast<char*>(::mmap(nullptr, region_size, PROT_NONE, MMAP_FLAGS, fd, 0));
+	if(base == MAP_FAILED)
+	{
+		std::cerr << "Failed to map the trap region\n";
+		return 1;
+	}
+
+	std::cout << "strategy\tus/switch\tus/invalidation\n";
+	for(bool whole_region : {true, false})
+	{
+		std::chrono::steady_clock::duration invalidating{0};
+
+		auto start = std::chrono::steady_clock::now();
+		for(std::size_t i = 0; i < switches; ++i)
+		{
+			// Pages far apart, as IDs handed out by the server would be
+			std::size_t offset = (i * 7919 % (region_size / page_size)) * page_size;
+			char* page = base + offset;
+
+			::mprotect(page, page_size, PROT_READ | PROT_WRITE);
+			*page = static_cast<char>(i);
+
+			auto invalidation_start = std::chrono::steady_clock::now();
+			if(whole_region)
+			{
+				::mmap(base, region_size, PROT_NONE, MMAP_FLAGS | MAP_FIXED, fd, 0);
+				::fallocate(fd, FALLOCATE_FLAGS, 0, region_size);
+			} else
+			{
+				::mprotect(page, page_size, PROT_NONE);
+				::fallocate(fd, FALLOCATE_FLAGS, offset, page_size);
+			}
+
+			invalidating += std::chrono::steady_clock::now() - invalidation_start;
+		}
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		auto in_microseconds = [switches](auto duration)
+		{
+			return std::chrono::duration<double, std::micro>(duration).count() / switches;
+		};
+
+		std::cout << (whole_region ? "region" : "page") << '\t' << in_microseconds(elapsed)
+		          << '\t' << in_microseconds(invalidating) << '\n';
+	}
+
+	::munmap(base, region_size);
+	::close(fd);
+}
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+#include <sys/resource.h>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+/* Streams over a remote array, first reading it whole and then
+ * overwriting it whole, and reports the throughput and the number of
+ * minor page faults per MiB of each pass. The array is larger than the
+ * resident set either way. With "chunks", the array is a large object,
+ * paged in 2MiB chunks instead of pages. Requires MM_SERVER and MM_PSK.
+ *
+ * Usage: bench_large [pages|chunks] [MiB] [rounds]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::memory_manager;
+
+	constexpr std::size_t MIB = 1 << 20;
+
+	bool chunks = argc > 1 && std::string_view{argv[1]} == "chunks";
+
+	ce2103::mm::options settings;
+	if(chunks)
+	{
+		settings.large_object_threshold = MIB;
+	}
+
+	ce2103::mm::initialize(settings);
+
+	auto& manager = memory_manager::get_default(at::any);
+	if(manager.get_locality() != at::remote)
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t megabytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+	std::size_t rounds = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 3;
+
+	std::size_t length = megabytes * MIB / sizeof(long);
+
+	auto array = VSPtr<long[]>::New(length);
+	long* raw = &array[0];
+
+	auto minor_faults = []
+	{
+		struct ::rusage usage;
+		::getrusage(RUSAGE_SELF, &usage);
+
+		return usage.ru_minflt;
+	};
+
+	double read_time = 0;
+	double write_time = 0;
+	double read_faults = 0;
+	double write_faults = 0;
+
+	auto measure = [&](double& time, double& faults, auto&& body)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto faults_before = minor_faults();
+
+		body();
+		manager.flush();
+
+		faults += minor_faults() - faults_before;
+		time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	long sum = 0;
+	for(std::size_t round = 0; round < rounds; ++round)
+	{
+		measure(read_time, read_faults, [&]
+		{
+			for(std::size_t i = 0; i < length; ++i)
+			{
+				sum += raw[i];
+			}
+		});
+
+		measure(write_time, write_faults, [&]
+		{
+			for(std::size_t i = 0; i < length; ++i)
+			{
+				raw[i] = static_cast<long>(i + round);
+			}
+		});
+	}
+
+	double total = static_cast<double>(megabytes * rounds);
+
+	std::cout << "mode\tpass\tMiB/s\tfaults/MiB\n";
+	std::cout << (chunks ? "chunks" : "pages") << "\tread\t" << total / read_time << '\t' << read_faults / total << '\n';
+	std::cout << (chunks ? "chunks" : "pages") << "\twrite\t" << total / write_time << '\t' << write_faults / total << '\n';
+
+	return sum < 0;
+}
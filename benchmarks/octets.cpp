@@ -0,0 +1,176 @@
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+#include "nlohmann/json.hpp"
+
+#include "ce2103/mm/octets.hpp"
+#include "ce2103/mm/session.hpp"
+
+namespace
+{
+	using ce2103::mm::_detail::octet_isa;
+
+	//! Exposes the codec, no session is ever constructed
+	struct codec : ce2103::mm::session
+	{
+		using session::serialize_octets;
+		using session::deserialize_octets;
+	};
+
+	constexpr std::size_t PAGE = 4096;
+	constexpr std::size_t PAGES = 64;
+
+	//! Fills pages with contents of the given kind
+	std::string make_pages(std::string_view kind)
+	{
+		std::mt19937_64 generator{42};
+		std::string pages(PAGES * PAGE, '\0');
+
+		if(kind == "sparse")
+		{
+			// A few pointer-sized words in an otherwise zeroed page
+			for(std::size_t at = 0; at < pages.size(); at += 128 + generator() % 256 / 8 * 8)
+			{
+				auto word = generator();
+				std::memcpy(&pages[at], &word, std::min(sizeof word, pages.size() - at));
+			}
+		} else if(kind == "dense")
+		{
+			// Small 32-bit integers, whose high zero bytes form runs of two or three
+			for(std::size_t at = 0; at < pages.size(); at += sizeof(std::uint32_t))
+			{
+				auto value = static_cast<std::uint32_t>(generator() % 70'000);
+				std::memcpy(&pages[at], &value, sizeof value);
+			}
+		} else
+		{
+			for(char& byte : pages)
+			{
+				byte = static_cast<char>(generator());
+			}
+		}
+
+		return pages;
+	}
+
+	//! Runs 'body' on every page until 'bytes' are processed, returning GB/s
+	template<typename Body>
+	double measure(std::size_t bytes, Body&& body)
+	{
+		std::size_t rounds = (bytes - 1) / (PAGES * PAGE) + 1;
+
+		auto start = std::chrono::steady_clock::now();
+		for(std::size_t round = 0; round < rounds; ++round)
+		{
+			for(std::size_t page = 0; page < PAGES; ++page)
+			{
+				body(page);
+			}
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return static_cast<double>(rounds * PAGES * PAGE) / seconds / 1e9;
+	}
+}
+
+/* Measures the hex and zero-run codec of the JSON wire format over 4KiB
+ * pages of three kinds: sparse (a few words in a zeroed page), dense
+ * (small 32-bit integers, whose high bytes form short zero runs) and
+ * random bytes. Reports GB/s of page contents for serialize_octets() and
+ * deserialize_octets(), then for each kernel on every instruction set
+ * that the CPU supports. "scan" splits pages at zero runs without encoding.
+ *
+ * Usage: bench_octets [MiB per measurement]
+ */
+int main(int argc, const char* const argv[])
+{
+	std::size_t bytes = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64) << 20;
+
+	const char* kinds[] = {"sparse", "dense", "random"};
+	const char* isa_names[] = {"scalar", "sse2", "avx2"};
+
+	std::vector<char> output(PAGE);
+	std::size_t sink = 0;
+
+	std::cout << "contents\tserialize\tdeserialize\n";
+	for(const char* kind : kinds)
+	{
+		auto pages = make_pages(kind);
+		auto page_of = [&](std::size_t page)
+		{
+			return std::string_view{pages}.substr(page * PAGE, PAGE);
+		};
+
+		std::vector<nlohmann::json> serialized;
+		for(std::size_t page = 0; page < PAGES; ++page)
+		{
+			serialized.push_back(codec::serialize_octets(page_of(page)));
+		}
+
+		double serialize = measure(bytes, [&](std::size_t page)
+		{
+			sink += codec::serialize_octets(page_of(page)).size();
+		});
+
+		double deserialize = measure(bytes, [&](std::size_t page)
+		{
+			sink += codec::deserialize_octets(serialized[page], output.data(), PAGE);
+		});
+
+		std::cout << kind << '\t' << serialize << '\t' << deserialize << '\n';
+	}
+
+	std::cout << "\nisa\tcontents\tencode\tdecode\tscan\n";
+	for(auto isa : {octet_isa::scalar, octet_isa::sse2, octet_isa::avx2})
+	{
+		const auto* kernels = ce2103::mm::_detail::find_octet_kernels(isa);
+		if(kernels == nullptr)
+		{
+			continue;
+		}
+
+		for(const char* kind : kinds)
+		{
+			auto pages = make_pages(kind);
+			std::string hex(2 * pages.size(), '\0');
+
+			double encode = measure(bytes, [&](std::size_t page)
+			{
+				kernels->encode_hex(&pages[page * PAGE], PAGE, &hex[2 * page * PAGE]);
+			});
+
+			double decode = measure(bytes, [&](std::size_t page)
+			{
+				sink += kernels->decode_hex(&hex[2 * page * PAGE], PAGE, output.data());
+			});
+
+			double scan = measure(bytes, [&](std::size_t page)
+			{
+				const char* base = &pages[page * PAGE];
+				for(std::size_t at = 0; at < PAGE; ++sink)
+				{
+					auto barrier = kernels->find_zero_run(base + at, PAGE - at);
+					if(barrier == 0)
+					{
+						barrier = 3 + kernels->find_nonzero(base + at + 3, PAGE - at - 3);
+					}
+
+					at += barrier;
+				}
+			});
+
+			std::cout << isa_names[static_cast<int>(isa)] << '\t' << kind << '\t'
+			          << encode << '\t' << decode << '\t' << scan << '\n';
+		}
+	}
+
+	return sink == 0;
+}
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+/* Measures the throughput of remote page faults taken by several threads
+ * at once. Each thread reads its own remote array in an order that defeats
+ * readahead, so that every access is a network fetch. Requires MM_SERVER
+ * and MM_PSK. MM_FAULT_CHANNELS sets how many faults are serviced at once.
+ *
+ * Usage: bench_parallel [max threads] [pages per thread]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::memory_manager;
+
+	ce2103::mm::initialize();
+	if(memory_manager::get_default(at::any).get_locality() != at::remote)
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4;
+	std::size_t pages = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024;
+
+	constexpr std::size_t STEP = 37;
+
+	const std::size_t page_ints = ::sysconf(_SC_PAGESIZE) / sizeof(int);
+
+	std::vector<VSPtr<int[]>> arrays;
+	for(std::size_t i = 0; i < max_threads; ++i)
+	{
+		arrays.push_back(VSPtr<int[]>::New(pages * page_ints));
+	}
+
+	std::cout << "threads\tfaults/s\n";
+
+	long sum = 0;
+	for(std::size_t threads = 1; threads <= max_threads; ++threads)
+	{
+		std::vector<long> sums(threads);
+		std::vector<std::thread> readers;
+
+		auto start = std::chrono::steady_clock::now();
+		for(std::size_t i = 0; i < threads; ++i)
+		{
+			readers.emplace_back([&, i, raw = &arrays[i][0]]
+			{
+				for(std::size_t page = 0; page < pages; ++page)
+				{
+					sums[i] += raw[(page * STEP % pages) * page_ints];
+				}
+			});
+		}
+
+		for(auto& reader : readers)
+		{
+			reader.join();
+		}
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		double seconds = std::chrono::duration<double>(elapsed).count();
+
+		for(long partial : sums)
+		{
+			sum += partial;
+		}
+
+		std::cout << threads << '\t' << threads * pages / seconds << '\n';
+	}
+
+	return sum < 0;
+}
@@ -0,0 +1,65 @@
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+/* Reads K remote objects in round-robin order, for K in powers of two,
+ * and reports the mean latency of each access. Latency should stay low
+ * while K fits in the resident page set (MM_REMOTE_PAGES) and approach
+ * a network round trip beyond it. Requires MM_SERVER and MM_PSK.
+ *
+ * Usage: bench_pingpong [largest K] [accesses per K]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::memory_manager;
+
+	ce2103::mm::initialize();
+	if(memory_manager::get_default(at::any).get_locality() != at::remote)
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t max_objects = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024;
+	std::size_t accesses = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20'000;
+
+	std::cout << "K\tus/access\n";
+	for(std::size_t count = 1; count <= max_objects; count *= 2)
+	{
+		std::vector<VSPtr<int>> objects;
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			objects.push_back(VSPtr<int>::New(static_cast<int>(i)));
+		}
+
+		// Every object is touched once before timing starts
+		long sum = 0;
+		for(const auto& object : objects)
+		{
+			sum += *object;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		for(std::size_t i = 0; i < accesses; ++i)
+		{
+			sum += *objects[i % count];
+		}
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		auto microseconds = std::chrono::duration<double, std::micro>(elapsed).count();
+
+		std::cout << count << '\t' << microseconds / accesses << '\n';
+		if(sum < 0)
+		{
+			return 1;
+		}
+	}
+}
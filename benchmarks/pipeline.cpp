@@ -0,0 +1,246 @@
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+#include <iostream>
+#include <optional>
+#include <algorithm>
+#include <condition_variable>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "ce2103/network.hpp"
+
+#include "ce2103/mm/client.hpp"
+
+namespace
+{
+	using clock = std::chrono::steady_clock;
+
+	/*!
+	 * \brief Forwards bytes from one descriptor to another, each chunk
+	 *        leaving only after the given delay. Runs until either end
+	 *        fails, in two threads that are never joined.
+	 */
+	void forward_delayed(int from, int to, std::chrono::microseconds delay)
+	{
+		struct link
+		{
+			std::mutex                                            mutex;
+			std::condition_variable                               ready;
+			std::deque<std::pair<clock::time_point, std::string>> chunks;
+		};
+
+		auto shared = std::make_shared<link>();
+
+		std::thread{[from, delay, shared]
+		{
+			char buffer[1 << 16];
+
+			ssize_t bytes;
+			while((bytes = ::read(from, buffer, sizeof buffer)) > 0)
+			{
+				std::lock_guard lock{shared->mutex};
+
+				shared->chunks.emplace_back(clock::now() + delay, std::string(buffer, bytes));
+				shared->ready.notify_one();
+			}
+		}}.detach();
+
+		std::thread{[to, shared]
+		{
+			while(true)
+			{
+				std::unique_lock lock{shared->mutex};
+				shared->ready.wait(lock, [&] { return !shared->chunks.empty(); });
+
+				auto [due, chunk] = std::move(shared->chunks.front());
+				shared->chunks.pop_front();
+				lock.unlock();
+
+				std::this_thread::sleep_until(due);
+				if(::write(to, chunk.data(), chunk.size()) < 0)
+				{
+					return;
+				}
+			}
+		}}.detach();
+	}
+
+	/*!
+	 * \brief Listens on an ephemeral loopback port and relays its first
+	 *        connection to the server, emulating the given round trip time.
+	 *
+	 * \return the relay's endpoint, if it could be set up
+	 */
+	std::optional<ce2103::ip_endpoint> start_relay
+	(
+		const ce2103::ip_endpoint& server, std::chrono::microseconds round_trip
+	)
+	{
+		int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+
+		struct ::sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		::socklen_t length = sizeof address;
+		if(listener < 0 || ::bind(listener, reinterpret_cast<::sockaddr*>(&address), sizeof address) < 0
+		|| ::listen(listener, 1) < 0 || ::getsockname(listener, reinterpret_cast<::sockaddr*>(&address), &length) < 0)
+		{
+			return std::nullopt;
+		}
+
+		int upstream = ::socket(server.is_ipv4() ? AF_INET : AF_INET6, SOCK_STREAM, 0);
+		if(upstream < 0 || ::connect(upstream, &server.as_sockaddr(), server.get_sockaddr_size()) < 0)
+		{
+			return std::nullopt;
+		}
+
+		std::thread{[listener, upstream, round_trip]
+		{
+			int downstream = ::accept(listener, nullptr, nullptr);
+			::close(listener);
+
+			int enable = 1;
+			::setsockopt(upstream, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof enable);
+			::setsockopt(downstream, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof enable);
+
+			forward_delayed(downstream, upstream, round_trip / 2);
+			forward_delayed(upstream, downstream, round_trip / 2);
+		}}.detach();
+
+		return ce2103::ip_endpoint::try_from("127.0.0.1:" + std::to_string(ntohs(address.sin_port)));
+	}
+}
+
+/* Measures reference count traffic: a lift and a drop of each of a number
+ * of remote objects, first one round trip at a time, then pipelined and
+ * finally as a single range command for each of the two operations.
+ * A nonzero round trip time relays the session through a local proxy that
+ * delays both directions, emulating a slower link. Requires MM_SERVER and
+ * MM_PSK, but talks to the server through a client session of its own.
+ *
+ * Usage: bench_pipeline [objects] [round trip in microseconds]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::socket;
+	using ce2103::ip_endpoint;
+	using ce2103::mm::client_session;
+
+	const char* server = std::getenv("MM_SERVER");
+	const char* secret = std::getenv("MM_PSK");
+
+	std::optional<ip_endpoint> endpoint;
+	if(server == nullptr || secret == nullptr || !(endpoint = ip_endpoint::try_from(server)))
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t objects = argc > 1 ? std::max(std::strtoull(argv[1], nullptr, 10), 1ull) : 1000;
+	std::chrono::microseconds round_trip{argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0};
+
+	if(round_trip.count() > 0 && !(endpoint = start_relay(*endpoint, round_trip)))
+	{
+		std::cerr << "Failed to set up the relay\n";
+		return 1;
+	}
+
+	socket client_socket;
+	if(!client_socket.connect(*endpoint))
+	{
+		std::cerr << "Connection to server failed\n";
+		return 1;
+	}
+
+	client_session session{std::move(client_socket), secret};
+
+	std::optional<std::size_t> first;
+	if(session.is_lost() || !(first = session.allocate(64, objects - 1, 64, "bench")))
+	{
+		std::cerr << "Handshake or allocation failed\n";
+		return 1;
+	}
+
+	auto seconds_since = [](auto start)
+	{
+		return std::chrono::duration<double>(clock::now() - start).count();
+	};
+
+	bool failed = false;
+
+	auto start = clock::now();
+	for(std::size_t i = 0; i < objects; ++i)
+	{
+		failed = failed || !session.lift(*first + i);
+	}
+
+	for(std::size_t i = 0; i < objects; ++i)
+	{
+		failed = failed || !session.drop(*first + i);
+	}
+
+	double serial_time = seconds_since(start);
+
+	start = clock::now();
+	for(std::size_t i = 0; i < objects; ++i)
+	{
+		session.lift_async(*first + i, [&failed](bool succeeded)
+		{
+			failed = failed || !succeeded;
+		});
+	}
+
+	for(std::size_t i = 0; i < objects; ++i)
+	{
+		session.drop_async(*first + i, [&failed](auto result)
+		{
+			failed = failed || !result;
+		});
+	}
+
+	failed = !session.wait_all() || failed;
+	double pipelined_time = seconds_since(start);
+
+	start = clock::now();
+	failed = !session.lift_range(*first, objects) || failed;
+	failed = !session.drop_range(*first, objects) || failed;
+
+	double ranged_time = seconds_since(start);
+
+	// The first part starts with an additional reference
+	session.drop(*first);
+	for(std::size_t i = 0; i < objects; ++i)
+	{
+		session.drop(*first + i);
+	}
+
+	if(failed || !session.finalize())
+	{
+		std::cerr << "Some requests failed\n";
+		return 1;
+	}
+
+	double operations = static_cast<double>(2 * objects);
+
+	std::cout << "mode\top/s\tus/op\tspeedup\n";
+	for(auto [mode, time] : {std::make_pair("serial", serial_time),
+	                         std::make_pair("pipelined", pipelined_time),
+	                         std::make_pair(session.has_batches() ? "ranged" : "unranged", ranged_time)})
+	{
+		std::cout << mode << '\t' << operations / time << '\t' << time * 1e6 / operations << '\t' << serial_time / time << '\n';
+	}
+
+	return 0;
+}
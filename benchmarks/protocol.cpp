@@ -0,0 +1,157 @@
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <iostream>
+#include <string_view>
+
+#include "ce2103/network.hpp"
+
+#include "ce2103/mm/client.hpp"
+
+/* Measures the throughput of fetch(), fetch_many() and overwrite() for
+ * 4KiB objects, once with JSON lines and hex-encoded contents and once
+ * with binary frames. Contents are random, so that no zero runs shorten
+ * the hex encoding. Requires MM_SERVER and MM_PSK, but talks to the server
+ * through client sessions of its own instead of the library's manager.
+ *
+ * Usage: bench_protocol [objects] [rounds]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::socket;
+	using ce2103::ip_endpoint;
+	using ce2103::mm::client_session;
+
+	constexpr std::size_t PAGE = 4096;
+
+	const char* server = std::getenv("MM_SERVER");
+	const char* secret = std::getenv("MM_PSK");
+
+	std::optional<ip_endpoint> endpoint;
+	if(server == nullptr || secret == nullptr || !(endpoint = ip_endpoint::try_from(server)))
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t objects = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+	std::size_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20;
+
+	std::mt19937_64 generator{42};
+	std::string contents(objects * PAGE, '\0');
+
+	for(char& byte : contents)
+	{
+		byte = static_cast<char>(generator());
+	}
+
+	auto seconds_since = [](auto start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	std::cout << "encoding\toperation\tMiB/s\tus/page\n";
+	for(bool binary : {false, true})
+	{
+		socket client_socket;
+		if(!client_socket.connect(*endpoint))
+		{
+			std::cerr << "Connection to server failed\n";
+			return 1;
+		}
+
+		client_session session{std::move(client_socket), secret, binary};
+		if(session.is_lost())
+		{
+			std::cerr << "Handshake failed\n";
+			return 1;
+		} else if(session.is_binary() != binary)
+		{
+			std::cerr << "The server doesn't support binary frames\n";
+			return 1;
+		}
+
+		auto first = session.allocate(PAGE, objects, 0, "bench");
+		if(!first)
+		{
+			std::cerr << "Allocation failed\n";
+			return 1;
+		}
+
+		auto page_of = [&](std::size_t i)
+		{
+			return std::string_view{contents}.substr(i * PAGE, PAGE);
+		};
+
+		auto start = std::chrono::steady_clock::now();
+		for(std::size_t round = 0; round < rounds; ++round)
+		{
+			for(std::size_t i = 0; i < objects; ++i)
+			{
+				session.overwrite(*first + i, page_of(i));
+			}
+		}
+
+		double overwrite_time = seconds_since(start);
+
+		std::vector<char> output(objects * PAGE);
+		std::vector<std::pair<std::size_t, char*>> targets;
+
+		for(std::size_t i = 0; i < objects; ++i)
+		{
+			targets.emplace_back(*first + i, &output[i * PAGE]);
+		}
+
+		start = std::chrono::steady_clock::now();
+		for(std::size_t round = 0; round < rounds; ++round)
+		{
+			for(std::size_t i = 0; i < objects; ++i)
+			{
+				session.fetch(*first + i, &output[i * PAGE], PAGE);
+			}
+		}
+
+		double fetch_time = seconds_since(start);
+
+		start = std::chrono::steady_clock::now();
+		for(std::size_t round = 0; round < rounds; ++round)
+		{
+			session.fetch_many(targets, PAGE, [](std::size_t, auto) {});
+		}
+
+		double fetch_many_time = seconds_since(start);
+
+		if(std::memcmp(output.data(), contents.data(), contents.length()) != 0)
+		{
+			std::cerr << "Fetched contents differ\n";
+			return 1;
+		}
+
+		// The first part starts with an additional reference
+		session.drop(*first);
+		for(std::size_t i = 0; i < objects; ++i)
+		{
+			session.drop(*first + i);
+		}
+
+		session.finalize();
+
+		const char* name = binary ? "binary" : "json";
+		double mebibytes = static_cast<double>(objects * rounds * PAGE) / (1 << 20);
+		double pages = static_cast<double>(objects * rounds);
+
+		for(auto [operation, time] : {std::make_pair("overwrite", overwrite_time),
+		                              std::make_pair("fetch", fetch_time),
+		                              std::make_pair("fetch_many", fetch_many_time)})
+		{
+			std::cout << name << '\t' << operation << '\t' << mebibytes / time << '\t' << time * 1e6 / pages << '\n';
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+/* Fills a remote array and then reads it back sequentially through a
+ * raw pointer, so that every page is brought in by a fault. Reports the
+ * throughput of each pass. Requires MM_SERVER and MM_PSK.
+ *
+ * Usage: bench_scan [MiB] [passes]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::memory_manager;
+
+	ce2103::mm::initialize();
+	if(memory_manager::get_default(at::any).get_locality() != at::remote)
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t mebibytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+	std::size_t passes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2;
+
+	std::size_t count = (mebibytes << 20) / sizeof(int);
+	auto array = VSPtr<int[]>::New(count);
+
+	auto measure = [mebibytes](const char* pass, auto&& body)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		auto seconds = std::chrono::duration<double>(elapsed).count();
+
+		std::cout << pass << '\t' << seconds * 1e3 << '\t' << mebibytes / seconds << '\n';
+	};
+
+	// Goes through the trap region instead of probing on every access
+	int* raw = &array[0];
+
+	std::cout << "pass\tms\tMiB/s\n";
+	measure("fill", [raw, count]
+	{
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			raw[i] = static_cast<int>(i);
+		}
+	});
+
+	for(std::size_t pass = 0; pass < passes; ++pass)
+	{
+		std::size_t sum = 0;
+		measure("read", [raw, count, &sum]
+		{
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				sum += raw[i];
+			}
+		});
+
+		if(sum != count * (count - 1) / 2)
+		{
+			std::cerr << "Wrong contents\n";
+			return 1;
+		}
+	}
+}
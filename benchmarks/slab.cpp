@@ -0,0 +1,90 @@
+#include <new>
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/slab.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+namespace
+{
+	template<typename Allocate, typename Deallocate>
+	double measure(std::vector<void*>& blocks, Allocate allocate, Deallocate deallocate)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for(auto& block : blocks)
+		{
+			block = allocate();
+		}
+
+		for(auto* block : blocks)
+		{
+			deallocate(block);
+		}
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+		return nanoseconds / static_cast<double>(blocks.size());
+	}
+}
+
+/* Compares the slab allocator against global operator new/delete for
+ * batches of equally-sized blocks, then reports per-class memory usage
+ * while a population of small VSPtr<int> objects is alive.
+ *
+ * Usage: bench_slab [blocks per size]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::slab_allocator;
+
+	ce2103::mm::initialize_local();
+	auto& slab = slab_allocator::get_instance();
+
+	std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+	std::vector<void*> blocks(count);
+
+	std::cout << "size\tnew ns/block\tslab ns/block\n";
+	for(std::size_t size : {24, 40, 64, 200, 1000, 4000, 16000})
+	{
+		// Large blocks are mapped one by one, so fewer of them are tried
+		blocks.resize(size > slab_allocator::MAX_BLOCK_SIZE ? count / 100 : count);
+
+		double global = measure
+		(
+			blocks, [size]{ return ::operator new(size); }, [](void* block){ ::operator delete(block); }
+		);
+
+		double slabbed = measure
+		(
+			blocks, [&slab, size]{ return slab.allocate(size); },
+			[&slab](void* block){ slab.deallocate(block); }
+		);
+
+		std::cout << size << '\t' << global << '\t' << slabbed << '\n';
+	}
+
+	std::vector<VSPtr<int>> live;
+	live.reserve(count);
+
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		live.push_back(VSPtr<int>::New(static_cast<int>(i)));
+	}
+
+	std::cout << "\nclass\tblock\treserved KiB\tlive KiB\n";
+	for(std::size_t size_class = 0; size_class <= slab_allocator::CLASS_COUNT; ++size_class)
+	{
+		auto stats = slab.get_stats(size_class);
+		if(stats.reserved > 0)
+		{
+			std::cout << size_class << '\t' << stats.block_size << '\t'
+			          << stats.reserved / 1024 << '\t' << stats.live / 1024 << '\n';
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+/* Creates, reads and then frees N small remote objects, reporting the mean
+ * time of each phase per object. Requires MM_SERVER and MM_PSK.
+ *
+ * Usage: bench_small [objects]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::memory_manager;
+
+	ce2103::mm::initialize();
+	if(memory_manager::get_default(at::any).get_locality() != at::remote)
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000;
+
+	auto per_object = [count](auto&& body)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration<double, std::micro>(elapsed).count() / count;
+	};
+
+	std::vector<VSPtr<int>> objects;
+	objects.reserve(count);
+
+	long sum = 0;
+
+	double create_time = per_object([&]
+	{
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			objects.push_back(VSPtr<int>::New(static_cast<int>(i)));
+		}
+	});
+
+	double read_time = per_object([&]
+	{
+		for(const auto& object : objects)
+		{
+			sum += *object;
+		}
+	});
+
+	double free_time = per_object([&]
+	{
+		objects.clear();
+	});
+
+	std::cout << "phase\tus/object\n";
+	std::cout << "create\t" << create_time << '\n';
+	std::cout << "read\t" << read_time << '\n';
+	std::cout << "free\t" << free_time << '\n';
+
+	return sum < 0;
+}
@@ -0,0 +1,64 @@
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+/* Stores to K remote objects in round-robin order, for K in powers of
+ * two, and reports the mean latency of each store and of the flush()
+ * which follows. Every store through a VSPtr is an evict() hint, so this
+ * measures how writebacks are deferred and batched. Requires MM_SERVER
+ * and MM_PSK.
+ *
+ * Usage: bench_store [largest K] [stores per K]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::memory_manager;
+
+	ce2103::mm::initialize();
+
+	auto& manager = memory_manager::get_default(at::any);
+	if(manager.get_locality() != at::remote)
+	{
+		std::cerr << "This benchmark requires a remote memory server\n";
+		return 1;
+	}
+
+	std::size_t max_objects = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+	std::size_t stores = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20'000;
+
+	std::cout << "K\tus/store\tflush us\n";
+	for(std::size_t count = 1; count <= max_objects; count *= 2)
+	{
+		std::vector<VSPtr<int>> objects;
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			objects.push_back(VSPtr<int>::New(0));
+		}
+
+		manager.flush();
+
+		auto start = std::chrono::steady_clock::now();
+		for(std::size_t i = 0; i < stores; ++i)
+		{
+			*objects[i % count] = static_cast<int>(i);
+		}
+
+		auto stored = std::chrono::steady_clock::now();
+		manager.flush();
+
+		auto flushed = std::chrono::steady_clock::now();
+
+		auto store_time = std::chrono::duration<double, std::micro>(stored - start).count();
+		auto flush_time = std::chrono::duration<double, std::micro>(flushed - stored).count();
+
+		std::cout << count << '\t' << store_time / stores << '\t' << flush_time << '\n';
+	}
+}
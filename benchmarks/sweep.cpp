@@ -0,0 +1,60 @@
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+/* Measures how long a single GC sweep takes as a function of the number
+ * of dead objects, while a fixed population of live objects is kept.
+ * Sweep time should grow linearly with the dead count and be independent
+ * of the live count.
+ *
+ * Usage: bench_sweep [live objects] [largest dead count]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::garbage_collector;
+
+	ce2103::mm::initialize_local();
+	auto& gc = garbage_collector::get_instance();
+
+	std::size_t live_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100'000;
+	std::size_t max_dead = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1'000'000;
+
+	std::vector<VSPtr<int>> live;
+	live.reserve(live_count);
+
+	for(std::size_t i = 0; i < live_count; ++i)
+	{
+		live.push_back(VSPtr<int>::New(static_cast<int>(i)));
+	}
+
+	std::cout << "live objects: " << live_count << '\n'
+	          << "dead\tfreed\tms\tns/object\n";
+
+	for(std::size_t dead_count = 1'000; dead_count <= max_dead; dead_count *= 2)
+	{
+		{
+			std::vector<VSPtr<int>> doomed;
+			doomed.reserve(dead_count);
+
+			for(std::size_t i = 0; i < dead_count; ++i)
+			{
+				doomed.push_back(VSPtr<int>::New(static_cast<int>(i)));
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		std::size_t freed = gc.collect();
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+		std::cout << dead_count << '\t' << freed << '\t' << nanoseconds / 1e6 << '\t'
+		          << (freed > 0 ? nanoseconds / static_cast<double>(freed) : 0.0) << '\n';
+	}
+}
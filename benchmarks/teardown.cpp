@@ -0,0 +1,83 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
+#include "ce2103/mm/vsptr.hpp"
+
+namespace
+{
+	//! Has a user-provided, but cheap, destructor
+	struct tagged
+	{
+		std::uint32_t value = 1;
+		std::uint32_t tag = 0;
+
+		~tagged()
+		{
+			this->tag = 0;
+			this->value = 0;
+		}
+	};
+
+	//! Creates 'arrays' arrays of 'length' objects, drops them and times the sweep.
+	template<typename T>
+	double measure(std::size_t arrays, std::size_t length)
+	{
+		using ce2103::mm::VSPtr;
+		auto& gc = ce2103::mm::garbage_collector::get_instance();
+
+		{
+			std::vector<VSPtr<T[]>> doomed;
+			for(std::size_t i = 0; i < arrays; ++i)
+			{
+				doomed.push_back(VSPtr<T[]>::New(length));
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		gc.collect();
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1e3;
+	}
+}
+
+/* Measures how long it takes to destroy and free large managed arrays
+ * of element types with trivial, cheap and expensive destructors.
+ *
+ * Usage: bench_teardown [arrays] [elements per array]
+ */
+int main(int argc, const char* const argv[])
+{
+	using ce2103::mm::garbage_collector;
+
+	ce2103::mm::initialize_local();
+	auto& gc = garbage_collector::get_instance();
+
+	std::size_t arrays = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+	std::size_t length = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1'000'000;
+
+	// Only explicit collections are measured, on the GC thread alone
+	auto tuning = gc.get_tuning();
+	tuning.dead_count = tuning.dead_bytes = SIZE_MAX;
+	tuning.min_period = tuning.max_period = std::chrono::hours{1};
+	tuning.finalizer_threads = 0;
+
+	gc.set_tuning(tuning);
+	gc.collect();
+
+	std::cout << arrays << " arrays of " << length << " elements\n"
+	          << "type\tms\n";
+
+	std::cout << "int\t" << measure<int>(arrays, length) << '\n';
+	std::cout << "tagged\t" << measure<tagged>(arrays, length) << '\n';
+	std::cout << "unique_ptr\t" << measure<std::unique_ptr<int>>(arrays, length) << '\n';
+	std::cout << "string\t" << measure<std::string>(arrays, length) << '\n';
+}
@@ -0,0 +1,58 @@
+#ifndef CE2103_LZ_HPP
+#define CE2103_LZ_HPP
+
+#include <cstddef>
+#include <string_view>
+
+/*!
+ * \brief A fast LZ77 block codec, in the manner of LZ4.
+ *
+ * A block is a sequence of (literals, match) pairs. Each pair starts with
+ * a token byte whose upper nibble is the literal count and whose lower
+ * nibble is the match length minus MIN_MATCH. A nibble of 15 means that
+ * extension bytes follow, each adding its value, until one below 255.
+ * Then come the literals, the match offset as two little-endian bytes and
+ * the match length extension, if any. The last pair of a block has no
+ * match, so the block ends right after its literals.
+ */
+namespace ce2103::lz
+{
+	//! Shortest match that is encoded as such
+	constexpr std::size_t MIN_MATCH = 4;
+
+	//! Farthest back a match can start
+	constexpr std::size_t MAX_OFFSET = 65535;
+
+	//! Upper bound of the compressed size of any input of the given length.
+	constexpr std::size_t max_compressed_size(std::size_t length) noexcept
+	{
+		return length + length / 255 + 16;
+	}
+
+	/*!
+	 * \brief Compresses a block.
+	 *
+	 * \param input    data to compress
+	 * \param output   where to store the compressed block
+	 * \param capacity size of the output buffer. Compression stops as soon
+	 *                 as it would be exceeded, so that incompressible data
+	 *                 is given up on early.
+	 *
+	 * \return compressed size, or zero if it wouldn't fit in the output
+	 */
+	std::size_t compress(std::string_view input, char* output, std::size_t capacity) noexcept;
+
+	/*!
+	 * \brief Decompresses a block produced by compress(). Any input is
+	 *        safe, since every length and offset is checked.
+	 *
+	 * \param input  compressed block
+	 * \param output where to store the decompressed data
+	 * \param length expected decompressed size; fails if this differs
+	 *
+	 * \return whether the block was well-formed and of the expected size
+	 */
+	bool decompress(std::string_view input, char* output, std::size_t length) noexcept;
+}
+
+#endif
@@ -75,6 +75,8 @@ namespace ce2103
 			}
 
 		private:
+			friend class socket;
+
 			//! Discriminator for the sockaddr union.
 			bool _is_ipv4;
 
@@ -164,6 +166,41 @@ namespace ce2103
 			 */
 			bool read_line(std::string& line);
 
+			/*!
+			 * \brief Determines whether a complete line has already been
+			 *        buffered, such that read_line() would not block.
+			 */
+			bool has_buffered_line() const noexcept;
+
+			/*!
+			 * \brief Attempts to read an exact amount of bytes from the socket.
+			 *        Blocks until they are read, EOF is found or an error occurs.
+			 *        Bytes already buffered are taken first, the rest are read
+			 *        straight into the output.
+			 *
+			 * \param output where to store the bytes, or nullptr to skip them
+			 * \param size   number of bytes to read
+			 *
+			 * \return whether every byte was read
+			 */
+			bool read(char* output, std::size_t size);
+
+			/*!
+			 * \brief Determines whether any input has already been buffered,
+			 *        such that read() would return some bytes without blocking.
+			 */
+			inline bool has_buffered_input() const noexcept
+			{
+				return this->buffer_usage > 0;
+			}
+
+			/*!
+			 * \brief Determines whether any input is either buffered or
+			 *        pending in the kernel, such that read() would return
+			 *        some bytes (or fail) without blocking.
+			 */
+			bool has_input() const noexcept;
+
 			/*!
 			 * \brief Writes a string to the socket.
 			 *
@@ -188,6 +225,9 @@ namespace ce2103
 			 */
 			void write_formatted(const char* format, ...);
 
+			//! Retrieves the address of the remote end, if connected
+			std::optional<ip_endpoint> get_peer() const noexcept;
+
 			//! Retrieves the socket's file descriptor, or a negative integer if inactive
 			inline int get_descriptor() const noexcept
 			{
@@ -0,0 +1,303 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string_view>
+
+#include "ce2103/lz.hpp"
+
+namespace
+{
+	using namespace ce2103::lz;
+
+	//! Width of match table indices
+	constexpr unsigned HASH_BITS = 12;
+
+	//! Nibble value which indicates that extension bytes follow
+	constexpr std::size_t NIBBLE_MAX = 15;
+
+	//! Loads an unaligned integer, in host byte order.
+	template<typename T>
+	inline T load(const char* at) noexcept
+	{
+		T value;
+		std::memcpy(&value, at, sizeof value);
+
+		return value;
+	}
+
+	//! Maps the next MIN_MATCH bytes to a match table index.
+	inline std::uint32_t hash_at(const char* at) noexcept
+	{
+		return load<std::uint32_t>(at) * 2654435761u >> (32 - HASH_BITS);
+	}
+
+	//! Counts the bytes at 'left' that match those at 'right', up to 'end'.
+	inline std::size_t count_matching(const char* left, const char* right, const char* end) noexcept
+	{
+		const char* start = left;
+		while(end - left >= 8)
+		{
+			auto difference = load<std::uint64_t>(left) ^ load<std::uint64_t>(right);
+			if(difference != 0)
+			{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+				// The lowest byte is the first one
+				return left - start + __builtin_ctzll(difference) / 8;
+#else
+				break;
+#endif
+			}
+
+			left += 8;
+			right += 8;
+		}
+
+		while(left < end && *left == *right)
+		{
+			++left;
+			++right;
+		}
+
+		return left - start;
+	}
+
+	//! Bytes taken by the extension of a length whose nibble overflows.
+	inline std::size_t extension_size(std::size_t value) noexcept
+	{
+		return value < NIBBLE_MAX ? 0 : (value - NIBBLE_MAX) / 255 + 1;
+	}
+
+	//! Writes the extension of a length whose nibble overflows.
+	void put_extension(char*& output, std::size_t value) noexcept
+	{
+		if(value < NIBBLE_MAX)
+		{
+			return;
+		}
+
+		for(value -= NIBBLE_MAX; value >= 255; value -= 255)
+		{
+			*output++ = static_cast<char>(255);
+		}
+
+		*output++ = static_cast<char>(value);
+	}
+
+	//! Adds the extension bytes that follow an overflowed nibble to a length.
+	bool get_extension(const std::uint8_t*& input, const std::uint8_t* end, std::size_t& value) noexcept
+	{
+		std::uint8_t byte;
+		do
+		{
+			if(input == end)
+			{
+				return false;
+			}
+
+			byte = *input++;
+			value += byte;
+		} while(byte == 255);
+
+		return true;
+	}
+
+	/*!
+	 * \brief Appends a (literals, match) pair, or only literals if the
+	 *        match is empty, unless it would overrun the output.
+	 *
+	 * \return whether there was enough room
+	 */
+	bool put_pair
+	(
+		char*& output, const char* end, std::string_view literals,
+		std::size_t offset, std::size_t match_length
+	) noexcept
+	{
+		std::size_t literal_count = literals.length();
+		std::size_t match_code = match_length > 0 ? match_length - MIN_MATCH : 0;
+
+		std::size_t required = 1 + extension_size(literal_count) + literal_count;
+		if(match_length > 0)
+		{
+			required += 2 + extension_size(match_code);
+		}
+
+		if(required > static_cast<std::size_t>(end - output))
+		{
+			return false;
+		}
+
+		*output++ = static_cast<char>
+		(
+			std::min(literal_count, NIBBLE_MAX) << 4 | std::min(match_code, NIBBLE_MAX)
+		);
+
+		put_extension(output, literal_count);
+		std::memcpy(output, literals.data(), literal_count);
+		output += literal_count;
+
+		if(match_length > 0)
+		{
+			*output++ = static_cast<char>(offset & 0xff);
+			*output++ = static_cast<char>(offset >> 8);
+
+			put_extension(output, match_code);
+		}
+
+		return true;
+	}
+}
+
+namespace ce2103::lz
+{
+	std::size_t compress(std::string_view input, char* output, std::size_t capacity) noexcept
+	{
+		const char* const begin = input.data();
+		const char* const end = begin + input.length();
+
+		char* next_output = output;
+		const char* const output_end = output + capacity;
+
+		// Positions of recently seen sequences, by hash; stale entries are harmless
+		std::uint32_t table[1 << HASH_BITS] = {};
+
+		const char* anchor = begin;
+		const char* cursor = begin;
+
+		// Incompressible data is skipped faster the longer it goes on
+		std::size_t misses = 0;
+
+		while(end - cursor >= static_cast<std::ptrdiff_t>(MIN_MATCH))
+		{
+			auto& slot = table[hash_at(cursor)];
+			const char* candidate = begin + slot;
+			slot = static_cast<std::uint32_t>(cursor - begin);
+
+			if(candidate >= cursor || static_cast<std::size_t>(cursor - candidate) > MAX_OFFSET
+			|| load<std::uint32_t>(candidate) != load<std::uint32_t>(cursor))
+			{
+				cursor += std::min<std::size_t>(1 + (misses++ >> 6), end - cursor);
+				continue;
+			}
+
+			misses = 0;
+
+			// Extends the match forwards, then backwards into pending literals
+			const char* match_end = cursor + MIN_MATCH;
+			match_end += count_matching(match_end, candidate + MIN_MATCH, end);
+
+			while(cursor > anchor && candidate > begin && cursor[-1] == candidate[-1])
+			{
+				--cursor;
+				--candidate;
+			}
+
+			std::string_view literals{anchor, static_cast<std::size_t>(cursor - anchor)};
+			if(!put_pair(next_output, output_end, literals, cursor - candidate, match_end - cursor))
+			{
+				return 0;
+			}
+
+			anchor = cursor = match_end;
+		}
+
+		std::string_view literals{anchor, static_cast<std::size_t>(end - anchor)};
+		if(!put_pair(next_output, output_end, literals, 0, 0))
+		{
+			return 0;
+		}
+
+		return next_output - output;
+	}
+
+	bool decompress(std::string_view input, char* output, std::size_t length) noexcept
+	{
+		const auto* next = reinterpret_cast<const std::uint8_t*>(input.data());
+		const auto* const end = next + input.length();
+
+		char* next_output = output;
+		char* const output_end = output + length;
+
+		while(next < end)
+		{
+			unsigned token = *next++;
+
+			std::size_t literal_count = token >> 4;
+			if((literal_count == NIBBLE_MAX && !get_extension(next, end, literal_count))
+			|| literal_count > static_cast<std::size_t>(end - next)
+			|| literal_count > static_cast<std::size_t>(output_end - next_output))
+			{
+				return false;
+			}
+
+			// Short literals are copied whole while there is room, the excess is overwritten later
+			if(literal_count <= 16 && end - next >= 16 && output_end - next_output >= 16)
+			{
+				std::memcpy(next_output, next, 16);
+			} else
+			{
+				std::memcpy(next_output, next, literal_count);
+			}
+
+			next += literal_count;
+			next_output += literal_count;
+
+			// The last pair has no match
+			if(next == end)
+			{
+				break;
+			} else if(end - next < 2)
+			{
+				return false;
+			}
+
+			std::size_t offset = next[0] | next[1] << 8;
+			next += 2;
+
+			std::size_t match_length = token & NIBBLE_MAX;
+			if(match_length == NIBBLE_MAX && !get_extension(next, end, match_length))
+			{
+				return false;
+			}
+
+			match_length += MIN_MATCH;
+			if(offset == 0 || offset > static_cast<std::size_t>(next_output - output)
+			|| match_length > static_cast<std::size_t>(output_end - next_output))
+			{
+				return false;
+			}
+
+			/* Matches may overlap their own output, as in runs of a repeated
+			 * pattern. Eight-byte steps are safe whenever the offset is at
+			 * least that, since each one only reads what was already written.
+			 * If there is room, the last step may overrun the match, since
+			 * the excess is overwritten later.
+			 */
+			const char* source = next_output - offset;
+			char* match_end = next_output + match_length;
+
+			if(offset >= 8 && static_cast<std::size_t>(output_end - next_output) >= match_length + 7)
+			{
+				for(; next_output < match_end; next_output += 8, source += 8)
+				{
+					std::memcpy(next_output, source, 8);
+				}
+
+				next_output = match_end;
+			} else if(offset >= match_length)
+			{
+				std::memcpy(next_output, source, match_length);
+				next_output = match_end;
+			} else
+			{
+				while(next_output < match_end)
+				{
+					*next_output++ = *source++;
+				}
+			}
+		}
+
+		return next_output == output_end;
+	}
+}
@@ -5,13 +5,17 @@
 #include <cstdarg>
 #include <cstring>
 #include <utility>
+#include <algorithm>
 #include <string_view>
 #include <system_error>
 
+#include <poll.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 #include "ce2103/network.hpp"
 
@@ -23,6 +27,16 @@ namespace
 	{
 		throw std::system_error{errno, std::system_category()};
 	}
+
+	/*!
+	 * \brief Disables Nagle's algorithm. Otherwise, pipelined requests and
+	 *        responses would wait on delayed acknowledgements.
+	 */
+	void disable_coalescing(int descriptor) noexcept
+	{
+		int enable = 1;
+		::setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof enable);
+	}
 }
 
 namespace ce2103
@@ -130,6 +144,7 @@ namespace ce2103
 
 		if(result)
 		{
+			disable_coalescing(this->descriptor);
 			this->expect_buffer();
 		}
 
@@ -144,9 +159,33 @@ namespace ce2103
 			return std::nullopt;
 		}
 
+		disable_coalescing(client_descriptor);
 		return socket{client_descriptor};
 	}
 
+	std::optional<ip_endpoint> socket::get_peer() const noexcept
+	{
+		struct ::sockaddr_storage address;
+		::socklen_t length = sizeof address;
+
+		if(::getpeername(this->descriptor, reinterpret_cast<struct ::sockaddr*>(&address), &length) != 0)
+		{
+			return std::nullopt;
+		}
+
+		switch(address.ss_family)
+		{
+			case AF_INET:
+				return ip_endpoint{reinterpret_cast<struct ::sockaddr_in&>(address)};
+
+			case AF_INET6:
+				return ip_endpoint{reinterpret_cast<struct ::sockaddr_in6&>(address)};
+
+			default:
+				return std::nullopt;
+		}
+	}
+
 	bool socket::expect_descriptor(bool is_ipv4) noexcept
 	{
 		if(this->descriptor < 0)
@@ -219,6 +258,77 @@ namespace ce2103
 		return found || !line.empty();
 	}
 
+	bool socket::has_buffered_line() const noexcept
+	{
+		return this->buffer_usage > 0
+		    && std::memchr(this->buffer_base, '\n', this->buffer_usage) != nullptr;
+	}
+
+	bool socket::has_input() const noexcept
+	{
+		if(this->buffer_usage > 0)
+		{
+			return true;
+		}
+
+		struct ::pollfd request{this->descriptor, POLLIN, 0};
+		return this->descriptor >= 0 && ::poll(&request, 1, 0) > 0;
+	}
+
+	bool socket::read(char* output, std::size_t size)
+	{
+		if(this->buffer == nullptr)
+		{
+			return false;
+		}
+
+		std::size_t buffered = std::min(size, this->buffer_usage);
+		if(output != nullptr)
+		{
+			std::memcpy(output, this->buffer_base, buffered);
+			output += buffered;
+		}
+
+		this->buffer_base += buffered;
+		this->buffer_usage -= buffered;
+		size -= buffered;
+
+		while(size > 0)
+		{
+			// Small remainders go through the buffer, so that what follows them is buffered too
+			bool direct = output != nullptr && size >= BUFFER_SIZE;
+
+			auto bytes = ::read(this->descriptor, direct ? output : this->buffer, direct ? size : BUFFER_SIZE);
+			if(bytes == 0)
+			{
+				return false;
+			} else if(bytes < 0)
+			{
+				this->close();
+				return false;
+			} else if(direct)
+			{
+				output += bytes;
+				size -= bytes;
+
+				continue;
+			}
+
+			auto taken = std::min(size, static_cast<std::size_t>(bytes));
+			if(output != nullptr)
+			{
+				std::memcpy(output, this->buffer, taken);
+				output += taken;
+			}
+
+			this->buffer_base = this->buffer + taken;
+			this->buffer_usage = bytes - taken;
+			size -= taken;
+		}
+
+		return true;
+	}
+
 	void socket::write(std::string_view output)
 	{
 		if(::write(this->descriptor, output.data(), output.length()) < 0)
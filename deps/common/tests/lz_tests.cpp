@@ -0,0 +1,122 @@
+#include <random>
+#include <string>
+#include <cstddef>
+#include <string_view>
+
+#include "catch.hpp"
+#include "ce2103/lz.hpp"
+
+namespace lz = ce2103::lz;
+
+namespace
+{
+	//! Compresses and decompresses, returning the compressed size, or zero on failure
+	std::size_t round_trip(std::string_view input)
+	{
+		std::string compressed(lz::max_compressed_size(input.length()), '\0');
+		std::size_t size = lz::compress(input, compressed.data(), compressed.length());
+
+		std::string output(input.length(), '\0');
+		if(size == 0 || !lz::decompress({compressed.data(), size}, output.data(), output.length())
+		|| output != input)
+		{
+			return 0;
+		}
+
+		return size;
+	}
+
+	std::string random_bytes(std::size_t length, std::mt19937& generator)
+	{
+		std::string bytes(length, '\0');
+		for(char& byte : bytes)
+		{
+			byte = static_cast<char>(generator());
+		}
+
+		return bytes;
+	}
+}
+
+TEST_CASE("lz: empty and short inputs", "[lz]")
+{
+	REQUIRE(round_trip("") > 0);
+	REQUIRE(round_trip("a") > 0);
+	REQUIRE(round_trip("abcabc") > 0);
+	REQUIRE(round_trip("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa") > 0);
+}
+
+TEST_CASE("lz: repetitive inputs shrink", "[lz]")
+{
+	std::string zeros(4096, '\0');
+	REQUIRE(round_trip(zeros) < 64);
+
+	std::string text;
+	while(text.length() < 4096)
+	{
+		text += "struct node { node* next; int value; }; ";
+	}
+
+	REQUIRE(round_trip(text) < text.length() / 8);
+
+	// Matches farther back than MAX_OFFSET can't be referenced
+	std::mt19937 generator{42};
+	auto block = random_bytes(lz::MAX_OFFSET + 1000, generator);
+
+	REQUIRE(round_trip(block + block) > 0);
+}
+
+TEST_CASE("lz: random inputs round-trip", "[lz]")
+{
+	std::mt19937 generator{7};
+	for(std::size_t length : {1, 15, 16, 270, 4096, 70000})
+	{
+		auto bytes = random_bytes(length, generator);
+		REQUIRE(round_trip(bytes) <= lz::max_compressed_size(length));
+
+		// Runs of a single value, whose matches overlap their own output
+		for(std::size_t i = 0; i < length; i += 97)
+		{
+			bytes.replace(i, std::min<std::size_t>(length - i, 1 + generator() % 40), 1 + generator() % 40, bytes[i]);
+			bytes.resize(length);
+		}
+
+		REQUIRE(round_trip(bytes) > 0);
+	}
+}
+
+TEST_CASE("lz: insufficient capacity", "[lz]")
+{
+	std::mt19937 generator{3};
+	auto bytes = random_bytes(4096, generator);
+
+	std::string output(bytes.length() - 1, '\0');
+	REQUIRE(lz::compress(bytes, output.data(), output.length()) == 0);
+}
+
+TEST_CASE("lz: malformed blocks are rejected", "[lz]")
+{
+	std::string text(1000, 'x');
+	text += "some literals at the end";
+
+	std::string compressed(lz::max_compressed_size(text.length()), '\0');
+	compressed.resize(lz::compress(text, compressed.data(), compressed.length()));
+
+	std::string output(text.length(), '\0');
+	REQUIRE(lz::decompress(compressed, output.data(), output.length()));
+
+	// Truncated
+	for(std::size_t length = 0; length < compressed.length(); ++length)
+	{
+		REQUIRE(!lz::decompress({compressed.data(), length}, output.data(), output.length()));
+	}
+
+	// Wrong expected length
+	REQUIRE(!lz::decompress(compressed, output.data(), output.length() - 1));
+
+	// A match before the start of the output
+	REQUIRE(!lz::decompress(std::string_view{"\x10x\x02\x00", 4}, output.data(), 5));
+
+	// Zero offset
+	REQUIRE(!lz::decompress(std::string_view{"\x10x\x00\x00", 4}, output.data(), 5));
+}
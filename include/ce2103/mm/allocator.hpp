@@ -56,6 +56,7 @@ namespace ce2103::mm
 			template<typename = std::enable_if_t<!std::is_void_v<T>>>
 			inline unsafe_ptr& operator++() noexcept
 			{
+				this->is_front = false;
 				return *(++this->data, this);
 			}
 
@@ -63,13 +64,17 @@ namespace ce2103::mm
 			template<typename = std::enable_if_t<!std::is_void_v<T>>>
 			inline unsafe_ptr operator++(int) noexcept
 			{
-				return this->template clone_with<unsafe_ptr>(this->data++);
+				auto previous = this->template clone_with<unsafe_ptr>(this->data++);
+				this->is_front = false;
+
+				return previous;
 			}
 
 			//! Performs pointer arithmetic
 			template<typename = std::enable_if_t<!std::is_void_v<T>>>
 			inline unsafe_ptr& operator--() noexcept
 			{
+				this->is_front = false;
 				return *(--this->data, this);
 			}
 
@@ -77,7 +82,10 @@ namespace ce2103::mm
 			template<typename = std::enable_if_t<!std::is_void_v<T>>>
 			inline unsafe_ptr operator--(int) noexcept
 			{
-				return this->template clone_with<unsafe_ptr>(this->data--);
+				auto previous = this->template clone_with<unsafe_ptr>(this->data--);
+				this->is_front = false;
+
+				return previous;
 			}
 
 			//! Performs pointer arithmetic
@@ -185,7 +193,7 @@ namespace ce2103::mm
 		[[maybe_unused]]
 		auto [id, resource, base] = owner.allocate_of<T>(count);
 
-		return unsafe_ptr<T>{base, id, owner.get_locality()};
+		return unsafe_ptr<T>{base, id, owner.get_locality(), true};
 	}
 }
 
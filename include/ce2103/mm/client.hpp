@@ -1,31 +1,91 @@
 #ifndef CE2103_MM_CLIENT_HPP
 #define CE2103_MM_CLIENT_HPP
 
+#include <map>
+#include <deque>
 #include <mutex>
+#include <memory>
 #include <string>
+#include <vector>
 #include <utility>
 #include <cstddef>
+#include <cstdint>
+#include <climits>
 #include <optional>
 #include <typeinfo>
+#include <functional>
 #include <string_view>
 
 #include "ce2103/network.hpp"
+#include "ce2103/hash_map.hpp"
 
 #include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/init.hpp"
 #include "ce2103/mm/session.hpp"
 
 namespace ce2103::mm
 {
-	//! Client-side remote memory session
+	/*!
+	 * \brief Client-side remote memory session.
+	 *
+	 * Requests are pipelined: the *_async() operations send a request and
+	 * return its sequence number without awaiting the response. The server
+	 * answers each session's requests strictly in order, so responses are
+	 * matched to requests by position and completed in the same order.
+	 * Completion callbacks run within whichever call receives the response,
+	 * with the session locked, and must not use the session themselves.
+	 * The synchronous operations are an asynchronous request plus wait().
+	 */
 	class client_session : public session
 	{
 		public:
+			//! Identifies a request, numbered in the order of sending
+			using sequence = std::uint64_t;
+
+			//! New contents for part of a remote allocation
+			struct patch
+			{
+				std::size_t      id;       //!< Allocation ID
+				std::size_t      offset;   //!< Where the contents start within the allocation
+				std::string_view contents; //!< Bytes to write
+			};
+
 			/*!
 			 * \brief Constructs a client session out of a socket and
 			 *        the authorization secret. is_lost() will return
 			 *        true afterwards if authorization or connection fails.
+			 *
+			 * \param client_socket connected socket
+			 * \param secret        authorization secret
+			 * \param binary        whether to propose binary frames, which
+			 *                      are only used if the server supports them
+			 * \param compression   whether to also propose compressing
+			 *                      contents, under the same condition
 			 */
-			client_session(socket client_socket, std::string_view secret);
+			client_session
+			(
+				socket client_socket, std::string_view secret,
+				bool binary = true, bool compression = false
+			);
+
+			//! Whether binary frames are used instead of JSON lines.
+			using session::is_binary;
+
+			//! Whether object contents may be compressed on their way in or out.
+			using session::is_compressed;
+
+			//! Retrieves the counters of the compression stage so far.
+			compression_stats get_compression_stats() const;
+
+			/*!
+			 * \brief Whether the server accepts range commands. Otherwise,
+			 *        the *_range() operations fall back to one request per
+			 *        object, which are still pipelined.
+			 */
+			inline bool has_batches() const noexcept
+			{
+				return this->batches;
+			}
 
 			/*!
 			 * \brief Terminates the session. Returns whether this was done
@@ -33,6 +93,24 @@ namespace ce2103::mm
 			 */
 			bool finalize();
 
+			/*!
+			 * \brief Allows other sessions to operate on the objects of
+			 *        this one, see join().
+			 *
+			 * \return token to join with, if successful
+			 */
+			std::optional<std::uint64_t> share();
+
+			/*!
+			 * \brief Makes this session operate on the objects of another
+			 *        one from now on. No objects may have been allocated.
+			 *
+			 * \param token as returned by share() on the other session
+			 *
+			 * \return whether the operation succeeded
+			 */
+			bool join(std::uint64_t token);
+
 			/*!
 			 * \brief Requests a new piecewise allocation to the server.
 			 *        A number of sequential IDs are allocated according
@@ -53,14 +131,105 @@ namespace ce2103::mm
 				std::size_t part_size, std::size_t parts, std::size_t remainder, const char* type
 			);
 
+			//! Asynchronous version of allocate().
+			sequence allocate_async
+			(
+				std::size_t part_size, std::size_t parts, std::size_t remainder, const char* type,
+				std::function<void(std::optional<std::size_t>)> on_completion
+			);
+
 			//! Attempts to increment the reference count of a remote object.
 			bool lift(std::size_t id);
 
+			//! Asynchronous version of lift().
+			sequence lift_async(std::size_t id, std::function<void(bool)> on_completion = {});
+
 			//! Attempts to decrement the reference count of a remote object.
 			std::optional<drop_result> drop(std::size_t id);
 
-			//! Attempts to retrieve the raw contents of a remote object.
-			std::optional<std::string> fetch(std::size_t id);
+			//! Asynchronous version of drop().
+			sequence drop_async
+			(
+				std::size_t id, std::function<void(std::optional<drop_result>)> on_completion = {}
+			);
+
+			/*!
+			 * \brief Increments at once the reference count of every object
+			 *        in [first, first + count). Count must not be zero.
+			 *
+			 * \return whether every object was lifted
+			 */
+			bool lift_range(std::size_t first, std::size_t count);
+
+			//! Asynchronous version of lift_range().
+			sequence lift_range_async
+			(
+				std::size_t first, std::size_t count, std::function<void(bool)> on_completion = {}
+			);
+
+			/*!
+			 * \brief Decrements at once the reference count of every object
+			 *        in [first, first + count). Count must not be zero.
+			 *
+			 * \return result of each drop in ID order, if all succeeded
+			 */
+			std::optional<std::vector<drop_result>> drop_range(std::size_t first, std::size_t count);
+
+			//! Asynchronous version of drop_range().
+			sequence drop_range_async
+			(
+				std::size_t first, std::size_t count,
+				std::function<void(std::optional<std::vector<drop_result>>)> on_completion = {}
+			);
+
+			/*!
+			 * \brief Attempts to retrieve the raw contents of a remote object,
+			 *        deserializing them straight into the given buffer.
+			 *
+			 * \param id       remote object ID
+			 * \param output   destination of the object contents
+			 * \param capacity size of the output buffer; larger objects fail
+			 *
+			 * \return object size, if successful
+			 */
+			std::optional<std::size_t> fetch(std::size_t id, char* output, std::size_t capacity);
+
+			//! Asynchronous version of fetch(). The output buffer must outlive the request.
+			sequence fetch_async
+			(
+				std::size_t id, char* output, std::size_t capacity,
+				std::function<void(std::optional<std::size_t>)> on_completion = {}
+			);
+
+			/*!
+			 * \brief Same as fetch(), but for several objects at once. All
+			 *        requests are sent before any response is awaited, so
+			 *        that the whole batch costs a single round trip.
+			 *
+			 * \param targets    pairs of object ID and output buffer
+			 * \param capacity   size of each output buffer
+			 * \param on_arrival called in order for every target with its
+			 *                   index and object size, or std::nullopt if
+			 *                   the object could not be retrieved
+			 *
+			 * \return whether the session is still usable afterwards
+			 */
+			bool fetch_many
+			(
+				const std::vector<std::pair<std::size_t, char*>>& targets, std::size_t capacity,
+				const std::function<void(std::size_t, std::optional<std::size_t>)>& on_arrival
+			);
+
+			/*!
+			 * \brief Same as fetch_many(), but for the consecutive objects
+			 *        starting at 'first', one per output buffer, which are
+			 *        requested by a single command. Outputs must not be empty.
+			 */
+			bool fetch_range
+			(
+				std::size_t first, const std::vector<char*>& outputs, std::size_t capacity,
+				const std::function<void(std::size_t, std::optional<std::size_t>)>& on_arrival
+			);
 
 			/*!
 			 * \brief Sends a message which instructs to overwrite the
@@ -70,12 +239,94 @@ namespace ce2103::mm
 			 */
 			bool overwrite(std::size_t id, std::string_view contents);
 
+			//! Asynchronous version of overwrite(). Contents are sent before returning.
+			sequence overwrite_async
+			(
+				std::size_t id, std::string_view contents,
+				std::function<void(bool)> on_completion = {}
+			);
+
+			/*!
+			 * \brief Similar to overwrite(), but for any number of byte
+			 *        ranges within any number of allocations, which are
+			 *        sent within a single message and response.
+			 *
+			 * \return whether every patch was applied
+			 */
+			bool overwrite_many(const std::vector<patch>& patches);
+
+			/*!
+			 * \brief Receives responses until the given request and all
+			 *        earlier ones have completed.
+			 *
+			 * \return whether the session is still usable afterwards
+			 */
+			bool wait(sequence request);
+
+			//! Receives responses until no request is in flight, see wait().
+			bool wait_all();
+
+			/*!
+			 * \brief Completes requests whose responses have been received
+			 *        already, without blocking.
+			 *
+			 * \return whether the session is still usable afterwards
+			 */
+			bool poll();
+
 		private:
+			//! Requests in flight beyond which senders first await the oldest responses
+			static constexpr std::size_t MAX_IN_FLIGHT = 1024;
+
 			mutable std::mutex mutex; //!< Mutex for multithread synchronization
 
+			/*!
+			 * \brief Receivers of the responses to requests in flight, in
+			 *        order. Each one consumes a response and completes its
+			 *        request.
+			 */
+			std::deque<std::function<void()>> in_flight;
+
+			//! Sequence number of the next request to be sent
+			sequence next_sequence = 0;
+
+			//! See has_batches()
+			bool batches = false;
+
+			/*!
+			 * \brief Completes the oldest requests until the given number of
+			 *        new ones fits within MAX_IN_FLIGHT. 'mutex' must be held.
+			 */
+			void make_room(std::size_t requests = 1);
+
+			/*!
+			 * \brief Registers the receiver of the response to a request that
+			 *        was just sent. 'mutex' must be held.
+			 *
+			 * \return the request's sequence number
+			 */
+			sequence enqueue(std::function<void()> receiver);
+
+			//! Receives the oldest response in flight. 'mutex' must be held.
+			void complete_next();
+
 			//! Receives a message and returns true if and only if it is '{}'
 			bool expect_empty();
 
+			//! Receives the response to a drop request.
+			std::optional<drop_result> expect_drop_result();
+
+			//! Receives the response to a drop request for a range of objects.
+			std::optional<std::vector<drop_result>> expect_drop_results(std::size_t first, std::size_t count);
+
+			/*!
+			 * \brief Receives the response to a read request, deserializing
+			 *        the contents straight into the given buffer.
+			 *
+			 * \return object size, if successful
+			 */
+			std::optional<std::size_t> receive_contents(char* output, std::size_t capacity);
+
 			//! Expects a message of the form '{..., "value": <a T>, ...}'
 			template<typename T>
 			std::optional<T> expect_value();
@@ -85,6 +336,14 @@ namespace ce2103::mm
 	 * \brief A manager which forwards requests to a network server.
 	 *        Userspace virtual memory manipulation is used to do this
 	 *        in a transparent manner.
+	 *
+	 * Small allocations are packed into remote pages which they share with
+	 * others of similar size. The server only knows of the shared pages,
+	 * while the reference counts of the allocations within are kept locally.
+	 *
+	 * If enabled, large allocations are instead split into 2MiB chunks,
+	 * each of which is fetched and written back as a whole, and placed in
+	 * a separate area of the trap region where chunks are 2MiB-aligned.
 	 */
 	class remote_manager : public memory_manager
 	{
@@ -97,15 +356,30 @@ namespace ce2103::mm
 			 * \brief Attempts to setup a properly established session
 			 *        from the given socket and authorization secret.
 			 *
+			 * \param client_socket connected socket
+			 * \param secret        authorization secret
+			 * \param mode          preferred way to trap remote accesses
+			 * \param threshold     smallest large allocation, zero if disabled
+			 * \param compression   whether to propose compressing page contents
+			 *
 			 * \return whether initialization succeeded
 			 */
-			static bool initialize(socket client_socket, std::string_view secret);
+			static bool initialize
+			(
+				socket client_socket, std::string_view secret,
+				paging mode = paging::signals, std::size_t threshold = 0,
+				bool compression = false
+			);
 
 			//! Returns the quasi-singleton instance.
 			static remote_manager& get_instance();
 
 			//! Constructs 
-			remote_manager(private_t, socket client_socket, std::string_view secret);
+			remote_manager
+			(
+				private_t, socket client_socket, std::string_view secret,
+				paging mode, std::size_t threshold, bool compression
+			);
 
 			//! Determines the manager's locality as being remote
 			virtual inline at get_locality() const noexcept final override
@@ -113,9 +387,32 @@ namespace ce2103::mm
 				return at::remote;
 			}
 
+			/*!
+			 * \brief Returns the way in which remote accesses are trapped,
+			 *        which differs from the requested one on fallback.
+			 */
+			paging get_paging() const noexcept;
+
+			//! Returns the number of remote pages shared by packed allocations.
+			std::size_t get_packed_page_count() const;
+
+			/*!
+			 * \brief Returns the number of parts which have a page in the
+			 *        trap region. Allocations beyond it fail.
+			 */
+			std::size_t get_part_capacity() const noexcept;
+
 			//! Hints of a read or write to the given address in the near future.
 			virtual void probe(const void* address, bool for_write = false) final override;
 
+			/*!
+			 * \brief Writes back every dirty page, waiting until the server
+			 *        has received them. Writebacks are otherwise delayed
+			 *        and batched. Throws if any of them failed, unless the
+			 *        failure was already reported by an access to its page.
+			 */
+			virtual void flush() final override;
+
 			//! Returns the allocation header for a given ID.
 			virtual allocation& get_base_of(std::size_t id) final override;
 
@@ -123,6 +420,67 @@ namespace ce2103::mm
 			client_session client;    //!< Active session
 			void*          trap_base; //!< Start of the virtual trap region
 
+			//! Additional sessions which join 'client', for concurrent page transfers
+			std::vector<std::unique_ptr<client_session>> channels;
+
+			//! Allocations of at least this size are paged in chunks, zero if disabled
+			std::size_t large_threshold;
+
+			//! Largest allocation, header included, which is packed into a shared page
+			static constexpr std::size_t MAX_PACKED_SIZE = 256;
+
+			//! Size and alignment granularity of packed allocations
+			static constexpr std::size_t PACKED_GRANULE = 16;
+
+			/*!
+			 * \brief Set in the IDs of packed allocations, which the server
+			 *        doesn't know of. Pointers only keep the lower 61 bits.
+			 */
+			static constexpr std::size_t PACKED_ID_BIT = std::size_t{1} << (sizeof(std::size_t) * CHAR_BIT - 4);
+
+			//! Set in the IDs of large allocations, which are otherwise chunk numbers
+			static constexpr std::size_t LARGE_ID_BIT = PACKED_ID_BIT >> 1;
+
+			//! A remote page shared by packed allocations of the same block size
+			struct packed_page
+			{
+				std::size_t                block_size; //!< Size of every block in the page
+				std::vector<std::uint32_t> references; //!< Reference count per block, zero if free
+				std::vector<std::size_t>   free_list;  //!< Indices of free blocks
+			};
+
+			//! Protects packed allocation state
+			mutable std::mutex packing_mutex;
+
+			//! Pages shared by packed allocations, by remote ID
+			ce2103::hash_map<std::size_t, packed_page> packed_pages;
+
+			//! IDs of shared pages that have free blocks, by block size class
+			std::vector<std::size_t> partial_pages[MAX_PACKED_SIZE / PACKED_GRANULE];
+
+			//! A large allocation, made of consecutive remote objects of one chunk each
+			struct large_object
+			{
+				std::size_t first_id; //!< Remote ID of the first chunk
+				std::size_t chunks;   //!< Number of chunks
+			};
+
+			//! Protects large allocation state
+			std::mutex chunk_mutex;
+
+			//! Large allocations, by the chunk number at which they start
+			ce2103::hash_map<std::size_t, large_object> large_objects;
+
+			/*!
+			 * \brief Lengths of freed runs of chunks, by the chunk at which
+			 *        they start. Adjacent runs are always merged, and none
+			 *        reaches next_chunk.
+			 */
+			std::map<std::size_t, std::size_t> free_chunk_runs;
+
+			//! Chunks from this one onwards are unused
+			std::size_t next_chunk = 0;
+
 			//! Throws a netwok error
 			[[noreturn]]
 			static void throw_network_failure();
@@ -133,7 +491,11 @@ namespace ce2103::mm
 				std::size_t size, const std::type_info& type
 			) final override;
 
-			//! Increments the reference count of an allocation/
+			/*!
+			 * \brief Increments the reference count of an allocation. The
+			 *        request is pipelined, so a failure is only noticed (and
+			 *        thrown) by the next operation which awaits a response.
+			 */
 			virtual void do_lift(std::size_t id) final override;
 
 			//! Decrements the reference count of an allocation/
@@ -142,15 +504,91 @@ namespace ce2103::mm
 			//! Hints the end of a write operation.
 			virtual void do_evict(std::size_t id) final override;
 
+			//! Whether an ID refers to a packed allocation
+			static inline bool is_packed(std::size_t id) noexcept
+			{
+				return (id & PACKED_ID_BIT) != 0;
+			}
+
+			//! Whether an ID refers to a large allocation
+			static inline bool is_large(std::size_t id) noexcept
+			{
+				return (id & LARGE_ID_BIT) != 0;
+			}
+
+			/*!
+			 * \brief Checks the response to an allocation of paged parts.
+			 *        Parts with IDs beyond get_part_capacity() would have
+			 *        no page in the trap region, so they are freed again.
+			 *
+			 * \param id    ID of the first part, std::nullopt on network failure
+			 * \param parts number of parts in the allocation
+			 *
+			 * \return the ID of the first part
+			 */
+			std::size_t accept_parts(std::optional<std::size_t> id, std::size_t parts);
+
+			//! Reserves a block for a small allocation within a shared page.
+			std::size_t allocate_packed(std::size_t size);
+
+			/*!
+			 * \brief Locates a packed allocation. packing_mutex must be held.
+			 *
+			 * \return the shared page and the index of the block within it
+			 */
+			std::pair<packed_page*, std::size_t> find_packed(std::size_t id);
+
+			/*!
+			 * \brief Decrements the reference count of a packed allocation,
+			 *        destroying it and freeing its block if none remain.
+			 *        The shared page is freed along with its last block.
+			 */
+			drop_result drop_packed(std::size_t id);
+
+			/*!
+			 * \brief Reserves a run of chunks for a large allocation. The
+			 *        first free run that is long enough is split, if any.
+			 *
+			 * \return allocation ID, or nothing if the chunk area is full
+			 */
+			std::optional<std::size_t> allocate_large(std::size_t size, const std::type_info& type);
+
+			//! Returns a run of chunks to the free runs. chunk_mutex must be held.
+			void free_chunks(std::size_t chunk, std::size_t chunks);
+
+			/*!
+			 * \brief Decrements the reference count of a large allocation,
+			 *        destroying it and freeing its chunks if none remain.
+			 */
+			drop_result drop_large(std::size_t id);
+
+			/*!
+			 * \brief Connects the additional sessions for page transfers.
+			 *        Their number is taken from MM_FAULT_CHANNELS, if set.
+			 *        Channels that fail to connect are silently omitted.
+			 */
+			void open_channels(std::string_view secret, bool compression);
+
 			/*!
 			 * \brief Seizes a (very large) region of virtual address space
 			 *        for remote memory.
 			 */
-			void install_trap_region();
+			void install_trap_region(paging mode);
 
 			//! Returns the size of a part (virtual page).
 			std::size_t get_part_size() const noexcept;
 
+			//! Returns the size of a chunk of a large allocation.
+			std::size_t get_chunk_size() const noexcept;
+
+			//! Returns the number of chunks that fit in the trap region.
+			std::size_t get_chunk_capacity() const noexcept;
+			/*!
+			 * \brief Tells the fault handler which remote object holds
+			 *        a chunk. discard() forgets this association.
+			 */
+			void bind_chunk(std::size_t chunk, std::size_t id);
+
 			/*!
 			 * \brief Speculates the given allocation to contain
 			 *        only the given amount of zero bytes, which is a
@@ -159,6 +597,12 @@ namespace ce2103::mm
 			 *        allocated objects.
 			 */
 			void wipe(std::size_t id, std::size_t size);
+
+			/*!
+			 * \brief Forgets any local copy of a part without writing
+			 *        it back, as done before the part is freed.
+			 */
+			void discard(std::size_t id);
 	};
 }
 
@@ -39,6 +39,9 @@ namespace ce2103::mm::_detail
 		debug_chain(debug_chain* previous, std::string key, void* value) noexcept;
 	};
 
+	//! Whether a debug channel is available. debug_log() does nothing otherwise.
+	bool is_debug_enabled() noexcept;
+
 	//! Base case for debug_log() (see below)
 	void debug_log(debug_chain* last);
 
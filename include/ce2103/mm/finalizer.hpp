@@ -0,0 +1,104 @@
+#ifndef CE2103_MM_FINALIZER_HPP
+#define CE2103_MM_FINALIZER_HPP
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <condition_variable>
+
+#include "ce2103/mm/gc.hpp"
+
+namespace ce2103::mm::_detail
+{
+	/*!
+	 * \brief Destroys and frees dead allocations on behalf of the GC
+	 *        thread, using a fixed set of worker threads. Each worker
+	 *        owns a task queue and steals from the others when idle.
+	 */
+	class finalizer_pool
+	{
+		public:
+			//! Arrays larger than this are destroyed in chunks of this many bytes.
+			static constexpr std::size_t CHUNK_SIZE = 64 << 10;
+
+			//! Starts the given number of worker threads.
+			explicit finalizer_pool(std::size_t threads);
+
+			//! Waits for pending work and then stops all workers.
+			~finalizer_pool();
+
+			finalizer_pool(const finalizer_pool&) = delete;
+			finalizer_pool& operator=(const finalizer_pool&) = delete;
+
+			//! Returns the number of worker threads.
+			inline std::size_t get_thread_count() const noexcept
+			{
+				return this->workers.size();
+			}
+
+			/*!
+			 * \brief Schedules the destruction and deallocation of a batch of
+			 *        unreachable allocations. Large arrays are split into
+			 *        element chunks, which might run in parallel.
+			 */
+			void submit(std::vector<allocation*> batch);
+
+			//! Helps with pending work until all submitted work is done.
+			void wait();
+
+		private:
+			//! A batch of whole allocations, or a range of elements of one array
+			struct task
+			{
+				std::vector<allocation*> batch; //!< Allocations to destroy and free
+				allocation*              array = nullptr; //!< Chunked array, if 'batch' is empty
+				std::size_t              first = 0;       //!< First element of the chunk
+				std::size_t              last  = 0;       //!< One-past-the-end of the chunk
+			};
+
+			//! Task queue of a single thread
+			struct alignas(64) queue
+			{
+				std::mutex       mutex;
+				std::deque<task> tasks;
+			};
+
+			std::vector<std::thread> workers; //!< Worker threads
+
+			//! One queue per worker, plus one for the submitting thread
+			std::unique_ptr<queue[]> queues;
+
+			std::mutex              mutex;      //!< Protects sleeping and termination
+			std::condition_variable work_ready; //!< Signaled when tasks are queued
+			std::condition_variable drained;    //!< Signaled when 'unfinished' drops to zero
+
+			std::size_t              queued = 0;     //!< Tasks in queues, under 'mutex'
+			std::atomic<std::size_t> unfinished = 0; //!< Tasks submitted and not yet completed
+			std::size_t              next_queue = 0; //!< Round-robin target for submissions
+			bool                     stopping = false;
+
+			//! Main loop of a worker thread.
+			void work(std::size_t index);
+
+			//! Places a task in a queue and wakes a worker.
+			void push(task&& work);
+
+			/*!
+			 * \brief Pops from the queue of 'index', or steals from
+			 *        the others if it is empty.
+			 */
+			bool take(std::size_t index, task& output);
+
+			//! Destroys and frees what a task refers to.
+			static void run(task& work);
+
+			//! Marks a task as completed.
+			void finish();
+	};
+}
+
+#endif
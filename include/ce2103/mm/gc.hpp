@@ -3,10 +3,15 @@
 
 #include <tuple>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
 #include <thread>
 #include <string>
+#include <vector>
 #include <utility>
 #include <cstddef>
+#include <cstdint>
 #include <typeinfo>
 #include <type_traits>
 #include <condition_variable>
@@ -32,6 +37,64 @@ namespace ce2103::mm::_detail
 	//! Variant of debug_log() which transmits objects' IDs and localitis
 	template<typename... PairTypes>
 	void memory_debug_log(const char* operation, std::size_t id, at locality, PairTypes&&... pairs);
+
+	/*!
+	 * \brief Distance in bytes between an allocation header and the
+	 *        first object of an allocation of T objects.
+	 */
+	template<typename T>
+	constexpr std::size_t get_header_offset() noexcept;
+
+	template<typename T, template<class> class Derived>
+	class ptr_base;
+
+	class finalizer_pool;
+}
+
+namespace ce2103::mm
+{
+	/*!
+	 * \brief Enumerates the managed pointers held by an object, for the
+	 *        purpose of cycle collection.
+	 *
+	 * Allocations of VSPtr<T> are traced automatically. Classes which hold
+	 * VSPtr fields take part in cycle collection by defining a member
+	 * 'void trace(ce2103::mm::tracer& visitor) const' that calls
+	 * visitor(field) for each one of them.
+	 */
+	class tracer
+	{
+		public:
+			//! Reports a pointer held by the object being traced.
+			template<typename T, template<class> class Derived>
+			void operator()(const _detail::ptr_base<T, Derived>& pointer);
+
+		protected:
+			~tracer() = default;
+
+		private:
+			//! Called for every local pointer that is not nullptr.
+			virtual void visit(std::size_t id) = 0;
+	};
+}
+
+namespace ce2103::mm::_detail
+{
+	//! Tests for a 'void trace(tracer&) const' member
+	template<typename T, typename = void>
+	struct has_trace_member : std::false_type
+	{};
+
+	template<typename T>
+	struct has_trace_member
+	<
+		T, std::void_t<decltype(std::declval<const T&>().trace(std::declval<tracer&>()))>
+	> : std::true_type
+	{};
+
+	//! Whether objects of type T might hold managed pointers
+	template<typename T>
+	constexpr bool is_traceable = std::is_invocable_v<tracer&, const T&> || has_trace_member<T>::value;
 }
 
 namespace ce2103::mm
@@ -44,6 +107,8 @@ namespace ce2103::mm
 	class allocation
 	{
 		friend class memory_manager;
+		friend class garbage_collector;
+		friend class _detail::finalizer_pool;
 
 		public:
 			//! Finishes allocation setup by indicating the total object count.
@@ -85,8 +150,8 @@ namespace ce2103::mm
 				//! Type RTTI
 				const std::type_info& rtti;
 
-				//! Type's destructor
-				void (*const destructor)(void* object);
+				//! Destroys contiguous objects. nullptr if trivially destructible.
+				void (*const destroy_n)(void* first, std::size_t count);
 
 				//! sizeof(T)
 				std::size_t size;
@@ -96,41 +161,127 @@ namespace ce2103::mm
 
 				void (*const represent)(void* object, std::size_t count, std::string& output);
 
+				//! Enumerates held pointers. nullptr if T can't hold any.
+				void (*const trace)(const void* object, std::size_t count, tracer& visitor);
+
 				//! Constructs a type metadata record
 				inline constexpr type
 				(
-					const std::type_info& rtti, void (*destructor)(void*),
+					const std::type_info& rtti, void (*destroy_n)(void*, std::size_t),
 					std::size_t size, std::size_t padding, 
-					void (*represent)(void*, std::size_t, std::string&)
+					void (*represent)(void*, std::size_t, std::string&),
+					void (*trace)(const void*, std::size_t, tracer&)
 				) noexcept
-				: rtti{rtti}, destructor{destructor}, size{size},
-				  padding{padding}, represent{represent}
+				: rtti{rtti}, destroy_n{destroy_n}, size{size},
+				  padding{padding}, represent{represent}, trace{trace}
 				{}
 			};
 
+			//! State of an allocation during cycle collection
+			enum class cycle_color : std::uint8_t
+			{
+				black, // In use, or not visited
+				gray,  // Possible member of a garbage cycle
+				white  // Member of a garbage cycle
+			};
+
 			const type& payload_type; //!< Type information of the allocation payload
 			std::size_t count = 0;    //!< Number of objects in the allocation
 
+			//! Reference count. Only local managers maintain this field.
+			std::atomic<std::uint32_t> references = 1;
+
+			//! Whether this allocation is in the GC's cycle candidate buffer
+			std::atomic<bool> buffered = false;
+
+			//! Only accessed by the GC thread while collecting cycles
+			cycle_color color = cycle_color::black;
+
 			//! Constructs an allocation header with the given type information
 			inline allocation(const type& payload_type) noexcept
 			: payload_type{payload_type}
 			{}
 
 			//! Invokes the payload destructor on all non trivially-destructible objects
-			void destroy_all();
+			inline void destroy_all()
+			{
+				this->destroy_range(0, this->count);
+			}
+
+			//! Same as destroy_all(), but only for objects in [first, last)
+			void destroy_range(std::size_t first, std::size_t last);
 	};
 
 	/*!
 	 * \brief Communicates the object state after a drop operation.
 	 *
 	 * 'Reduced' indicates a refcount greater than one, 'hanging'
-	 * a refcount of one, and 'lost' one of zero.
+	 * a refcount of one, and 'lost' one of zero. 'Deferred' means
+	 * that the decrement was buffered and its outcome is not known yet.
 	 */
 	enum class drop_result
 	{
 		reduced,
 		hanging,
-		lost
+		lost,
+		deferred
+	};
+
+	//! Age groups of local allocations.
+	enum class generation
+	{
+		young, // Allocated since the last sweep
+		old    // Survived at least one sweep
+	};
+
+	//! Counters of the local GC for a single generation
+	struct generation_stats
+	{
+		std::size_t sweeps   = 0; //!< Completed sweeps of this generation
+		std::size_t freed    = 0; //!< Allocations freed by those sweeps
+		std::size_t promoted = 0; //!< Allocations that survived into the next generation
+
+		std::chrono::nanoseconds total_pause{0}; //!< Accumulated sweep time
+		std::chrono::nanoseconds max_pause{0};   //!< Longest single sweep
+	};
+
+	/*!
+	 * \brief Tunable parameters of the local GC scheduler. Defaults may
+	 *        be overriden by the environment variables in parentheses.
+	 */
+	struct gc_tuning
+	{
+		//! Dead allocations of a generation that trigger a sweep (MM_GC_DEAD_COUNT)
+		std::size_t dead_count = 64 << 10;
+
+		//! Dead bytes of a generation that trigger a sweep (MM_GC_DEAD_BYTES)
+		std::size_t dead_bytes = 16 << 20;
+
+		//! Sweep period while there is garbage (MM_GC_MIN_PERIOD_MS)
+		std::chrono::milliseconds min_period{100};
+
+		//! Longest period reached by backing off while idle (MM_GC_MAX_PERIOD_MS)
+		std::chrono::milliseconds max_period{10'000};
+
+		//! Longest time between major sweeps, if any are due (MM_GC_MAJOR_PERIOD_MS)
+		std::chrono::milliseconds major_period{5'000};
+
+		/*!
+		 * \brief Threads that destroy dead objects besides the GC thread
+		 *        (MM_GC_FINALIZERS). Defaults to one less than the number
+		 *        of hardware threads, up to three.
+		 */
+		std::size_t finalizer_threads = 0;
+	};
+
+	//! Counters of the local GC scheduler
+	struct gc_schedule_stats
+	{
+		std::size_t timeouts = 0; //!< Wake-ups due to the current period expiring
+		std::size_t triggers = 0; //!< Wake-ups due to crossing a dead threshold
+		std::size_t requests = 0; //!< Calls to collect() or collect_cycles()
+		std::size_t sweeps   = 0; //!< Sweeps performed, of either generation
+		std::size_t idle     = 0; //!< Sweeps which had nothing to free
 	};
 
 	/*!
@@ -199,6 +350,14 @@ namespace ce2103::mm
 			)
 			{}
 
+			/*!
+			 * \brief Waits until all previous writes have reached the
+			 *        backing storage. Writes which are followed by evict()
+			 *        may be delayed until then, but eventually complete.
+			 */
+			virtual inline void flush()
+			{}
+
 			//! Determines the allocation header from an ID.
 			virtual allocation& get_base_of(std::size_t id) = 0;
 
@@ -224,7 +383,27 @@ namespace ce2103::mm
 			{}
 	};
 
-	//! A local mananger which frees memory periodically
+	/*!
+	 * \brief A local mananger which frees memory periodically.
+	 *
+	 * Allocations are split in two generations. IDs allocated since the
+	 * last sweep form the nursery, and objects that die there are freed
+	 * by frequent minor sweeps. Those which survive a sweep are promoted
+	 * to the old generation, whose dead are only freed by major sweeps.
+	 *
+	 * Sweeps happen early when enough garbage accumulates (see gc_tuning).
+	 * The sweep period doubles after each sweep that frees nothing.
+	 *
+	 * Destructors of dead objects might run on the GC thread or on any
+	 * finalizer thread. Within a sweep, distinct objects are destroyed in
+	 * an unspecified order and possibly concurrently, and so are chunks
+	 * of a large array (elements within a chunk are destroyed in order).
+	 * The memory of an allocation is released only after all of its
+	 * objects are destroyed. Objects that become unreachable because of
+	 * a destructor are destroyed later in the same sweep (or, if they are
+	 * old and the sweep is minor, by a later sweep). collect() returns
+	 * only after every destructor it caused has finished.
+	 */
 	class garbage_collector : public memory_manager
 	{
 		public:
@@ -243,29 +422,292 @@ namespace ce2103::mm
 			//! Returns the allocation header for a given ID
 			virtual allocation& get_base_of(std::size_t id) final override;
 
+			using memory_manager::lift;
+			using memory_manager::drop;
+
+			/*!
+			 * \brief Lock-free variant of lift() for callers which
+			 *        already know the address of the allocation header.
+			 *        If references are deferred, a decrement of the same
+			 *        allocation still buffered by this thread is cancelled
+			 *        instead of incrementing the refcount.
+			 */
+			static inline void lift(allocation& header, std::size_t id) noexcept
+			{
+				if(!defers_references.load(std::memory_order_relaxed)
+				|| !cancel_deferred_drop(header))
+				{
+					header.references.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				_detail::memory_debug_log("lift", id, at::local);
+			}
+
+			/*!
+			 * \brief Lock-free variant of drop() for callers which already
+			 *        know the address of the allocation header. Only the
+			 *        transition to zero touches the allocation table. If
+			 *        references are deferred, the decrement is buffered by
+			 *        the calling thread and drop_result::deferred is returned.
+			 */
+			static drop_result drop(allocation& header, std::size_t id);
+
+			/*!
+			 * \brief Selects whether lift() and drop() on allocation headers
+			 *        defer decrements. Each thread buffers them, coalesced by
+			 *        allocation, until its buffer fills, flush_deferred() is
+			 *        called or the thread exits. Normally chosen through the
+			 *        options given to initialize(). Disabled by default.
+			 */
+			static void set_deferred_references(bool enabled) noexcept;
+
+			/*!
+			 * \brief Applies the decrements buffered by the calling thread.
+			 *        Objects are only freed once every thread that dropped
+			 *        their last references has flushed. collect() and
+			 *        collect_cycles() flush the calling thread first.
+			 */
+			static void flush_deferred();
+
+			/*!
+			 * \brief Increments by 'times' the reference count of every
+			 *        allocation in [first, first + count). Each shard lock
+			 *        is taken once for all the IDs that it owns within the
+			 *        range, which is once for contiguous IDs.
+			 */
+			void lift_range(std::size_t first, std::size_t count, std::uint32_t times = 1);
+
+			/*!
+			 * \brief Decrements once the reference count of every allocation
+			 *        in [first, first + count), locking as lift_range() does.
+			 *        Decrements are never deferred.
+			 *
+			 * \return result of each drop, in ID order
+			 */
+			std::vector<drop_result> drop_range(std::size_t first, std::size_t count);
+
+			/*!
+			 * \brief Enforces that, if no other operation is performed by
+			 *        the calling thread, the following given number of
+			 *        allocations will be contiguous and ordered in the ID
+			 *        namespace. Ranges longer than an ID block take several
+			 *        consecutive blocks.
+			 *
+			 * \throws std::bad_alloc if the ID namespace is exhausted
+			 */
+			void require_contiguous_ids(std::size_t ids);
+
+			/*!
+			 * \brief Wakes up the GC and waits until it has freed all
+			 *        allocations that were unreachable at the time of the call,
+			 *        without waiting for the next GC period.
+			 *
+			 * \return number of allocations freed by the sweep
+			 */
+			std::size_t collect();
+
+			/*!
+			 * \brief Enables or disables the recording of possible cycle
+			 *        roots, which collect_cycles() relies upon. Disabled
+			 *        by default. Cycles are only ever collected on request,
+			 *        never implicitly (not even when the GC terminates).
+			 */
+			static void set_cycle_collection(bool enabled) noexcept;
+
+			/*!
+			 * \brief Held by the caller of collect_cycles() to assert that
+			 *        every other thread which might create, copy or destroy
+			 *        local pointers, or access objects that hold them, is
+			 *        stopped for as long as it exists. How those threads are
+			 *        stopped is up to the caller, since the library has no
+			 *        way to do so. Only one may exist at a time; others wait.
+			 */
+			class stopped_world
+			{
+				public:
+					stopped_world();
+
+					stopped_world(const stopped_world& other) = delete;
+
+					stopped_world& operator=(const stopped_world& other) = delete;
+
+				private:
+					//! Serializes holders, see garbage_collector::world_mutex
+					std::lock_guard<std::mutex> lock;
+			};
+
+			/*!
+			 * \brief Same as collect(), but then also frees garbage reference
+			 *        cycles that are reachable from allocations whose refcount
+			 *        was decremented, but not to zero, while cycle collection
+			 *        was enabled (trial deletion).
+			 *
+			 * Trial deletion temporarily alters refcounts and reads pointers
+			 * within objects without synchronization, so it is only sound while
+			 * no other thread mutates the object graph. The caller must prove
+			 * so by holding a stopped_world.
+			 *
+			 * \return number of allocations freed, including cycles
+			 */
+			std::size_t collect_cycles(const stopped_world& world);
+
+			//! Returns a snapshot of the counters of a generation.
+			generation_stats get_stats(generation which) const;
+
+			//! Returns a snapshot of the scheduler counters.
+			gc_schedule_stats get_schedule_stats() const;
+
+			//! Retrieves the current scheduler parameters.
+			gc_tuning get_tuning() const;
+
+			//! Replaces the scheduler parameters. Takes effect after the next wake-up.
+			void set_tuning(const gc_tuning& tuning);
+
+			//! Power-of-two order of the number of allocation table shards
+			static constexpr std::size_t SHARD_ORDER = 4;
+
+			//! Number of allocation table shards
+			static constexpr std::size_t SHARD_COUNT = sizeof(char) << SHARD_ORDER;
+
+			//! Power-of-two order of the number of IDs in an ID block
+			static constexpr std::size_t SHARD_SPAN_ORDER = 20;
+
 			/*!
-			 * \brief Enforces that, if no other operation is performed,
-			 *        the following given number of allocations will be
-			 *        contiguous and ordered in the ID namespace.
+			 * \brief Number of consecutive IDs in an ID block. Blocks are
+			 *        handed out in increasing order to whichever shard runs
+			 *        out of IDs first, so that the ID namespace stays dense.
 			 */
-			void require_contiguous_ids(std::size_t ids) noexcept;
+			static constexpr std::size_t SHARD_SPAN = sizeof(char) << SHARD_SPAN_ORDER;
+
+			//! Number of ID blocks, which bounds the ID namespace
+			static constexpr std::size_t MAX_BLOCKS = sizeof(char) << 16;
 
 		private:
-			//! Map of ID-(refcount, allocation header) pairs for each allocation.
-			hash_map<std::size_t, std::pair<std::size_t, allocation*>> allocations;
+			/*!
+			 * \brief A partition of the allocation table. Each one owns a
+			 *        disjoint subset of the ID namespace and is protected by
+			 *        its own lock, so that unrelated operations don't contend.
+			 */
+			struct alignas(64) shard
+			{
+				//! Map of ID-allocation header pairs for each allocation.
+				hash_map<std::size_t, allocation*> allocations;
+
+				//! Young IDs whose refcount has reached zero since the last sweep.
+				std::vector<std::size_t> young_dead;
+
+				//! Old IDs whose refcount has reached zero since the last major sweep.
+				std::vector<std::size_t> old_dead;
+
+				//! ID for the next allocation, owned by this shard unless equal to 'block_end'.
+				std::size_t next_id = 0;
+
+				//! End of the last blocks claimed by this shard, see claim_ids().
+				std::size_t block_end = 0;
+
+				/*!
+				 * \brief IDs are handed out in increasing order, so the nursery
+				 *        is the range [nursery_start, next_id).
+				 */
+				std::size_t nursery_start = 0;
+
+				//! Number of live allocations in the nursery.
+				std::size_t nursery_live = 0;
 
-			//! Tentative ID for the next allocation.
-			std::size_t next_id = 0;
+				//! IDs of possible cycle roots, see collect_cycles().
+				std::vector<std::size_t> candidates;
 
-			//! Used to guarantee thread-safety.
+				//! Used to guarantee thread-safety of this shard.
+				mutable std::mutex mutex;
+			};
+
+			//! Allocation table shards. IDs are mapped to shards by get_shard_of().
+			shard shards[SHARD_COUNT];
+
+			//! Index of the owner shard of each ID block, zero if unclaimed
+			std::atomic<std::uint8_t> block_owners[MAX_BLOCKS] = {};
+
+			//! First ID block that no shard has claimed yet
+			std::size_t next_block = 0;
+
+			//! Protects 'next_block'. May be taken while holding a shard lock.
+			std::mutex block_mutex;
+
+			//! Protects GC thread state, but not the allocation table.
 			mutable std::mutex mutex;
 
+			//! Held by the stopped_world instance, if any.
+			std::mutex world_mutex;
+
 			//! Main GC loop thread.
 			std::thread thread;
 
 			//! Used to explicitly wake the GC outside of its period.
 			std::condition_variable wakeup;
 
+			//! Signaled by the GC thread whenever a sweep completes.
+			std::condition_variable swept;
+
+			std::size_t requested_sweeps = 0; //!< Serial number of the last collect() request
+			std::size_t completed_sweeps = 0; //!< Last request served by a completed sweep
+			std::size_t last_freed       = 0; //!< Allocations freed by the last major sweep
+			std::size_t cycles_requested = 0; //!< Last request which asked for cycle collection
+			bool        sweep_triggered  = false; //!< A dead threshold was crossed
+
+			generation_stats young_stats; //!< Counters of minor sweeps
+			generation_stats old_stats;   //!< Counters of major sweeps
+
+			gc_schedule_stats schedule_stats; //!< Scheduler counters
+			gc_tuning         tuning;         //!< Scheduler parameters
+
+			/*!
+			 * \brief Garbage accumulated by a generation since its last sweep.
+			 *        Updated without taking any lock.
+			 */
+			struct alignas(64) dead_counter
+			{
+				std::atomic<std::size_t> count = 0; //!< Allocations
+				std::atomic<std::size_t> bytes = 0; //!< Total size, including headers
+
+				//! Whether a sweep has been triggered by this counter
+				std::atomic<bool> triggered = false;
+			};
+
+			//! Dead counters, indexed by generation
+			dead_counter pending[2];
+
+			//! Parallel finalizers. Only accessed by the GC thread.
+			std::unique_ptr<_detail::finalizer_pool> finalizers;
+
+			//! Copy of tuning.dead_count, read without locking
+			std::atomic<std::size_t> dead_count_threshold;
+
+			//! Copy of tuning.dead_bytes, read without locking
+			std::atomic<std::size_t> dead_bytes_threshold;
+
+			//! Whether drops record cycle candidates
+			static inline std::atomic<bool> tracks_cycles = false;
+
+			//! Whether drops on allocation headers are buffered
+			static inline std::atomic<bool> defers_references = false;
+
+			//! Per-thread buffer of deferred decrements
+			struct reference_log;
+
+			//! Flushes the calling thread's log when it exits
+			struct reference_log_guard;
+
+			/*!
+			 * \brief Calling thread's deferred decrements, nullptr until its
+			 *        first deferred drop. The log itself is allocated on the
+			 *        heap, so that the library's static TLS block stays small.
+			 */
+			[[gnu::tls_model("initial-exec")]]
+			static thread_local reference_log* deferred_drops;
+
+			//! Flushes and frees 'deferred_drops' at thread exit. Constructed on first use.
+			static thread_local reference_log_guard deferred_drops_guard;
+
 			//! Initializes the GC thread on construction.
 			garbage_collector();
 
@@ -299,14 +741,142 @@ namespace ce2103::mm
 
 			//! Main GC loop.
 			void main_loop();
+
+			//! Schedules an allocation whose refcount has reached zero for collection.
+			void mark_dead(const allocation& header, std::size_t id);
+
+			/*!
+			 * \brief Immediately subtracts 'count' from the refcount of an
+			 *        allocation, with the same effects as that many drops.
+			 */
+			static drop_result release(allocation& header, std::size_t id, std::uint32_t count);
+
+			//! Buffers a decrement in the calling thread's log, flushing it if full.
+			static void defer_drop(allocation& header, std::size_t id);
+
+			//! Removes a decrement from the calling thread's log, if there is any.
+			static bool cancel_deferred_drop(allocation& header) noexcept;
+
+			/*!
+			 * \brief Records a possible cycle root after a drop that
+			 *        did not bring its refcount to zero.
+			 */
+			static inline void buffer_candidate(allocation& header, std::size_t id)
+			{
+				if(tracks_cycles.load(std::memory_order_relaxed)
+				&& header.payload_type.trace != nullptr
+				&& !header.buffered.load(std::memory_order_relaxed)
+				&& !header.buffered.exchange(true, std::memory_order_relaxed))
+				{
+					auto& shard = get_instance().get_shard_of(id);
+
+					std::lock_guard lock{shard.mutex};
+					shard.candidates.push_back(id);
+				}
+			}
+
+			/*!
+			 * \brief Synchronous trial deletion over the candidate buffer.
+			 *        Must only be called by the GC thread, on behalf of
+			 *        collect_cycles() while its caller holds the world stopped.
+			 *
+			 * \return number of allocations freed
+			 */
+			std::size_t free_cycles();
+
+			/*!
+			 * \brief Appends an ID to the dead list of its generation. The
+			 *        owner shard must be locked by the caller.
+			 *
+			 * \return whether a dead threshold has just been crossed
+			 */
+			bool push_dead(shard& owner, std::size_t id, std::size_t size);
+
+			//! Wakes the GC thread early. No shard may be locked by the caller.
+			void trigger_sweep();
+
+			/*!
+			 * \brief Frees everything in the young dead lists, and in the old
+			 *        ones too if 'major' is set, walking the shards one at a
+			 *        time. Shard locks are released while objects are being
+			 *        destroyed, one batch at a time. The nursery of each shard
+			 *        is promoted after its dead have been freed.
+			 *
+			 * \param promoted set to the number of promoted allocations
+			 *
+			 * \return number of allocations that were freed
+			 */
+			std::size_t sweep(bool major, std::size_t& promoted);
+
+			//! Returns the shard which owns the given ID.
+			inline shard& get_shard_of(std::size_t id) noexcept
+			{
+				// IDs out of bounds are never allocated, so any shard would do
+				std::size_t block = id >> SHARD_SPAN_ORDER;
+				std::size_t owner = block < MAX_BLOCKS
+				                  ? this->block_owners[block].load(std::memory_order_relaxed) : 0;
+
+				return this->shards[owner];
+			}
+
+			//! Returns the shard from which the calling thread allocates IDs.
+			shard& get_home_shard() noexcept;
+
+			/*!
+			 * \brief Makes at least 'ids' consecutive IDs available to a
+			 *        shard, starting at its 'next_id', by claiming as many new
+			 *        blocks as needed. The blocks of the shard are extended in
+			 *        place if no other shard has claimed any block since.
+			 *        The owner shard must be locked by the caller.
+			 *
+			 * \throws std::bad_alloc if the ID namespace is exhausted
+			 */
+			void claim_ids(shard& owner, std::size_t ids);
 	};
 
+	inline drop_result garbage_collector::drop(allocation& header, std::size_t id)
+	{
+		drop_result result = drop_result::deferred;
+		if(defers_references.load(std::memory_order_relaxed))
+		{
+			defer_drop(header, id);
+		} else
+		{
+			result = release(header, id, 1);
+		}
+
+		_detail::memory_debug_log("drop", id, at::local);
+		return result;
+	}
+
+	inline drop_result garbage_collector::release
+	(
+		allocation& header, std::size_t id, std::uint32_t count
+	)
+	{
+		std::uint32_t previous = header.references.fetch_sub(count, std::memory_order_acq_rel);
+		if(previous == count)
+		{
+			get_instance().mark_dead(header, id);
+			return drop_result::lost;
+		}
+
+		buffer_candidate(header, id);
+		return previous == count + 1 ? drop_result::hanging : drop_result::reduced;
+	}
+
 	template<typename... PairTypes>
 	void _detail::memory_debug_log
 	(
 		const char* operation, std::size_t id, at locality, PairTypes&&... pairs
 	)
 	{
+		// Avoids building debug messages for nobody
+		if(!is_debug_enabled())
+		{
+			return;
+		}
+
 		const char* locality_name;
 		switch(locality)
 		{
@@ -330,20 +900,33 @@ namespace ce2103::mm
 		);
 	}
 
+	template<typename T>
+	constexpr std::size_t _detail::get_header_offset() noexcept
+	{
+		if constexpr(std::is_void_v<T>)
+		{
+			return 0;
+		} else
+		{
+			return sizeof(allocation) + (alignof(T) - alignof(allocation) % alignof(T)) % alignof(T);
+		}
+	}
+
 	template<typename T>
 	std::tuple<std::size_t, allocation*, T*> memory_manager::allocate_of
 	(
 		std::size_t count, bool always_array
 	)
 	{
-		constexpr auto padding = (alignof(T) - alignof(allocation) % alignof(T)) % alignof(T);
-		constexpr auto header_size = sizeof(allocation) + padding;
+		constexpr auto header_size = _detail::get_header_offset<T>();
+		constexpr auto padding = header_size - sizeof(allocation);
 
-		constexpr void (*destructor)(void* object)
+		// Instantiated per type, so that the loop can be inlined and unrolled
+		constexpr void (*destroy_n)(void* first, std::size_t count)
 			= !std::is_trivially_destructible_v<T>
-			? static_cast<void(*)(void*)>([](void* object)
+			? static_cast<void(*)(void*, std::size_t)>([](void* first, std::size_t count)
 			{
-				static_cast<T*>(object)->~T();
+				std::destroy_n(static_cast<T*>(first), count);
 			})
 			: nullptr;
 
@@ -367,14 +950,35 @@ namespace ce2103::mm
 			}
 		};
 
+		constexpr void (*trace)(const void*, std::size_t, tracer&)
+			= _detail::is_traceable<T>
+			? static_cast<void(*)(const void*, std::size_t, tracer&)>([]
+			(
+				const void* object_base, std::size_t count, tracer& visitor
+			)
+			{
+				for(const T* object = static_cast<const T*>(object_base);
+				    object < static_cast<const T*>(object_base) + count; ++object)
+				{
+					if constexpr(std::is_invocable_v<tracer&, const T&>)
+					{
+						visitor(*object);
+					} else if constexpr(_detail::has_trace_member<T>::value)
+					{
+						object->trace(visitor);
+					}
+				}
+			})
+			: nullptr;
+
 		static constexpr allocation::type type_of_single
 		{
-			typeid(T), destructor, sizeof(T), padding, represent_single
+			typeid(T), destroy_n, sizeof(T), padding, represent_single, trace
 		};
 
 		static constexpr allocation::type type_of_array
 		{
-			typeid(T[]), destructor, sizeof(T), padding,
+			typeid(T[]), destroy_n, sizeof(T), padding,
 			[](void* object, std::size_t count, std::string& output)
 			{
 				output.push_back('[');
@@ -389,7 +993,8 @@ namespace ce2103::mm
 				}
 
 				output.push_back(']');
-			}
+			},
+			trace
 		};
 
 		const auto& type = count == 1 && !always_array ? type_of_single : type_of_array;
@@ -1,13 +1,52 @@
 #ifndef CE2103_INIT_HPP
 #define CE2103_INIT_HPP
 
+#include <cstddef>
+
 namespace ce2103::mm
 {
+	//! Ways to maintain the reference counts of local objects.
+	enum class refcounting
+	{
+		immediate, // Every copy and destruction updates the count
+		deferred   // Decrements are buffered and coalesced by each thread
+	};
+
+	//! Ways to trap accesses to remote memory.
+	enum class paging
+	{
+		signals,    // SIGSEGV on protected pages, always available
+		userfaultfd // userfaultfd(2), falls back to signals if unavailable
+	};
+
+	//! Library settings. Only those given to the first initialization apply.
+	struct options
+	{
+		//! See garbage_collector::set_deferred_references()
+		refcounting local_references = refcounting::immediate;
+
+		//! See remote_manager::get_paging()
+		paging remote_paging = paging::signals;
+
+		/*!
+		 * \brief Remote allocations of at least this many bytes are paged
+		 *        in 2MiB chunks instead of pages. Zero disables this.
+		 */
+		std::size_t large_object_threshold = 0;
+
+		/*!
+		 * \brief Whether to compress remote page contents, if the server
+		 *        supports it. This only pays off on links slower than the
+		 *        compressor, roughly below 1GB/s.
+		 */
+		bool compress_remote_pages = false;
+	};
+
 	//! Initializes the library for local operation, ignoring network hints.
-	void initialize_local();
+	void initialize_local(const options& settings = {});
 
 	//! Initializes the library for local and (according to hints) remote operation.
-	void initialize();
+	void initialize(const options& settings = {});
 }
 
 #endif
@@ -0,0 +1,56 @@
+#ifndef CE2103_MM_OCTETS_HPP
+#define CE2103_MM_OCTETS_HPP
+
+#include <cstddef>
+
+namespace ce2103::mm::_detail
+{
+	/*!
+	 * \brief Shortest run of zero bytes which serialize_octets() replaces
+	 *        with a zero-fill count. Shorter runs would lengthen the output.
+	 */
+	constexpr std::size_t ZERO_RUN_LENGTH = 3;
+
+	//! Instruction sets for which octet kernels exist
+	enum class octet_isa
+	{
+		scalar, //!< Portable code, always available
+		sse2,   //!< 16 bytes at a time
+		avx2    //!< 32 bytes at a time
+	};
+
+	/*!
+	 * \brief Hex and zero-run kernels for session::serialize_octets() and
+	 *        session::deserialize_octets(). Every instruction set produces
+	 *        byte-identical results.
+	 */
+	struct octet_kernels
+	{
+		//! Instruction set of these kernels
+		octet_isa isa;
+
+		//! Writes two lowercase hex digits per input byte, 2 * length in total
+		void (*encode_hex)(const char* input, std::size_t length, char* output) noexcept;
+
+		/*!
+		 * \brief Reads two lowercase hex digits per output byte, 2 * length
+		 *        in total. Fails on any other character, in which case the
+		 *        output contents are unspecified.
+		 */
+		bool (*decode_hex)(const char* input, std::size_t length, char* output) noexcept;
+
+		//! Offset of the first run of ZERO_RUN_LENGTH zero bytes, or 'length' if none
+		std::size_t (*find_zero_run)(const char* input, std::size_t length) noexcept;
+
+		//! Offset of the first nonzero byte, or 'length' if none
+		std::size_t (*find_nonzero)(const char* input, std::size_t length) noexcept;
+	};
+
+	//! Returns the fastest kernels supported by the running CPU.
+	const octet_kernels& get_octet_kernels() noexcept;
+
+	//! Returns the kernels for a given instruction set, or nullptr if unsupported.
+	const octet_kernels* find_octet_kernels(octet_isa isa) noexcept;
+}
+
+#endif
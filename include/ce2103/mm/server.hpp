@@ -0,0 +1,193 @@
+#ifndef CE2103_MM_SERVER_HPP
+#define CE2103_MM_SERVER_HPP
+
+#include <memory>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <functional>
+
+#include "nlohmann/json.hpp"
+
+#include "ce2103/hash.hpp"
+#include "ce2103/network.hpp"
+#include "ce2103/hash_map.hpp"
+
+#include "ce2103/mm/session.hpp"
+
+namespace ce2103::mm
+{
+	/*!
+	 * \brief Server-side representation of a session. Objects are kept
+	 *        by the local garbage collector, on behalf of the client.
+	 */
+	class server_session : public session
+	{
+		public:
+			//! MD5 hash of a preshared key
+			using secret_hash = decltype(md5::of({}));
+
+			//! ID-to-(base, size) map of active objects.
+			using object_table = ce2103::hash_map<std::size_t, std::pair<char*, std::size_t>>;
+
+			//! Constructs a new session given a client socket and secret hash.
+			inline server_session(ce2103::socket client, const secret_hash& secret)
+			: session{std::move(client)}, secret{secret}
+			{}
+
+			//! Move-constructs a new session
+			server_session(server_session&& other) = default;
+
+			//! Destroys the session
+			~server_session();
+
+			//! Replaces the session with another one
+			server_session& operator=(server_session&& other) = default;
+
+			/*!
+			 * \brief Reads commands and processes them. Each command, or
+			 *        batch of write frames, is answered before the next one
+			 *        is read, so responses leave in request order, which
+			 *        pipelining clients rely on to match them.
+			 */
+			bool on_input();
+
+			//! Sets whether sessions that compress contents report how well it went as they end.
+			static void set_compression_reports(bool enabled) noexcept;
+
+		private:
+			//! MD5 hash of the preshared key
+			std::reference_wrapper<const secret_hash> secret;
+
+			/*!
+			 * \brief Active objects for this session, shared with any other
+			 *        sessions that joined it. Null if moved-from.
+			 */
+			std::shared_ptr<object_table> objects = std::make_shared<object_table>();
+
+			//! Token through which other sessions may join this one, if shared
+			std::optional<std::uint64_t> token;
+
+			//! Whether the client has been authorized
+			bool authorized = false;
+
+			//! Whether a write of the current batch of write frames has failed
+			bool batch_failed = false;
+
+			//! Performs a command given as a JSON value.
+			void execute(const nlohmann::json& command);
+
+			//! Reads a binary frame and performs its request.
+			void on_frame();
+
+			/*!
+			 * \brief Attempts to authorize the client with the given PSK hash.
+			 *
+			 * \param input       serialized hash
+			 * \param binary      whether the client proposed binary frames
+			 * \param batches     whether the client proposed range commands
+			 * \param compression whether the client proposed compressed
+			 *                    contents, which requires binary frames
+			 */
+			void authorize(const nlohmann::json& input, bool binary, bool batches, bool compression);
+
+			//! Finalizes the session.
+			void finalize();
+
+			//! Allows other sessions to join this one, replying with a token.
+			void share();
+
+			//! Joins the session that was shared with the given token.
+			void join(std::uint64_t token);
+
+			//! Allocates a new region of memory.
+			void allocate
+			(
+				std::size_t part_size, std::size_t parts,
+				std::size_t remainder, std::size_t initial_count
+			);
+
+			//! Incremnts an object's reference count.
+			void lift(std::size_t id);
+
+			//! Decrements an object's reference count.
+			void drop(std::size_t id);
+
+			//! Increments the reference count of every object in a [first, count] range.
+			void lift_range(const nlohmann::json& range);
+
+			/*!
+			 * \brief Decrements the reference count of every object in a
+			 *        [first, count] range, replying with the IDs which were
+			 *        left hanging and those which were lost.
+			 */
+			void drop_range(const nlohmann::json& range);
+
+			/*!
+			 * \brief Dumps the contents of every object in a [first, count]
+			 *        range, as that many read commands would. Since as many
+			 *        responses are due, a range longer than the number of
+			 *        objects in the session ends it.
+			 */
+			void read_range(const nlohmann::json& range);
+
+			//! Dumps the given object's memory contents to the client.
+			void read_contents(std::size_t id);
+
+			/*!
+			 * \brief Overwrites an object's memory contents. If an offset
+			 *        is given, only the range which starts there and spans
+			 *        the length of the contents is written. Failures are
+			 *        reported to the client, but success is not.
+			 *
+			 * \return whether the contents were written
+			 */
+			bool write_contents
+			(
+				std::size_t id, const nlohmann::json& contents,
+				std::optional<std::size_t> offset = std::nullopt
+			);
+
+			/*!
+			 * \brief Performs several writes, given as [id, contents] or
+			 *        [id, offset, contents] arrays (see write_contents()).
+			 *        A single response is sent, which reports the first
+			 *        failure, if any.
+			 */
+			void write_many(const nlohmann::json& batch);
+
+			/*!
+			 * \brief Writes the payload of a write frame straight into the
+			 *        object. Only the last frame of a batch is responded to,
+			 *        unless some earlier one fails (see write_many()).
+			 */
+			void write_frame(const frame_header& header);
+
+			//! Retrieves an active pair (see "objects"), otherwise reports client failure.
+			std::pair<char*, std::size_t>* expect_extant(std::size_t id) noexcept;
+
+			/*!
+			 * \brief Parses a [first, count] ID range. Ranges which are not
+			 *        well-formed are reported as bad requests.
+			 */
+			std::optional<std::pair<std::size_t, std::size_t>> expect_range(const nlohmann::json& range);
+
+			//! Same as expect_extant(), but for every ID of a range. Nothing is retrieved.
+			bool expect_extant_range(std::size_t first, std::size_t count) noexcept;
+
+			//! Sends an empty response ("{}")
+			void send_empty();
+
+			//! Fails with the given error message.
+			void send_error(const char* message);
+
+			//! Indicates an invalid client request.
+			void fail_bad_request();
+
+			//! Indicates an incorrect size in the client request.
+			void fail_wrong_size();
+	};
+}
+
+#endif
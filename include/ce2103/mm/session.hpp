@@ -5,7 +5,9 @@
 #include <utility>
 #include <variant>
 #include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <functional>
 #include <string_view>
 
 #include "nlohmann/json.hpp"
@@ -16,18 +18,84 @@ namespace ce2103::mm
 {
 	/*!
 	 * \brief Represents an active TCP session which communicates
-	 *        one JSON value per line.
+	 *        one JSON value per line or, once both ends agree to it
+	 *        during authorization, through binary frames.
+	 *
+	 * A binary frame is a fixed-layout header (see frame_header) followed
+	 * by a payload of raw bytes. Object contents travel as they are, while
+	 * any other message is a JSON value within a frame of its own.
+	 *
+	 * If also agreed to, contents of at least COMPRESSION_THRESHOLD bytes
+	 * may be compressed (see packing). Such payloads start with the size of
+	 * the contents, as a little-endian 32-bit integer.
 	 */
 	class session
 	{
 		public:
+			//! Counters of the compression stage, see is_compressed()
+			struct compression_stats
+			{
+				std::uint64_t packed_pages   = 0; //!< Payloads sent through the compression stage
+				std::uint64_t zero_pages     = 0; //!< Of those, how many were elided for being all zeros
+				std::uint64_t packed_bytes   = 0; //!< Their size before compression
+				std::uint64_t packed_wire    = 0; //!< Their size on the wire
+				std::uint64_t packing_ns     = 0; //!< Time spent compressing
+				std::uint64_t unpacked_pages = 0; //!< Compressed payloads received
+				std::uint64_t unpacked_bytes = 0; //!< Their size after decompression
+				std::uint64_t unpacked_wire  = 0; //!< Their size on the wire
+				std::uint64_t unpacking_ns   = 0; //!< Time spent decompressing
+			};
+
 			//! Whether the session has been closed.
 			inline bool is_lost() const noexcept
 			{
 				return !this->peer;
 			}
 
+			//! Retrieves the address of the remote end, if connected.
+			inline std::optional<ip_endpoint> get_peer() const noexcept
+			{
+				return this->peer ? this->peer->get_peer() : std::nullopt;
+			}
+
 		protected:
+			//! Kinds of binary frames
+			enum class opcode : std::uint8_t
+			{
+				message,  //!< Payload is a JSON value, as a line would be
+				read,     //!< Requests the contents of object 'id', no payload
+				contents, //!< Payload is the whole contents of object 'id'
+				write     //!< Payload is written to object 'id', starting at 'offset'
+			};
+
+			//! Encodings of the payloads of contents and write frames
+			enum class packing : std::uint8_t
+			{
+				raw,  //!< The contents themselves
+				lz,   //!< Contents size, then an LZ block (see ce2103/lz.hpp)
+				zeros //!< Contents size only, every byte is zero
+			};
+
+			//! Header that precedes every binary frame
+			struct frame_header
+			{
+				opcode        type;                  //!< Kind of frame
+				bool          more   = false;        //!< For writes, whether more writes of the same batch follow
+				std::uint32_t length = 0;            //!< Payload size in bytes
+				std::uint64_t id     = 0;            //!< Object ID, if any
+				std::uint64_t offset = 0;            //!< Offset into the object, if any
+				packing       format = packing::raw; //!< For contents and writes, payload encoding
+			};
+
+			//! Size of a frame header on the wire, with little-endian fields
+			static constexpr std::size_t FRAME_HEADER_SIZE = 24;
+
+			/*!
+			 * \brief Smallest contents which are compressed. Below this, the
+			 *        savings don't make up for the cost of trying.
+			 */
+			static constexpr std::size_t COMPRESSION_THRESHOLD = 512;
+
 			//! Produces a compact JSON representation of an octet stream.
 			static nlohmann::json serialize_octets(std::string_view input);
 
@@ -59,12 +127,111 @@ namespace ce2103::mm
 			: peer{std::move(peer)}
 			{}
 
-			//! Serializes a JSON value and sends it as a single line.
+			//! Serializes a JSON value and sends it as a single line or message frame.
 			void send(nlohmann::json data);
 
-			//! Attempts to read a single line and deserialize it as JSON.
+			/*!
+			 * \brief Attempts to read a single line or message frame and
+			 *        deserialize it as JSON.
+			 */
 			std::optional<nlohmann::json> receive();
 
+			//! Whether receive() can proceed without waiting for more input.
+			inline bool has_pending_input() const noexcept
+			{
+				return this->peer && (this->binary ? this->peer->has_buffered_input()
+				                                   : this->peer->has_buffered_line());
+			}
+
+			//! Whether some input, even if incomplete, can be read without waiting.
+			inline bool has_input() const noexcept
+			{
+				return this->peer && this->peer->has_input();
+			}
+
+			//! Whether binary frames are being used instead of lines.
+			inline bool is_binary() const noexcept
+			{
+				return this->binary;
+			}
+
+			//! Switches to binary frames for any further input or output.
+			inline void set_binary() noexcept
+			{
+				this->binary = true;
+			}
+
+			//! Whether contents frames and write frames may be compressed.
+			inline bool is_compressed() const noexcept
+			{
+				return this->compressed;
+			}
+
+			//! Enables compression of contents frames and write frames.
+			inline void set_compressed() noexcept
+			{
+				this->compressed = true;
+			}
+
+			//! Counters of the compression stage so far.
+			inline const compression_stats& get_compression_stats() const noexcept
+			{
+				return this->stats;
+			}
+
+			/*!
+			 * \brief Appends a binary frame to a buffer, so that several
+			 *        frames may be sent at once by send_frames().
+			 */
+			static void put_frame
+			(
+				std::string& output, const frame_header& header, std::string_view payload = {}
+			);
+
+			/*!
+			 * \brief Same as put_frame(), but for the contents of a contents
+			 *        frame or write frame, which are compressed if possible.
+			 *        The header's length and format are filled in.
+			 */
+			void put_octets(std::string& output, frame_header header, std::string_view contents);
+
+			//! Sends the frames which were put into a buffer.
+			void send_frames(std::string_view frames);
+
+			/*!
+			 * \brief Attempts to read the header of the next binary frame.
+			 *        Its payload must be consumed right afterwards.
+			 */
+			std::optional<frame_header> receive_header();
+
+			/*!
+			 * \brief Reads the payload of the frame whose header was just received.
+			 *
+			 * \param output where to store the payload, or nullptr to skip it
+			 * \param length payload length, as given by the header
+			 *
+			 * \return whether the payload was read
+			 */
+			bool receive_payload(char* output, std::size_t length);
+
+			/*!
+			 * \brief Reads the payload of a contents frame or write frame,
+			 *        decompressing it if needed.
+			 *
+			 * \param header as just received
+			 * \param locate given the size of the contents, returns where
+			 *               to store them, or nullptr to skip them
+			 *
+			 * \return whether the payload was read and well-formed
+			 */
+			bool receive_octets
+			(
+				const frame_header& header, const std::function<char*(std::size_t)>& locate
+			);
+
+			//! Reads and deserializes the payload of a message frame.
+			std::optional<nlohmann::json> receive_message(const frame_header& header);
+
 			//! Forces immediate session termination.
 			inline void discard() noexcept
 			{
@@ -72,7 +239,11 @@ namespace ce2103::mm
 			}
 
 		private:
-			std::optional<socket> peer; //!< The session's socket
+			std::optional<socket> peer;               //!< The session's socket
+			bool                  binary     = false; //!< See is_binary()
+			bool                  compressed = false; //!< See is_compressed()
+			compression_stats     stats;              //!< See get_compression_stats()
+			std::string           scratch;            //!< Compressed payloads, on their way in or out
 	};
 }
 
@@ -0,0 +1,173 @@
+#ifndef CE2103_MM_SLAB_HPP
+#define CE2103_MM_SLAB_HPP
+
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+
+namespace ce2103::mm
+{
+	//! Usage report of a size class in the slab allocator
+	struct slab_stats
+	{
+		std::size_t block_size; //!< Block size in bytes, or zero for large blocks
+		std::size_t reserved;   //!< Bytes obtained from the OS for this class
+		std::size_t live;       //!< Bytes handed out and not yet returned to the pool
+	};
+
+	/*!
+	 * \brief Size-class allocator for GC-owned blocks (header and payload).
+	 *
+	 * Small blocks are carved out of fixed-size, self-aligned slabs, with
+	 * per-thread caches of free blocks in front of a locked central pool.
+	 * Slabs go back to the OS as soon as they are empty, except for one
+	 * spare slab per class. Blocks beyond the largest class are mapped
+	 * individually. A few of them are kept mapped after being freed, with
+	 * their pages released by madvise(), to be reused by later requests.
+	 */
+	class slab_allocator
+	{
+		public:
+			//! Size and alignment of every slab, in bytes
+			static constexpr std::size_t SLAB_SIZE = 64 << 10;
+
+			//! Number of small size classes
+			static constexpr std::size_t CLASS_COUNT = 32;
+
+			//! Largest block size that is served from slabs
+			static constexpr std::size_t MAX_BLOCK_SIZE = 8 << 10;
+
+			//! Maximum number of freed large block mappings kept for reuse
+			static constexpr std::size_t LARGE_CACHE_SLOTS = 8;
+
+			//! Maximum total length of freed large block mappings kept for reuse
+			static constexpr std::size_t LARGE_CACHE_SIZE = 256 << 20;
+
+			//! Returns the singleton instance, creating it if necessary.
+			static slab_allocator& get_instance();
+
+			/*!
+			 * \brief Reserves a block of at least the given size. Throws
+			 *        std::bad_alloc on failure, as operator new does.
+			 */
+			void* allocate(std::size_t size);
+
+			//! Returns a block previously reserved by allocate().
+			void deallocate(void* block) noexcept;
+
+			/*!
+			 * \brief Retrieves usage of a size class. Blocks cached by
+			 *        threads count as live. CLASS_COUNT designates large
+			 *        blocks, in which case cached mappings aren't reserved.
+			 */
+			slab_stats get_stats(std::size_t size_class) const;
+
+			//! Returns the block size of a size class
+			static std::size_t get_block_size(std::size_t size_class) noexcept;
+
+			//! Returns the size class used for a given allocation size
+			static std::size_t get_size_class(std::size_t size) noexcept;
+
+		private:
+			//! Per-thread free block cache, in front of the central pools
+			struct thread_cache;
+
+			//! Returns the calling thread's cached blocks when it exits
+			struct thread_cache_guard;
+
+			//! Header found at the start of every slab or large block mapping.
+			struct span
+			{
+				std::size_t size_class; //!< Owner class, or CLASS_COUNT if large
+				std::size_t length;     //!< Mapping length in bytes
+				std::size_t used = 0;   //!< Number of blocks in use
+				void*       free_list = nullptr; //!< Intrusive list of free blocks
+				char*       bump      = nullptr; //!< Start of never-used blocks
+				span*       previous  = nullptr; //!< Previous partial slab
+				span*       next      = nullptr; //!< Next partial slab
+			};
+
+			//! Central pool of a size class
+			struct alignas(64) pool
+			{
+				//! Protects the pool and all of its slabs
+				mutable std::mutex mutex;
+
+				span*       partial  = nullptr; //!< Slabs with at least one free block
+				span*       spare    = nullptr; //!< Empty slab kept to avoid remapping
+				std::size_t slabs    = 0;       //!< Number of mapped slabs
+				std::size_t live     = 0;       //!< Blocks outside this pool
+			};
+
+			//! Distance between a span's start and its first block
+			static constexpr std::size_t SPAN_HEADER_SIZE = 64;
+
+			/*!
+			 * \brief Calling thread's cache, allocated by get_cache(). Only
+			 *        a pointer is thread-local, so that the static TLS block
+			 *        stays small enough for the library to be dlopen()ed.
+			 */
+			[[gnu::tls_model("initial-exec")]]
+			static thread_local thread_cache* cache;
+
+			//! Flushes and frees 'cache' at thread exit. Constructed on first use.
+			static thread_local thread_cache_guard cache_guard;
+
+			//! Central pools, by size class
+			pool pools[CLASS_COUNT];
+
+			//! Protects large block statistics
+			mutable std::mutex large_mutex;
+
+			std::size_t large_reserved = 0; //!< Bytes mapped for large blocks
+			std::size_t large_live     = 0; //!< Bytes requested for large blocks
+			std::size_t large_cached   = 0; //!< Length of all cached mappings
+
+			//! Freed large block mappings, nullptr if unused
+			span* large_cache[LARGE_CACHE_SLOTS] = {};
+
+			slab_allocator() noexcept = default;
+
+			//! Returns the calling thread's cache, allocating it if needed.
+			static inline thread_cache& get_cache()
+			{
+				return cache != nullptr ? *cache : make_cache();
+			}
+
+			//! Allocates the calling thread's cache and registers it for flushing.
+			static thread_cache& make_cache();
+
+			/*!
+			 * \brief Moves up to 'count' free blocks of a class out of the pool.
+			 *
+			 * \return number of blocks written to 'output'
+			 */
+			std::size_t take(std::size_t size_class, void** output, std::size_t count);
+
+			//! Returns blocks of a class to the pool, unmapping empty slabs.
+			void give(std::size_t size_class, void* const* blocks, std::size_t count) noexcept;
+
+			//! Reserves a dedicated mapping of at least 'length' bytes, header included.
+			span* take_large(std::size_t length);
+
+			//! Caches or unmaps a large block's mapping.
+			void give_large(span* target) noexcept;
+
+			//! Maps a new span of the given length, aligned to SLAB_SIZE.
+			static span* map_span(std::size_t size_class, std::size_t length);
+
+			//! Returns a span to the OS.
+			static void unmap_span(span* target) noexcept;
+
+			//! Locates the span which contains a block.
+			static inline span* get_span_of(void* block) noexcept
+			{
+				return reinterpret_cast<span*>
+				(
+					reinterpret_cast<std::uintptr_t>(block) & ~(SLAB_SIZE - 1)
+				);
+			}
+	};
+}
+
+#endif
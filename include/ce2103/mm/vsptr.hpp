@@ -41,6 +41,9 @@ namespace ce2103::mm::_detail
 		template<typename>
 		friend class mm::VSPtr;
 
+		// Reads IDs during cycle collection
+		friend class mm::tracer;
+
 		public:
 			//! Default from_cast() implementation; disallows all casts into this type
 			template<typename U>
@@ -57,7 +60,7 @@ namespace ce2103::mm::_detail
 
 			//! Constructs a pointer initialized to nullptr.
 			inline ptr_base() noexcept
-			: storage{at::any}
+			: id{0}, storage{at::any}, is_front{false}
 			{}
 
 			//! Constructs a new reference (if not nullptr) to the same object.
@@ -190,7 +193,7 @@ namespace ce2103::mm::_detail
 			T* data = nullptr;
 
 			//! Allocation ID
-			std::size_t id : sizeof(std::size_t) * CHAR_BIT - 2;
+			std::size_t id : sizeof(std::size_t) * CHAR_BIT - 3;
 
 			/*!
 			 * \brief Memory locality.
@@ -200,9 +203,17 @@ namespace ce2103::mm::_detail
 			 */
 			at storage : 2;
 
+			/*!
+			 * \brief Whether 'data' points to the first object of the
+			 *        allocation, which places the allocation header at a
+			 *        fixed offset from it. Pointers to other subobjects
+			 *        must go through their manager to find the header.
+			 */
+			bool is_front : 1;
+
 			//! Constructs a ptr_base by parts.
-			inline ptr_base(T* data, std::size_t id, at storage) noexcept
-			: data{data}, id{id}, storage{storage}
+			inline ptr_base(T* data, std::size_t id, at storage, bool is_front = false) noexcept
+			: data{data}, id{id}, storage{storage}, is_front{is_front}
 			{}
 
 			//! Determines the associated manager from locality.
@@ -212,6 +223,38 @@ namespace ce2103::mm::_detail
 				     ? &memory_manager::get_default(this->storage) : nullptr;
 			}
 
+			//! Locates the allocation header. Requires is_front.
+			inline allocation& get_header() const noexcept
+			{
+				auto* front = const_cast<void*>(static_cast<const volatile void*>(this->data));
+				return *reinterpret_cast<allocation*>
+				(
+					static_cast<char*>(front) - get_header_offset<T>()
+				);
+			}
+
+			/*!
+			 * \brief Determines whether a pointer to 'new_data', derived from
+			 *        this one, also points to the first object of the allocation.
+			 */
+			template<typename U>
+			inline bool is_front_for(const U* new_data) const noexcept
+			{
+				return this->is_front && get_header_offset<U>() == get_header_offset<T>()
+				    && static_cast<const volatile void*>(new_data)
+				    == static_cast<const volatile void*>(this->data);
+			}
+
+			/*!
+			 * \brief Increments the reference count of the pointed-to
+			 *        allocation, if any. Local allocations which are
+			 *        pointed to by their front take a lock-free path.
+			 */
+			void lift_reference() const;
+
+			//! Decrements the reference count of the pointed-to allocation, if any.
+			void drop_reference() const;
+
 			/*!
 			 * \brief Begins a dereference operation. The pointer
 			 *        is checked for not being nullptr, and the
@@ -547,9 +590,9 @@ namespace ce2103::mm
 	template<typename T, template<class> class Derived>
 	Derived<T>& _detail::ptr_base<T, Derived>::operator=(std::nullptr_t) noexcept
 	{
-		if(auto *owner = this->get_owner(); owner != nullptr)
+		if(this->storage != at::any)
 		{
-			owner->drop(this->id);
+			this->drop_reference();
 			this->storage = at::any;
 		}
 
@@ -579,7 +622,12 @@ namespace ce2103::mm
 		resource->set_initialized(count);
 		owner.evict(id);
 
-		return Derived<T>{data, id, storage};
+		T* front = data;
+		bool is_front = get_header_offset<U>() == get_header_offset<T>()
+		             && static_cast<const volatile void*>(front)
+		             == static_cast<const volatile void*>(data);
+
+		return Derived<T>{front, id, storage, is_front};
 	}
 
 	template<typename T, template<class> class Derived>
@@ -596,6 +644,30 @@ namespace ce2103::mm
 		return this->data;
 	}
 
+	template<typename T, template<class> class Derived>
+	void _detail::ptr_base<T, Derived>::lift_reference() const
+	{
+		if(this->storage == at::local && this->is_front)
+		{
+			garbage_collector::lift(this->get_header(), this->id);
+		} else if(auto* owner = this->get_owner(); owner != nullptr)
+		{
+			owner->lift(this->id);
+		}
+	}
+
+	template<typename T, template<class> class Derived>
+	void _detail::ptr_base<T, Derived>::drop_reference() const
+	{
+		if(this->storage == at::local && this->is_front)
+		{
+			garbage_collector::drop(this->get_header(), this->id);
+		} else if(auto* owner = this->get_owner(); owner != nullptr)
+		{
+			owner->drop(this->id);
+		}
+	}
+
 	template<typename T, template<class> class Derived>
 	template<typename U, template<class> class OtherDerived>
 	Derived<T>& _detail::ptr_base<T, Derived>::initialize
@@ -606,12 +678,9 @@ namespace ce2103::mm
 		this->data = other.data;
 		this->id = other.id;
 		this->storage = other.storage;
+		this->is_front = other.is_front_for(this->data);
 
-		if(auto* owner = this->get_owner(); owner != nullptr)
-		{
-			owner->lift(this->id);
-		}
-
+		this->lift_reference();
 		return static_cast<Derived<T>&>(*this);
 	}
 
@@ -625,6 +694,7 @@ namespace ce2103::mm
 		this->data = other.data;
 		this->id = other.id;
 		this->storage = other.storage;
+		this->is_front = other.is_front_for(this->data);
 
 		other.data = nullptr;
 		other.storage = at::any;
@@ -671,12 +741,17 @@ namespace ce2103::mm
 		typename PointerType::element_type* new_data
 	) const
 	{
-		if(auto* owner = this->get_owner(); owner != nullptr)
+		this->lift_reference();
+		return PointerType{new_data, this->id, this->storage, this->is_front_for(new_data)};
+	}
+
+	template<typename T, template<class> class Derived>
+	void tracer::operator()(const _detail::ptr_base<T, Derived>& pointer)
+	{
+		if(pointer.storage == at::local)
 		{
-			owner->lift(this->id);
+			this->visit(pointer.id);
 		}
-
-		return PointerType{new_data, this->id, this->storage};
 	}
 
 	template<typename T>
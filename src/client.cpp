@@ -1,10 +1,17 @@
+#include <deque>
 #include <mutex>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 #include <utility>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <climits>
+#include <iostream>
+#include <iterator>
 #include <optional>
 #include <typeinfo>
 #include <algorithm>
@@ -18,6 +25,7 @@
 
 #include "ce2103/mm/gc.hpp"
 #include "ce2103/mm/error.hpp"
+#include "ce2103/mm/debug.hpp"
 #include "ce2103/mm/client.hpp"
 #include "ce2103/mm/session.hpp"
 
@@ -31,7 +39,10 @@ namespace
 
 namespace ce2103::mm
 {
-	client_session::client_session(socket client_socket, std::string_view secret)
+	client_session::client_session
+	(
+		socket client_socket, std::string_view secret, bool binary, bool compression
+	)
 	: session{std::move(client_socket)}
 	{
 		// Transforms the array of uint64_ts into a standard MD5 representation
@@ -52,31 +63,162 @@ namespace ce2103::mm
 		put_half(sizeof(std::uint64_t), hash.second);
 
 		auto view = std::string_view{reinterpret_cast<char*>(hash_bytes), sizeof hash_bytes};
-		this->send({{"auth", serialize_octets(view)}});
 
-		if(this->receive() != json(true))
+		// Servers that don't know of binary frames, range commands or compression ignore the proposals
+		json request{{"auth", serialize_octets(view)}, {"batch", true}};
+		if(binary)
+		{
+			request["framing"] = "binary";
+			if(compression)
+			{
+				request["compression"] = "lz";
+			}
+		}
+
+		this->send(std::move(request));
+
+		// Otherwise, the server lists which proposals it accepts
+		auto response = this->receive();
+		if(response == json(true))
+		{
+			return;
+		} else if(!response || !response->is_object() || response->empty())
+		{
+			this->discard();
+			return;
+		}
+
+		for(const auto& [key, value] : response->items())
+		{
+			if(binary && key == "framing" && value == "binary")
+			{
+				this->set_binary();
+			} else if(key == "batch" && value == true)
+			{
+				this->batches = true;
+			} else if(binary && compression && key == "compression" && value == "lz")
+			{
+				this->set_compressed();
+			} else
+			{
+				this->discard();
+				return;
+			}
+		}
+
+		// Compressed payloads only exist within binary frames
+		if(this->is_compressed() && !this->is_binary())
 		{
 			this->discard();
 		}
 	}
 
+	auto client_session::get_compression_stats() const -> compression_stats
+	{
+		std::lock_guard lock{this->mutex};
+		return session::get_compression_stats();
+	}
+
 	bool client_session::finalize()
 	{
-		this->send({{"bye", {}}});
+		bool cleanly_finalized = false;
+		{
+			std::lock_guard lock{this->mutex};
+
+			this->make_room();
+			this->send({{"bye", {}}});
 
-		bool cleanly_finalized = this->receive() == json({});
+			this->enqueue([this, &cleanly_finalized]
+			{
+				cleanly_finalized = this->receive() == json({});
+			});
+		}
+
+		this->wait_all();
 		this->discard();
 
+		// Reports the compression ratio and cost of the session, if any
+		if(auto stats = this->get_compression_stats(); stats.packed_pages + stats.unpacked_pages > 0)
+		{
+			_detail::debug_log
+			(
+				"compression", "sent", stats.packed_pages, "zero", stats.zero_pages,
+				"sent_bytes", stats.packed_bytes, "sent_wire", stats.packed_wire,
+				"packing_ns", stats.packing_ns, "received", stats.unpacked_pages,
+				"received_bytes", stats.unpacked_bytes, "received_wire", stats.unpacked_wire,
+				"unpacking_ns", stats.unpacking_ns
+			);
+		}
+
 		return cleanly_finalized;
 	}
 
+	std::optional<std::uint64_t> client_session::share()
+	{
+		std::optional<std::uint64_t> token;
+		sequence request;
+		{
+			std::lock_guard lock{this->mutex};
+
+			this->make_room();
+			this->send({{"share", {}}});
+
+			request = this->enqueue([this, &token]
+			{
+				if(auto result = this->receive(); result && result->is_number_unsigned())
+				{
+					token = result->get<std::uint64_t>();
+				} else
+				{
+					this->discard();
+				}
+			});
+		}
+
+		this->wait(request);
+		return token;
+	}
+
+	bool client_session::join(std::uint64_t token)
+	{
+		bool succeeded = false;
+		sequence request;
+		{
+			std::lock_guard lock{this->mutex};
+
+			this->make_room();
+			this->send({{"join", token}});
+
+			request = this->enqueue([this, &succeeded]
+			{
+				succeeded = this->expect_empty();
+			});
+		}
+
+		this->wait(request);
+		return succeeded;
+	}
+
 	std::optional<std::size_t> client_session::allocate
 	(
 		std::size_t part_size, std::size_t parts, std::size_t remainder, const char* type
 	)
 	{
-		std::lock_guard lock{this->mutex};
+		std::optional<std::size_t> first_id;
+		this->wait(this->allocate_async(part_size, parts, remainder, type, [&first_id](auto result)
+		{
+			first_id = result;
+		}));
 
+		return first_id;
+	}
+
+	auto client_session::allocate_async
+	(
+		std::size_t part_size, std::size_t parts, std::size_t remainder, const char* type,
+		std::function<void(std::optional<std::size_t>)> on_completion
+	) -> sequence
+	{
 		// The first part will start with a refcount of 2
 		json query{{"alloc", 1}, {"type", type}};
 		if(remainder > 0)
@@ -90,28 +232,502 @@ namespace ce2103::mm
 			query["parts"] = parts;
 		}
 
+		std::lock_guard lock{this->mutex};
+
+		this->make_room();
 		this->send(std::move(query));
 
-		auto result = this->receive();
-		if(!result || !result->is_number_unsigned())
+		return this->enqueue([this, on_completion = std::move(on_completion)]
 		{
-			this->discard();
-			return std::nullopt;
+			std::optional<std::size_t> first_id;
+			if(auto result = this->receive(); result && result->is_number_unsigned())
+			{
+				first_id = result->get<std::size_t>();
+			} else
+			{
+				this->discard();
+			}
+
+			if(on_completion)
+			{
+				on_completion(first_id);
+			}
+		});
+	}
+
+	bool client_session::lift(std::size_t id)
+	{
+		bool succeeded = false;
+		this->wait(this->lift_async(id, [&succeeded](bool result)
+		{
+			succeeded = result;
+		}));
+
+		return succeeded;
+	}
+
+	auto client_session::lift_async(std::size_t id, std::function<void(bool)> on_completion) -> sequence
+	{
+		std::lock_guard lock{this->mutex};
+
+		this->make_room();
+		this->send({{"lift", id}});
+
+		return this->enqueue([this, on_completion = std::move(on_completion)]
+		{
+			bool succeeded = this->expect_empty();
+			if(on_completion)
+			{
+				on_completion(succeeded);
+			}
+		});
+	}
+
+	std::optional<drop_result> client_session::drop(std::size_t id)
+	{
+		std::optional<drop_result> result;
+		this->wait(this->drop_async(id, [&result](auto drop_result)
+		{
+			result = drop_result;
+		}));
+
+		return result;
+	}
+
+	auto client_session::drop_async
+	(
+		std::size_t id, std::function<void(std::optional<drop_result>)> on_completion
+	) -> sequence
+	{
+		std::lock_guard lock{this->mutex};
+
+		this->make_room();
+		this->send({{"drop", id}});
+
+		return this->enqueue([this, on_completion = std::move(on_completion)]
+		{
+			auto result = this->expect_drop_result();
+			if(on_completion)
+			{
+				on_completion(result);
+			}
+		});
+	}
+
+	bool client_session::lift_range(std::size_t first, std::size_t count)
+	{
+		bool succeeded = false;
+		this->wait(this->lift_range_async(first, count, [&succeeded](bool result)
+		{
+			succeeded = result;
+		}));
+
+		return succeeded;
+	}
+
+	auto client_session::lift_range_async
+	(
+		std::size_t first, std::size_t count, std::function<void(bool)> on_completion
+	) -> sequence
+	{
+		assert(count > 0);
+
+		if(!this->batches)
+		{
+			// The last request reports for all of them
+			auto failed = std::make_shared<bool>(false);
+			for(std::size_t id = first; id < first + count - 1; ++id)
+			{
+				this->lift_async(id, [failed](bool succeeded)
+				{
+					*failed = *failed || !succeeded;
+				});
+			}
+
+			auto last = first + count - 1;
+			return this->lift_async(last, [failed, on_completion = std::move(on_completion)](bool succeeded)
+			{
+				if(on_completion)
+				{
+					on_completion(succeeded && !*failed);
+				}
+			});
+		}
+
+		std::lock_guard lock{this->mutex};
+
+		this->make_room();
+		this->send({{"lifts", {first, count}}});
+
+		return this->enqueue([this, on_completion = std::move(on_completion)]
+		{
+			bool succeeded = this->expect_empty();
+			if(on_completion)
+			{
+				on_completion(succeeded);
+			}
+		});
+	}
+
+	std::optional<std::vector<drop_result>> client_session::drop_range(std::size_t first, std::size_t count)
+	{
+		std::optional<std::vector<drop_result>> results;
+		this->wait(this->drop_range_async(first, count, [&results](auto drop_results)
+		{
+			results = std::move(drop_results);
+		}));
+
+		return results;
+	}
+
+	auto client_session::drop_range_async
+	(
+		std::size_t first, std::size_t count,
+		std::function<void(std::optional<std::vector<drop_result>>)> on_completion
+	) -> sequence
+	{
+		assert(count > 0);
+
+		if(!this->batches)
+		{
+			// Results are gathered until the last request completes
+			auto results = std::make_shared<std::vector<std::optional<drop_result>>>(count);
+			for(std::size_t i = 0; i < count - 1; ++i)
+			{
+				this->drop_async(first + i, [results, i](auto result)
+				{
+					(*results)[i] = result;
+				});
+			}
+
+			auto last = first + count - 1;
+			return this->drop_async(last, [results, on_completion = std::move(on_completion)](auto result)
+			{
+				results->back() = result;
+				if(!on_completion)
+				{
+					return;
+				}
+
+				std::vector<drop_result> gathered;
+				for(const auto& each : *results)
+				{
+					if(!each)
+					{
+						on_completion(std::nullopt);
+						return;
+					}
+
+					gathered.push_back(*each);
+				}
+
+				on_completion(std::move(gathered));
+			});
+		}
+
+		std::lock_guard lock{this->mutex};
+
+		this->make_room();
+		this->send({{"drops", {first, count}}});
+
+		return this->enqueue([this, first, count, on_completion = std::move(on_completion)]
+		{
+			auto results = this->expect_drop_results(first, count);
+			if(on_completion)
+			{
+				on_completion(std::move(results));
+			}
+		});
+	}
+
+	std::optional<std::size_t> client_session::fetch
+	(
+		std::size_t id, char* output, std::size_t capacity
+	)
+	{
+		std::optional<std::size_t> size;
+		this->wait(this->fetch_async(id, output, capacity, [&size](auto result)
+		{
+			size = result;
+		}));
+
+		return size;
+	}
+
+	auto client_session::fetch_async
+	(
+		std::size_t id, char* output, std::size_t capacity,
+		std::function<void(std::optional<std::size_t>)> on_completion
+	) -> sequence
+	{
+		std::lock_guard lock{this->mutex};
+
+		this->make_room();
+		if(this->is_binary())
+		{
+			std::string frame;
+			put_frame(frame, {opcode::read, false, 0, id});
+
+			this->send_frames(frame);
+		} else
+		{
+			this->send({{"read", id}});
+		}
+
+		return this->enqueue([this, output, capacity, on_completion = std::move(on_completion)]
+		{
+			auto size = this->receive_contents(output, capacity);
+			if(on_completion)
+			{
+				on_completion(size);
+			}
+		});
+	}
+
+	bool client_session::fetch_many
+	(
+		const std::vector<std::pair<std::size_t, char*>>& targets, std::size_t capacity,
+		const std::function<void(std::size_t, std::optional<std::size_t>)>& on_arrival
+	)
+	{
+		if(targets.empty())
+		{
+			return !this->is_lost();
+		}
+
+		sequence last = 0;
+		{
+			std::lock_guard lock{this->mutex};
+
+			this->make_room(targets.size());
+			if(this->is_binary())
+			{
+				// All requests leave in a single write
+				std::string frames;
+				for(const auto& [id, output] : targets)
+				{
+					put_frame(frames, {opcode::read, false, 0, id});
+				}
+
+				this->send_frames(frames);
+			} else
+			{
+				for(const auto& [id, output] : targets)
+				{
+					this->send({{"read", id}});
+				}
+			}
+
+			// on_arrival outlives the batch, since this call waits for it
+			for(std::size_t i = 0; i < targets.size(); ++i)
+			{
+				last = this->enqueue([this, i, output = targets[i].second, capacity, &on_arrival]
+				{
+					on_arrival(i, this->receive_contents(output, capacity));
+				});
+			}
+		}
+
+		return this->wait(last);
+	}
+
+	bool client_session::fetch_range
+	(
+		std::size_t first, const std::vector<char*>& outputs, std::size_t capacity,
+		const std::function<void(std::size_t, std::optional<std::size_t>)>& on_arrival
+	)
+	{
+		assert(!outputs.empty());
+
+		if(!this->batches)
+		{
+			std::vector<std::pair<std::size_t, char*>> targets;
+			for(std::size_t i = 0; i < outputs.size(); ++i)
+			{
+				targets.emplace_back(first + i, outputs[i]);
+			}
+
+			return this->fetch_many(targets, capacity, on_arrival);
+		}
+
+		sequence last = 0;
+		{
+			std::lock_guard lock{this->mutex};
+
+			// One response arrives per object
+			this->make_room(outputs.size());
+			this->send({{"reads", {first, outputs.size()}}});
+
+			for(std::size_t i = 0; i < outputs.size(); ++i)
+			{
+				last = this->enqueue([this, i, output = outputs[i], capacity, &on_arrival]
+				{
+					on_arrival(i, this->receive_contents(output, capacity));
+				});
+			}
+		}
+
+		return this->wait(last);
+	}
+
+	bool client_session::overwrite(std::size_t id, std::string_view contents)
+	{
+		bool succeeded = false;
+		this->wait(this->overwrite_async(id, contents, [&succeeded](bool result)
+		{
+			succeeded = result;
+		}));
+
+		return succeeded;
+	}
+
+	auto client_session::overwrite_async
+	(
+		std::size_t id, std::string_view contents, std::function<void(bool)> on_completion
+	) -> sequence
+	{
+		std::lock_guard lock{this->mutex};
+
+		this->make_room();
+		if(this->is_binary())
+		{
+			std::string frame;
+			this->put_octets(frame, {opcode::write, false, 0, id}, contents);
+
+			this->send_frames(frame);
+		} else
+		{
+			this->send({{"write", id}, {"value", serialize_octets(contents)}});
+		}
+
+		return this->enqueue([this, on_completion = std::move(on_completion)]
+		{
+			bool succeeded = this->expect_empty();
+			if(on_completion)
+			{
+				on_completion(succeeded);
+			}
+		});
+	}
+
+	bool client_session::overwrite_many(const std::vector<patch>& patches)
+	{
+		bool succeeded = false;
+		sequence request;
+		{
+			std::lock_guard lock{this->mutex};
+
+			this->make_room();
+
+			// A batch of frames is answered once, after its last frame
+			if(this->is_binary() && !patches.empty())
+			{
+				std::string frames;
+				for(std::size_t i = 0; i < patches.size(); ++i)
+				{
+					const auto& [id, offset, contents] = patches[i];
+
+					frame_header header{opcode::write, i + 1 < patches.size()};
+					header.id = id;
+					header.offset = offset;
+
+					this->put_octets(frames, header, contents);
+				}
+
+				this->send_frames(frames);
+			} else
+			{
+				json batch = json::array();
+				for(const auto& [id, offset, contents] : patches)
+				{
+					batch.push_back({id, offset, serialize_octets(contents)});
+				}
+
+				this->send({{"writes", std::move(batch)}});
+			}
+
+			request = this->enqueue([this, &succeeded]
+			{
+				succeeded = this->expect_empty();
+			});
+		}
+
+		this->wait(request);
+		return succeeded;
+	}
+
+	bool client_session::wait(sequence request)
+	{
+		std::lock_guard lock{this->mutex};
+
+		// Requests older than those in flight have completed
+		while(!this->in_flight.empty() && request >= this->next_sequence - this->in_flight.size())
+		{
+			this->complete_next();
+		}
+
+		return !this->is_lost();
+	}
+
+	bool client_session::wait_all()
+	{
+		std::lock_guard lock{this->mutex};
+		while(!this->in_flight.empty())
+		{
+			this->complete_next();
 		}
 
-		return result->get<std::size_t>();
+		return !this->is_lost();
+	}
+
+	bool client_session::poll()
+	{
+		std::lock_guard lock{this->mutex};
+
+		// Once the session is lost, receivers fail without blocking
+		while(!this->in_flight.empty() && (this->is_lost() || this->has_input()))
+		{
+			this->complete_next();
+		}
+
+		return !this->is_lost();
+	}
+
+	void client_session::make_room(std::size_t requests)
+	{
+		while(!this->in_flight.empty() && this->in_flight.size() + requests > MAX_IN_FLIGHT)
+		{
+			this->complete_next();
+		}
+	}
+
+	auto client_session::enqueue(std::function<void()> receiver) -> sequence
+	{
+		this->in_flight.push_back(std::move(receiver));
+		return this->next_sequence++;
 	}
 
-	bool client_session::lift(std::size_t id)
+	void client_session::complete_next()
 	{
-		this->send({{"lift", id}});
-		return this->expect_empty();
+		auto receiver = std::move(this->in_flight.front());
+		this->in_flight.pop_front();
+
+		receiver();
 	}
 
-	std::optional<drop_result> client_session::drop(std::size_t id)
+	bool client_session::expect_empty()
 	{
-		this->send({{"drop", id}});
+		bool succeeded = this->receive() == json({});
+		if(!succeeded)
+		{
+			this->discard();
+		}
 
+		return succeeded;
+	}
+
+	std::optional<drop_result> client_session::expect_drop_result()
+	{
 		auto result = this->receive();
 		if(result == json({}))
 		{
@@ -122,50 +738,99 @@ namespace ce2103::mm
 		} else if(result == json{{"lost", true}})
 		{
 			return drop_result::lost;
-		} else
-		{
-			this->discard();
-			return std::nullopt;
 		}
+
+		this->discard();
+		return std::nullopt;
 	}
 
-	std::optional<std::string> client_session::fetch(std::size_t id)
+	std::optional<std::vector<drop_result>> client_session::expect_drop_results
+	(
+		std::size_t first, std::size_t count
+	)
 	{
-		this->send({{"read", id}});
-		if(auto serialized = this->receive())
+		auto result = this->receive();
+		try
 		{
-			if(auto size = deserialized_size(*serialized))
+			if(result && result->is_object() && result->size() == 2)
 			{
-				std::string contents;
-				contents.resize(*size);
+				// Objects that are neither hanging nor lost were reduced
+				std::vector<drop_result> results(count, drop_result::reduced);
+
+				bool valid = true;
+				for(auto [key, outcome] : {std::make_pair("hanging", drop_result::hanging),
+				                           std::make_pair("lost", drop_result::lost)})
+				{
+					for(const auto& entry : result->at(key))
+					{
+						auto id = entry.get<std::size_t>();
+						if((valid = valid && id >= first && id - first < count))
+						{
+							results[id - first] = outcome;
+						}
+					}
+				}
 
-				if(deserialize_octets(*serialized, contents.data(), *size))
+				if(valid)
 				{
-					return contents;
+					return results;
 				}
 			}
+		} catch(const json::exception&)
+		{
+			// Fall-through
 		}
 
+		this->discard();
 		return std::nullopt;
 	}
 
-	bool client_session::overwrite(std::size_t id, std::string_view contents)
+	std::optional<std::size_t> client_session::receive_contents(char* output, std::size_t capacity)
 	{
-		std::lock_guard lock{this->mutex};
+		if(!this->is_binary())
+		{
+			if(auto serialized = this->receive())
+			{
+				if(auto size = deserialized_size(*serialized);
+				   size && *size <= capacity && deserialize_octets(*serialized, output, *size))
+				{
+					return size;
+				}
 
-		this->send({{"write", id}, {"value", serialize_octets(contents)}});
-		return this->expect_empty();
-	}
+				return std::nullopt;
+			}
 
-	bool client_session::expect_empty()
-	{
-		bool succeeded = this->receive() == json({});
-		if(!succeeded)
-		{
 			this->discard();
+			return std::nullopt;
 		}
 
-		return succeeded;
+		// Errors arrive as messages instead of contents
+		auto header = this->receive_header();
+		if(header && header->type == opcode::contents)
+		{
+			std::optional<std::size_t> size;
+			auto locate = [&size, output, capacity](std::size_t length)
+			{
+				if(length <= capacity)
+				{
+					size = length;
+					return output;
+				}
+
+				return static_cast<char*>(nullptr);
+			};
+
+			if(this->receive_octets(*header, locate))
+			{
+				return size;
+			}
+		} else if(header && header->type == opcode::message && this->receive_message(*header))
+		{
+			return std::nullopt;
+		}
+
+		this->discard();
+		return std::nullopt;
 	}
 
 	template<typename T>
@@ -186,13 +851,17 @@ namespace ce2103::mm
 		return std::nullopt;
 	}
 
-	bool remote_manager::initialize(socket client_socket, std::string_view secret)
+	bool remote_manager::initialize
+	(
+		socket client_socket, std::string_view secret,
+		paging mode, std::size_t threshold, bool compression
+	)
 	{
 		assert(!remote_collector);
 
 		bool succeeded = !remote_collector.emplace
 		(
-			private_t{}, std::move(client_socket), secret
+			private_t{}, std::move(client_socket), secret, mode, threshold, compression
 		).client.is_lost();
 
 		if(!succeeded)
@@ -213,10 +882,63 @@ namespace ce2103::mm
 		return *remote_collector;
 	}
 
-	remote_manager::remote_manager(private_t, socket client_socket, std::string_view secret)
-	: client{std::move(client_socket), secret}
+	remote_manager::remote_manager
+	(
+		private_t, socket client_socket, std::string_view secret,
+		paging mode, std::size_t threshold, bool compression
+	)
+	: client{std::move(client_socket), secret, true, compression}, large_threshold{threshold}
+	{
+		if(!this->client.is_lost())
+		{
+			this->open_channels(secret, compression);
+		}
+
+		this->install_trap_region(mode);
+	}
+
+	void remote_manager::open_channels(std::string_view secret, bool compression)
 	{
-		this->install_trap_region();
+		// The main session counts as the first channel
+		std::size_t count = std::clamp(std::thread::hardware_concurrency(), 1u, 4u);
+		if(const char* text = std::getenv("MM_FAULT_CHANNELS"); text != nullptr)
+		{
+			char* end;
+			auto parsed = std::strtoull(text, &end, 10);
+
+			if(*text != '\0' && *end == '\0' && parsed > 0)
+			{
+				count = parsed;
+			} else
+			{
+				std::cerr << "=== Ignoring invalid MM_FAULT_CHANNELS ===\n";
+			}
+		}
+
+		std::optional<std::uint64_t> token;
+		auto endpoint = this->client.get_peer();
+
+		if(count <= 1 || !endpoint || !(token = this->client.share()))
+		{
+			return;
+		}
+
+		while(this->channels.size() < count - 1)
+		{
+			socket channel_socket;
+			if(!channel_socket.connect(*endpoint))
+			{
+				break;
+			}
+
+			auto channel = std::make_unique<client_session>(std::move(channel_socket), secret, true, compression);
+			if(channel->is_lost() || !channel->join(*token))
+			{
+				break;
+			}
+
+			this->channels.push_back(std::move(channel));
+		}
 	}
 
 	[[noreturn]]
@@ -227,34 +949,349 @@ namespace ce2103::mm
 
 	std::size_t remote_manager::allocate(std::size_t size, const std::type_info& type)
 	{
+		if(size <= MAX_PACKED_SIZE)
+		{
+			return this->allocate_packed(size);
+		} else if(this->large_threshold > 0 && size >= this->large_threshold)
+		{
+			// Once the chunk area is full, large allocations are paged as usual
+			if(auto id = this->allocate_large(size, type))
+			{
+				return *id;
+			}
+		}
+
 		std::size_t part_size = this->get_part_size();
 
 		// Divides the requested size by parts; eg, 9000 becomes 4096 + 4096 + 808
-		auto id = this->client.allocate
+		std::size_t id = this->accept_parts
 		(
-			part_size, size / part_size, size % part_size, type.name()
+			this->client.allocate(part_size, size / part_size, size % part_size, type.name()),
+			(size - 1) / part_size + 1
 		);
 
+		// Optimizes writing of the allocation header in the near future
+		this->wipe(id, std::min(size, part_size));
+		return id;
+	}
+
+	std::size_t remote_manager::accept_parts(std::optional<std::size_t> id, std::size_t parts)
+	{
+		std::size_t capacity = this->get_part_capacity();
 		if(!id)
 		{
 			throw_network_failure();
+		} else if(parts <= capacity && *id <= capacity - parts)
+		{
+			return *id;
 		}
 
-		// Optimizes writing of the allocation header in the near future
-		this->wipe(*id, std::min(size, part_size));
-		return *id;
+		// As in do_drop(), the first part is left hanging and then all of them are lost
+		if(!this->client.drop(*id) || !this->client.drop_range(*id, parts))
+		{
+			throw_network_failure();
+		}
+
+		throw std::system_error{error_code::memory_error};
 	}
 
-	void remote_manager::do_lift(std::size_t id)
+	std::size_t remote_manager::allocate_packed(std::size_t size)
+	{
+		std::size_t size_class = (size - 1) / PACKED_GRANULE;
+		std::size_t block_size = (size_class + 1) * PACKED_GRANULE;
+		std::size_t part_size = this->get_part_size();
+
+		std::lock_guard lock{this->packing_mutex};
+
+		auto& partial = this->partial_pages[size_class];
+		if(partial.empty())
+		{
+			std::size_t page_id = this->accept_parts(this->client.allocate(0, 0, part_size, "packed"), 1);
+
+			// Blocks are taken from the back of the free list, lowest first
+			packed_page page{block_size, std::vector<std::uint32_t>(part_size / block_size), {}};
+			for(std::size_t block = page.references.size(); block > 0; --block)
+			{
+				page.free_list.push_back(block - 1);
+			}
+
+			// The page is new, so its contents are never fetched
+			this->wipe(page_id, part_size);
+
+			this->packed_pages.insert(page_id, std::move(page));
+			partial.push_back(page_id);
+		}
+
+		std::size_t page_id = partial.back();
+		auto& page = *this->packed_pages.search(page_id);
+
+		std::size_t block = page.free_list.back();
+		page.free_list.pop_back();
+		page.references[block] = 1;
+
+		if(page.free_list.empty())
+		{
+			partial.pop_back();
+		}
+
+		// IDs are trap region offsets in units of PACKED_GRANULE, see get_base_of()
+		return PACKED_ID_BIT | (page_id * part_size + block * block_size) / PACKED_GRANULE;
+	}
+
+	std::size_t remote_manager::get_packed_page_count() const
+	{
+		std::lock_guard lock{this->packing_mutex};
+		return this->packed_pages.get_size();
+	}
+
+	auto remote_manager::find_packed(std::size_t id) -> std::pair<packed_page*, std::size_t>
+	{
+		std::size_t part_size = this->get_part_size();
+		std::size_t offset = (id & ~PACKED_ID_BIT) * PACKED_GRANULE;
+
+		auto* page = this->packed_pages.search(offset / part_size);
+		assert(page != nullptr);
+
+		return std::make_pair(page, offset % part_size / page->block_size);
+	}
+
+	drop_result remote_manager::drop_packed(std::size_t id)
+	{
+		{
+			std::lock_guard lock{this->packing_mutex};
+
+			auto [page, block] = this->find_packed(id);
+			assert(page->references[block] > 0);
+
+			if(--page->references[block] > 0)
+			{
+				return drop_result::reduced;
+			}
+		}
+
+		// This destroys all objects in the allocation, which might drop others
+		allocation& header = this->get_base_of(id);
+		this->probe(&header, true);
+		dispose(header);
+
+		std::lock_guard lock{this->packing_mutex};
+
+		// The page might have moved within the table meanwhile
+		auto [page, block] = this->find_packed(id);
+		std::size_t page_id = (id & ~PACKED_ID_BIT) * PACKED_GRANULE / this->get_part_size();
+
+		auto& partial = this->partial_pages[page->block_size / PACKED_GRANULE - 1];
+		page->free_list.push_back(block);
+
+		if(page->free_list.size() < page->references.size())
+		{
+			if(page->free_list.size() == 1)
+			{
+				partial.push_back(page_id);
+			}
+
+			return drop_result::lost;
+		}
+
+		// The last block is gone, so the page is freed as well
+		if(page->references.size() > 1)
+		{
+			partial.erase(std::find(partial.begin(), partial.end(), page_id));
+		}
+
+		this->packed_pages.remove(page_id);
+		this->discard(page_id);
+
+		// Shared pages start with two references, as any other allocation
+		std::optional<drop_result> first;
+		std::optional<drop_result> second;
+
+		this->client.drop_async(page_id, [&first](auto result) { first = result; });
+		this->client.wait(this->client.drop_async(page_id, [&second](auto result) { second = result; }));
+
+		if(first != drop_result::hanging || second != drop_result::lost)
+		{
+			throw_network_failure();
+		}
+
+		return drop_result::lost;
+	}
+
+	auto remote_manager::allocate_large(std::size_t size, const std::type_info& type)
+	-> std::optional<std::size_t>
+	{
+		std::size_t chunk_size = this->get_chunk_size();
+		std::size_t chunks = (size - 1) / chunk_size + 1;
+
+		std::size_t chunk;
+		{
+			std::lock_guard lock{this->chunk_mutex};
+
+			// First fit, the remainder of the run stays free
+			auto run = std::find_if
+			(
+				this->free_chunk_runs.begin(), this->free_chunk_runs.end(),
+				[chunks](const auto& entry) { return entry.second >= chunks; }
+			);
+
+			if(run != this->free_chunk_runs.end())
+			{
+				auto [start, length] = *run;
+				this->free_chunk_runs.erase(run);
+
+				chunk = start;
+				if(length > chunks)
+				{
+					this->free_chunk_runs.emplace(start + chunks, length - chunks);
+				}
+			} else if(chunks <= this->get_chunk_capacity() - this->next_chunk)
+			{
+				chunk = this->next_chunk;
+				this->next_chunk += chunks;
+			} else
+			{
+				return std::nullopt;
+			}
+		}
+
+		auto first_id = this->client.allocate
+		(
+			chunk_size, size / chunk_size, size % chunk_size, type.name()
+		);
+
+		if(!first_id)
+		{
+			std::lock_guard lock{this->chunk_mutex};
+			this->free_chunks(chunk, chunks);
+
+			throw_network_failure();
+		}
+
+		for(std::size_t i = 0; i < chunks; ++i)
+		{
+			this->bind_chunk(chunk + i, *first_id + i);
+		}
+
+		{
+			std::lock_guard lock{this->chunk_mutex};
+			this->large_objects.insert(chunk, large_object{*first_id, chunks});
+		}
+
+		// As with other allocations, the header is written soon
+		std::size_t id = LARGE_ID_BIT | chunk;
+		this->wipe(id, std::min(size, chunk_size));
+
+		return id;
+	}
+
+	drop_result remote_manager::drop_large(std::size_t id)
 	{
-		if(!this->client.lift(id))
+		std::size_t chunk = id & ~LARGE_ID_BIT;
+
+		large_object object;
+		{
+			std::lock_guard lock{this->chunk_mutex};
+			object = *this->large_objects.search(chunk);
+		}
+
+		// Reference counts are kept by the first remote object, as with parts
+		auto result = this->client.drop(object.first_id);
+		if(!result || *result == drop_result::lost)
+		{
+			throw_network_failure();
+		} else if(*result == drop_result::reduced)
+		{
+			return drop_result::reduced;
+		}
+
+		// This destroys all objects in the allocation
+		allocation& header = this->get_base_of(id);
+		this->probe(&header, true);
+		dispose(header);
+
+		for(std::size_t i = 0; i < object.chunks; ++i)
+		{
+			this->discard(LARGE_ID_BIT | (chunk + i));
+		}
+
+		if(!this->client.drop_range(object.first_id, object.chunks))
 		{
 			throw_network_failure();
 		}
+
+		std::lock_guard lock{this->chunk_mutex};
+
+		this->large_objects.remove(chunk);
+		this->free_chunks(chunk, object.chunks);
+
+		return drop_result::lost;
+	}
+
+	void remote_manager::free_chunks(std::size_t chunk, std::size_t chunks)
+	{
+		auto& runs = this->free_chunk_runs;
+
+		// Merges with the run that follows, if adjacent
+		if(auto next = runs.find(chunk + chunks); next != runs.end())
+		{
+			chunks += next->second;
+			runs.erase(next);
+		}
+
+		// And with the one that precedes, if adjacent
+		if(auto next = runs.lower_bound(chunk); next != runs.begin())
+		{
+			if(auto previous = std::prev(next); previous->first + previous->second == chunk)
+			{
+				chunk = previous->first;
+				chunks += previous->second;
+				runs.erase(previous);
+			}
+		}
+
+		// A run at the end of the used chunks returns them to the unused ones
+		if(chunk + chunks == this->next_chunk)
+		{
+			this->next_chunk = chunk;
+		} else
+		{
+			runs.emplace(chunk, chunks);
+		}
+	}
+
+	void remote_manager::do_lift(std::size_t id)
+	{
+		if(is_packed(id))
+		{
+			std::lock_guard lock{this->packing_mutex};
+
+			auto [page, block] = this->find_packed(id);
+			++page->references[block];
+		} else if(is_large(id))
+		{
+			std::size_t first_id;
+			{
+				std::lock_guard lock{this->chunk_mutex};
+				first_id = this->large_objects.search(id & ~LARGE_ID_BIT)->first_id;
+			}
+
+			this->client.lift_async(first_id);
+		} else
+		{
+			this->client.lift_async(id);
+		}
 	}
 
 	drop_result remote_manager::do_drop(std::size_t id)
 	{
+		if(is_packed(id))
+		{
+			return this->drop_packed(id);
+		} else if(is_large(id))
+		{
+			return this->drop_large(id);
+		}
+
 		auto result = this->client.drop(id);
 		if(!result)
 		{
@@ -277,16 +1314,16 @@ namespace ce2103::mm
 				// This destroys all objects in the allocation
 				dispose(header);
 
-				// Finally, free all of the allocation's parts
+				// The server might reuse these IDs, so no stale copy may remain
 				for(std::size_t part = id; part < id + parts; ++part)
 				{
-					//! There might be a pending writeback operation
-					this->evict(part);
+					this->discard(part);
+				}
 
-					if(!this->client.drop(part))
-					{
-						throw_network_failure();
-					}
+				// Finally, free all of the allocation's parts at once
+				if(!this->client.drop_range(id, parts))
+				{
+					throw_network_failure();
 				}
 
 				return drop_result::lost;
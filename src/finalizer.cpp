@@ -0,0 +1,202 @@
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <algorithm>
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/slab.hpp"
+#include "ce2103/mm/finalizer.hpp"
+
+namespace ce2103::mm::_detail
+{
+	finalizer_pool::finalizer_pool(std::size_t threads)
+	: queues{std::make_unique<queue[]>(threads + 1)}
+	{
+		this->workers.reserve(threads);
+		for(std::size_t i = 0; i < threads; ++i)
+		{
+			this->workers.emplace_back(&finalizer_pool::work, this, i);
+		}
+	}
+
+	finalizer_pool::~finalizer_pool()
+	{
+		this->wait();
+		{
+			std::lock_guard lock{this->mutex};
+
+			this->stopping = true;
+			this->work_ready.notify_all();
+		}
+
+		for(auto& worker : this->workers)
+		{
+			worker.join();
+		}
+	}
+
+	void finalizer_pool::submit(std::vector<allocation*> batch)
+	{
+		for(std::size_t i = 0; i < batch.size();)
+		{
+			allocation* header = batch[i];
+
+			auto& type = header->payload_type;
+			if(type.destroy_n == nullptr || type.size * header->count <= CHUNK_SIZE)
+			{
+				++i;
+				continue;
+			}
+
+			std::size_t per_chunk = std::max<std::size_t>(CHUNK_SIZE / type.size, 1);
+
+			// The refcount of a dead allocation is reused to count unfinished chunks
+			header->references.store
+			(
+				(header->count + per_chunk - 1) / per_chunk, std::memory_order_relaxed
+			);
+
+			for(std::size_t first = 0; first < header->count; first += per_chunk)
+			{
+				this->push(task{{}, header, first, std::min(first + per_chunk, header->count)});
+			}
+
+			batch[i] = batch.back();
+			batch.pop_back();
+		}
+
+		if(!batch.empty())
+		{
+			this->push(task{std::move(batch)});
+		}
+	}
+
+	void finalizer_pool::wait()
+	{
+		task current;
+		while(this->take(this->workers.size(), current))
+		{
+			run(current);
+			this->finish();
+		}
+
+		std::unique_lock lock{this->mutex};
+		this->drained.wait(lock, [this]
+		{
+			return this->unfinished.load(std::memory_order_acquire) == 0;
+		});
+	}
+
+	void finalizer_pool::work(std::size_t index)
+	{
+		task current;
+		while(true)
+		{
+			if(this->take(index, current))
+			{
+				run(current);
+				this->finish();
+
+				continue;
+			}
+
+			std::unique_lock lock{this->mutex};
+			this->work_ready.wait(lock, [this]
+			{
+				return this->stopping || this->queued > 0;
+			});
+
+			if(this->stopping && this->queued == 0)
+			{
+				return;
+			}
+		}
+	}
+
+	void finalizer_pool::push(task&& work)
+	{
+		this->unfinished.fetch_add(1, std::memory_order_relaxed);
+
+		// Only the submitting thread touches next_queue
+		auto& target = this->queues[this->next_queue++ % (this->workers.size() + 1)];
+		{
+			std::lock_guard lock{target.mutex};
+			target.tasks.push_back(std::move(work));
+		}
+
+		std::lock_guard lock{this->mutex};
+
+		++this->queued;
+		this->work_ready.notify_one();
+	}
+
+	bool finalizer_pool::take(std::size_t index, task& output)
+	{
+		std::size_t count = this->workers.size() + 1;
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			auto& source = this->queues[(index + i) % count];
+
+			std::lock_guard lock{source.mutex};
+			if(source.tasks.empty())
+			{
+				continue;
+			}
+
+			// Owners work LIFO, thieves take the oldest tasks
+			if(i == 0)
+			{
+				output = std::move(source.tasks.back());
+				source.tasks.pop_back();
+			} else
+			{
+				output = std::move(source.tasks.front());
+				source.tasks.pop_front();
+			}
+
+			std::lock_guard count_lock{this->mutex};
+			--this->queued;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void finalizer_pool::run(task& work)
+	{
+		auto& allocator = slab_allocator::get_instance();
+		if(work.array == nullptr)
+		{
+			for(auto* header : work.batch)
+			{
+				header->destroy_all();
+				allocator.deallocate(header);
+			}
+
+			work.batch.clear();
+		} else
+		{
+			work.array->destroy_range(work.first, work.last);
+			if(work.array->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				allocator.deallocate(work.array);
+			}
+		}
+
+		// Drops by destructors must be visible once the pool is drained
+		garbage_collector::flush_deferred();
+	}
+
+	void finalizer_pool::finish()
+	{
+		if(this->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard lock{this->mutex};
+			this->drained.notify_all();
+		}
+	}
+}
@@ -1,36 +1,149 @@
 #include <new>
 #include <mutex>
+#include <atomic>
 #include <thread>
+#include <vector>
 #include <chrono>
 #include <utility>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <typeinfo>
 #include <stdexcept>
+#include <algorithm>
 
 #include "ce2103/rtti.hpp"
 
 #include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/slab.hpp"
 #include "ce2103/mm/debug.hpp"
+#include "ce2103/mm/finalizer.hpp"
 
 using ce2103::mm::at;
 
-namespace ce2103::mm
+namespace
 {
-	void allocation::destroy_all()
+	//! Source of round-robin home shard assignments for new threads
+	std::atomic<std::size_t> next_home_shard = 0;
+
+	//! Overrides a tuning parameter from the environment, if set and valid
+	void read_tuning(const char* variable, std::size_t& value)
 	{
-		auto* element_base = static_cast<char*>(this->get_payload_base());
-		if(this->payload_type.destructor != nullptr)
+		if(const char* text = std::getenv(variable); text != nullptr)
 		{
-			for(std::size_t i = 0; i < this->count; ++i)
+			char* end;
+			auto parsed = std::strtoull(text, &end, 10);
+
+			if(*text != '\0' && *end == '\0')
+			{
+				value = parsed;
+			} else
 			{
-				this->payload_type.destructor(element_base);
-				element_base += this->payload_type.size;
+				std::cerr << "=== Ignoring invalid " << variable << " ===\n";
 			}
 		}
 	}
 
+	//! Same as the other overload, for periods in milliseconds
+	void read_tuning(const char* variable, std::chrono::milliseconds& period)
+	{
+		std::size_t value = period.count();
+		read_tuning(variable, value);
+
+		period = std::chrono::milliseconds{value};
+	}
+
+	//! Adapts a callable into a tracer
+	template<typename Callback>
+	class tracer_of final : public ce2103::mm::tracer
+	{
+		public:
+			inline tracer_of(Callback callback)
+			: callback{std::move(callback)}
+			{}
+
+		private:
+			Callback callback;
+
+			virtual void visit(std::size_t id) final override
+			{
+				this->callback(id);
+			}
+	};
+}
+
+namespace ce2103::mm
+{
+	void allocation::destroy_range(std::size_t first, std::size_t last)
+	{
+		if(this->payload_type.destroy_n != nullptr && first < last)
+		{
+			auto* element_base = static_cast<char*>(this->get_payload_base());
+			this->payload_type.destroy_n(element_base + first * this->payload_type.size, last - first);
+		}
+	}
+
+	struct garbage_collector::reference_log
+	{
+		//! Power-of-two order of the number of slots
+		static constexpr std::size_t ORDER = 8;
+
+		//! Number of slots
+		static constexpr std::size_t CAPACITY = sizeof(char) << ORDER;
+
+		//! Occupied slots at which the log is flushed
+		static constexpr std::size_t FLUSH_THRESHOLD = CAPACITY * 3 / 4;
+
+		//! Coalesced decrements of a single allocation
+		struct entry
+		{
+			allocation*   header; //!< nullptr if the slot is free
+			std::size_t   id;     //!< ID of the allocation
+			std::uint32_t drops;  //!< Buffered decrements, might be zero
+		};
+
+		//! Open-addressed table, indexed by header address
+		entry entries[CAPACITY];
+
+		//! Number of occupied slots
+		std::size_t used;
+
+		//! Set on thread exit; decrements are applied immediately afterwards
+		bool retired;
+
+		//! Returns the preferred slot for a header.
+		static inline std::size_t get_slot_of(const allocation& header) noexcept
+		{
+			// Fibonacci hashing, headers are at least 16-byte aligned
+			auto address = reinterpret_cast<std::uintptr_t>(&header);
+			return (address >> 4) * 0x9e3779b97f4a7c15 >> (sizeof(std::uintptr_t) * 8 - ORDER);
+		}
+	};
+
+	struct garbage_collector::reference_log_guard
+	{
+		//! Applies the remaining decrements and retires the log
+		~reference_log_guard();
+	};
+
+	[[gnu::tls_model("initial-exec")]]
+	thread_local garbage_collector::reference_log* garbage_collector::deferred_drops = nullptr;
+
+	thread_local garbage_collector::reference_log_guard garbage_collector::deferred_drops_guard;
+
+	garbage_collector::reference_log_guard::~reference_log_guard()
+	{
+		flush_deferred();
+
+		// Shared by every exited thread, decrements are applied immediately
+		static reference_log retired_log = {{}, 0, true};
+
+		delete deferred_drops;
+		deferred_drops = &retired_log;
+	}
+
 	std::string allocation::make_representation()
 	{
 		std::string output;
@@ -55,8 +168,11 @@ namespace ce2103::mm
 
 	void memory_manager::evict(std::size_t id)
 	{
-		auto representation = this->get_base_of(id).make_representation();
-		_detail::memory_debug_log("write", id, this->get_locality(), "value", std::move(representation));
+		if(_detail::is_debug_enabled())
+		{
+			auto representation = this->get_base_of(id).make_representation();
+			_detail::memory_debug_log("write", id, this->get_locality(), "value", std::move(representation));
+		}
 
 		this->do_evict(id);
 	}
@@ -68,48 +184,155 @@ namespace ce2103::mm
 		return gc;
 	}
 
-	void garbage_collector::require_contiguous_ids(std::size_t ids) noexcept
+	void garbage_collector::require_contiguous_ids(std::size_t ids)
 	{
-		std::size_t test_from = this->next_id;
+		auto& shard = this->get_home_shard();
+		std::lock_guard lock{shard.mutex};
 
-		// Check that the expected range is completely free
-		bool found = false;
-		while(!found)
+		// Whatever is left of the current blocks is skipped if too short
+		if(ids > shard.block_end - shard.next_id)
 		{
-			found = true;
-			for(std::size_t candidate = test_from; candidate < test_from + ids; ++candidate)
-			{
-				if(this->allocations.search(candidate) != nullptr)
-				{
-					found = false;
-					test_from = candidate + 1;
+			this->claim_ids(shard, ids);
+		}
+	}
 
-					break;
-				}
+	std::size_t garbage_collector::collect()
+	{
+		flush_deferred();
+
+		std::unique_lock lock{this->mutex};
+
+		std::size_t serial = ++this->requested_sweeps;
+		++this->schedule_stats.requests;
+
+		this->wakeup.notify_one();
+
+		this->swept.wait(lock, [&, this]
+		{
+			return this->completed_sweeps >= serial;
+		});
+
+		return this->last_freed;
+	}
+
+	void garbage_collector::set_cycle_collection(bool enabled) noexcept
+	{
+		tracks_cycles.store(enabled, std::memory_order_relaxed);
+	}
+
+	void garbage_collector::set_deferred_references(bool enabled) noexcept
+	{
+		defers_references.store(enabled, std::memory_order_relaxed);
+	}
+
+	void garbage_collector::flush_deferred()
+	{
+		if(deferred_drops == nullptr || deferred_drops->used == 0)
+		{
+			return;
+		}
+
+		auto& log = *deferred_drops;
+
+		// Releasing never runs destructors, so the log can't be reentered
+		for(auto& entry : log.entries)
+		{
+			if(entry.header != nullptr && entry.drops > 0)
+			{
+				release(*entry.header, entry.id, entry.drops);
 			}
+
+			entry.header = nullptr;
 		}
 
-		this->next_id = test_from;
+		log.used = 0;
 	}
 
-	allocation& garbage_collector::get_base_of(std::size_t id)
+	garbage_collector::stopped_world::stopped_world()
+	: lock{get_instance().world_mutex}
+	{}
+
+	std::size_t garbage_collector::collect_cycles(const stopped_world&)
+	{
+		flush_deferred();
+
+		std::unique_lock lock{this->mutex};
+
+		std::size_t serial = ++this->requested_sweeps;
+		this->cycles_requested = serial;
+		++this->schedule_stats.requests;
+
+		this->wakeup.notify_one();
+
+		this->swept.wait(lock, [&, this]
+		{
+			return this->completed_sweeps >= serial;
+		});
+
+		return this->last_freed;
+	}
+
+	generation_stats garbage_collector::get_stats(generation which) const
+	{
+		std::lock_guard lock{this->mutex};
+		return which == generation::young ? this->young_stats : this->old_stats;
+	}
+
+	gc_schedule_stats garbage_collector::get_schedule_stats() const
+	{
+		std::lock_guard lock{this->mutex};
+		return this->schedule_stats;
+	}
+
+	gc_tuning garbage_collector::get_tuning() const
 	{
 		std::lock_guard lock{this->mutex};
+		return this->tuning;
+	}
 
-		auto* count_base = this->allocations.search(id);
-		if(count_base == nullptr)
+	void garbage_collector::set_tuning(const gc_tuning& tuning)
+	{
+		std::lock_guard lock{this->mutex};
+
+		this->tuning = tuning;
+		this->tuning.min_period = std::max(tuning.min_period, std::chrono::milliseconds{1});
+		this->tuning.max_period = std::max(tuning.max_period, this->tuning.min_period);
+
+		this->dead_count_threshold.store(tuning.dead_count, std::memory_order_relaxed);
+		this->dead_bytes_threshold.store(tuning.dead_bytes, std::memory_order_relaxed);
+	}
+
+	allocation& garbage_collector::get_base_of(std::size_t id)
+	{
+		auto& shard = this->get_shard_of(id);
+		std::lock_guard lock{shard.mutex};
+
+		auto* base = shard.allocations.search(id);
+		if(base == nullptr)
 		{
 			throw std::invalid_argument{"ID is unassigned"};
 		}
 
-		[[maybe_unused]]
-		auto [count, base] = *count_base;
-
-		return *base;
+		return **base;
 	}
 
 	garbage_collector::garbage_collector()
 	{
+		// Ensures that the slab allocator outlives this instance
+		slab_allocator::get_instance();
+
+		gc_tuning tuning;
+		tuning.finalizer_threads = std::clamp(std::thread::hardware_concurrency(), 1u, 4u) - 1;
+
+		read_tuning("MM_GC_FINALIZERS", tuning.finalizer_threads);
+		read_tuning("MM_GC_DEAD_COUNT", tuning.dead_count);
+		read_tuning("MM_GC_DEAD_BYTES", tuning.dead_bytes);
+		read_tuning("MM_GC_MIN_PERIOD_MS", tuning.min_period);
+		read_tuning("MM_GC_MAX_PERIOD_MS", tuning.max_period);
+		read_tuning("MM_GC_MAJOR_PERIOD_MS", tuning.major_period);
+
+		this->set_tuning(tuning);
+
 		std::lock_guard lock{this->mutex};
 		this->thread = std::thread{&garbage_collector::main_loop, this};
 	}
@@ -130,102 +353,295 @@ namespace ce2103::mm
 
 	std::size_t garbage_collector::allocate(std::size_t size, const std::type_info&)
 	{
-		void* base = ::operator new(size);
+		void* base = slab_allocator::get_instance().allocate(size);
 
-		std::lock_guard lock{this->mutex};
+		auto& shard = this->get_home_shard();
+		std::lock_guard lock{shard.mutex};
 
-		std::size_t id;
-		do
+		if(shard.next_id == shard.block_end)
 		{
-			id = this->next_id++;
-		} while(this->allocations.search(id) != nullptr);
+			this->claim_ids(shard, 1);
+		}
+
+		std::size_t id = shard.next_id++;
+
+		// The header's refcount is initialized to 1 by allocate_of()
+		shard.allocations.insert(id, static_cast<allocation*>(base));
+		++shard.nursery_live;
 
-		this->allocations.insert(id, std::make_pair(1, static_cast<allocation*>(base)));
 		return id;
 	}
 
 	void garbage_collector::do_lift(std::size_t id)
 	{
-		std::lock_guard lock{this->mutex};
+		auto& shard = this->get_shard_of(id);
+		std::lock_guard lock{shard.mutex};
 
-		auto* pair = this->allocations.search(id);
-		assert(pair != nullptr);
+		auto* header = shard.allocations.search(id);
+		assert(header != nullptr);
 
-		++pair->first;
+		(*header)->references.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	drop_result garbage_collector::do_drop(std::size_t id)
 	{
-		std::lock_guard lock{this->mutex};
+		auto& shard = this->get_shard_of(id);
+		std::unique_lock lock{shard.mutex};
 
-		auto* pair = this->allocations.search(id);
-		assert(pair != nullptr && pair->first > 0);
+		auto* found = shard.allocations.search(id);
+		assert(found != nullptr && (*found)->references > 0);
 
-		switch(--pair->first)
-		{
-			case 1:
-				return drop_result::hanging;
+		// Entries might move once the lock is released
+		allocation* header = *found;
 
+		switch(header->references.fetch_sub(1, std::memory_order_acq_rel) - 1)
+		{
 			case 0:
+			{
+				// The object will be freed in the next sweep
+				bool crossed = this->push_dead(shard, id, header->get_total_size());
+				lock.unlock();
+
+				if(crossed)
+				{
+					this->trigger_sweep();
+				}
+
 				return drop_result::lost;
+			}
+
+			case 1:
+				lock.unlock();
+				buffer_candidate(*header, id);
+
+				return drop_result::hanging;
 
 			default:
+				lock.unlock();
+				buffer_candidate(*header, id);
+
 				return drop_result::reduced;
 		}
 	}
 
-	void garbage_collector::main_loop()
+	void garbage_collector::lift_range(std::size_t first, std::size_t count, std::uint32_t times)
 	{
-		constexpr std::chrono::seconds GC_PERIOD{5};
+		std::size_t last = first + count;
+		for(std::size_t id = first; id < last;)
+		{
+			// Ownership only changes at block boundaries
+			std::size_t run_end = std::min(last, (id | (SHARD_SPAN - 1)) + 1);
+
+			auto& shard = this->get_shard_of(id);
+			std::lock_guard lock{shard.mutex};
+
+			for(; id < run_end; ++id)
+			{
+				auto* header = shard.allocations.search(id);
+				assert(header != nullptr);
+
+				(*header)->references.fetch_add(times, std::memory_order_relaxed);
+			}
+		}
+
+		for(std::size_t id = first; id < last; ++id)
+		{
+			_detail::memory_debug_log("lift", id, at::local);
+		}
+	}
+
+	std::vector<drop_result> garbage_collector::drop_range(std::size_t first, std::size_t count)
+	{
+		std::vector<drop_result> results;
+		std::vector<allocation*> survivors;
+
+		results.reserve(count);
+		survivors.reserve(count);
+
+		bool crossed = false;
+
+		std::size_t last = first + count;
+		for(std::size_t id = first; id < last;)
+		{
+			std::size_t run_end = std::min(last, (id | (SHARD_SPAN - 1)) + 1);
+
+			auto& shard = this->get_shard_of(id);
+			std::lock_guard lock{shard.mutex};
+
+			for(; id < run_end; ++id)
+			{
+				auto* found = shard.allocations.search(id);
+				assert(found != nullptr && (*found)->references > 0);
+
+				allocation* header = *found;
+				switch(header->references.fetch_sub(1, std::memory_order_acq_rel) - 1)
+				{
+					case 0:
+						// The object will be freed in the next sweep
+						crossed = this->push_dead(shard, id, header->get_total_size()) || crossed;
+						results.push_back(drop_result::lost);
+						survivors.push_back(nullptr);
+
+						break;
+
+					case 1:
+						results.push_back(drop_result::hanging);
+						survivors.push_back(header);
+
+						break;
 
+					default:
+						results.push_back(drop_result::reduced);
+						survivors.push_back(header);
+
+						break;
+				}
+			}
+		}
+
+		if(crossed)
+		{
+			this->trigger_sweep();
+		}
+
+		// Cycle candidates are buffered under the shard lock, so it must be released first
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			if(survivors[i] != nullptr)
+			{
+				buffer_candidate(*survivors[i], first + i);
+			}
+
+			_detail::memory_debug_log("drop", first + i, at::local);
+		}
+
+		return results;
+	}
+
+	void garbage_collector::main_loop()
+	{
 		std::unique_lock lock{this->mutex};
 		bool is_last_run;
 
+		auto period = this->tuning.min_period;
+		auto last_major = std::chrono::steady_clock::now();
+
 		do
 		{
 			//! Non-joinability indicates GC termination.
-			is_last_run = this->wakeup.wait_for(lock, GC_PERIOD, [this]
+			bool woken = this->wakeup.wait_for(lock, period, [this]
 			{
-				return !this->thread.joinable();
+				return !this->thread.joinable() || this->sweep_triggered
+				    || this->requested_sweeps > this->completed_sweeps;
 			});
 
-			bool modified;
-			do
+			is_last_run = !this->thread.joinable();
+
+			// Requests made while sweeping must wait for the next sweep
+			std::size_t serial = this->requested_sweeps;
+			bool triggered = this->sweep_triggered;
+
+			if(triggered)
 			{
-				modified = false;
-				for(const auto& [id, pair] : this->allocations)
-				{
-					auto [count, header] = pair;
-					if(count == 0)
-					{
-						this->allocations.remove(id);
+				++this->schedule_stats.triggers;
+			} else if(!woken)
+			{
+				++this->schedule_stats.timeouts;
+			}
 
-						/* Otherwise could deadlock (eg, if a VSPtr<T> is destroyed,
-						 * therefore calling this->drop()).
-						 */
-						lock.unlock();
+			this->sweep_triggered = false;
 
-						// Destroy the objects and then the free the allocation
-						dispose(*header);
-						::operator delete(header);
+			auto start = std::chrono::steady_clock::now();
+			bool major =    is_last_run || serial > this->completed_sweeps
+			             || this->pending[1].triggered.load(std::memory_order_relaxed)
+			             || (start - last_major >= this->tuning.major_period
+			             &&  this->pending[1].count.load(std::memory_order_relaxed) > 0);
 
-						lock.lock();
+			// Only requests come with a stopped world, see collect_cycles()
+			bool find_cycles = !is_last_run && this->cycles_requested > this->completed_sweeps;
 
-						modified = true;
-						break;
-					}
+			std::size_t finalizer_threads = is_last_run ? 0 : this->tuning.finalizer_threads;
+
+			lock.unlock();
+
+			auto& pool = this->finalizers;
+			if(finalizer_threads != (pool != nullptr ? pool->get_thread_count() : 0))
+			{
+				this->finalizers.reset();
+				if(finalizer_threads > 0)
+				{
+					this->finalizers = std::make_unique<_detail::finalizer_pool>(finalizer_threads);
 				}
-			} while(modified);
+			}
+
+			// Garbage from now on is accounted for the next sweep
+			for(std::size_t i = 0; i < (major ? 2 : 1); ++i)
+			{
+				this->pending[i].count.store(0, std::memory_order_relaxed);
+				this->pending[i].bytes.store(0, std::memory_order_relaxed);
+				this->pending[i].triggered.store(false, std::memory_order_relaxed);
+			}
+
+			std::size_t promoted;
+			std::size_t freed = this->sweep(major, promoted);
+
+			if(find_cycles)
+			{
+				// Destroyed cycles might hold the last references to other objects
+				std::size_t also_promoted;
+				freed += this->free_cycles();
+				freed += this->sweep(true, also_promoted);
+
+				promoted += also_promoted;
+			}
+
+			auto pause = std::chrono::steady_clock::now() - start;
+
+			lock.lock();
+
+			auto& stats = major ? this->old_stats : this->young_stats;
+			++stats.sweeps;
+			stats.freed += freed;
+			stats.total_pause += pause;
+			stats.max_pause = std::max<std::chrono::nanoseconds>(stats.max_pause, pause);
+
+			// Survivors of any sweep leave the nursery
+			this->young_stats.promoted += promoted;
+
+			++this->schedule_stats.sweeps;
+			if(freed == 0)
+			{
+				++this->schedule_stats.idle;
+			}
+
+			// Back off exponentially while there is nothing to do
+			period = freed > 0 || triggered ? this->tuning.min_period
+			       : std::min(period * 2, this->tuning.max_period);
+
+			if(major)
+			{
+				last_major = start;
+
+				this->last_freed = freed;
+				this->completed_sweeps = serial;
+				this->swept.notify_all();
+			}
 		} while(!is_last_run);
 
 		// By design, unattended circular references might cause leaks
-		if(this->allocations.get_size() > 0)
+		bool leaked = false;
+		for(auto& shard : this->shards)
 		{
-			std::cerr << "=== These allocations have stale references at GC termination ===\n";
-
-			for(const auto& [id, pair] : this->allocations)
+			std::lock_guard shard_lock{shard.mutex};
+			for(const auto& [id, header] : shard.allocations)
 			{
-				auto [count, header] = pair;
+				if(!leaked)
+				{
+					leaked = true;
+					std::cerr << "=== These allocations have stale references at GC termination ===\n";
+				}
+
+				std::size_t count = header->references;
 
 				std::cerr << "  - " << count << " reference";
 				if(count > 1)
@@ -235,8 +651,465 @@ namespace ce2103::mm
 
 				std::cerr << " to [" << id << ": " << demangle(header->get_type()) << "]\n";
 			}
+		}
 
+		if(leaked)
+		{
 			std::cerr << "=== Memory has been leaked ===\n";
 		}
 	}
+
+	std::size_t garbage_collector::sweep(bool major, std::size_t& promoted)
+	{
+		//! Maximum number of allocations freed per lock release
+		constexpr std::size_t SWEEP_BATCH = 256;
+
+		std::vector<allocation*> batch;
+		batch.reserve(SWEEP_BATCH);
+
+		std::size_t freed = 0;
+		promoted = 0;
+
+		// Minor sweeps leave the old generation's dead for later
+		auto next_dead = [major](shard& target) -> std::vector<std::size_t>*
+		{
+			if(!target.young_dead.empty())
+			{
+				return &target.young_dead;
+			} else if(major && !target.old_dead.empty())
+			{
+				return &target.old_dead;
+			}
+
+			return nullptr;
+		};
+
+		/* Destroying objects might drop references to others in any
+		 * shard, so shards are walked again until all of them are clean.
+		 */
+		bool modified;
+		do
+		{
+			modified = false;
+			for(auto& shard : this->shards)
+			{
+				std::unique_lock lock{shard.mutex};
+				while(auto* dead = next_dead(shard))
+				{
+					while(batch.size() < SWEEP_BATCH && !dead->empty())
+					{
+						std::size_t id = dead->back();
+						dead->pop_back();
+
+						/* An ID might appear more than once, or its object might have
+						 * been lifted again after reaching zero, so it is checked again.
+						 */
+						auto* header = shard.allocations.search(id);
+						if(header != nullptr && (*header)->references == 0)
+						{
+							batch.push_back(*header);
+							shard.allocations.remove(id);
+						}
+					}
+
+					/* Otherwise could deadlock (eg, if a VSPtr<T> is destroyed,
+					 * therefore calling this->drop()).
+					 */
+					lock.unlock();
+
+					freed += batch.size();
+					modified = modified || !batch.empty();
+
+					if(this->finalizers != nullptr)
+					{
+						this->finalizers->submit(std::move(batch));
+
+						batch = {};
+						batch.reserve(SWEEP_BATCH);
+					} else
+					{
+						// Destroy the objects and then the free the allocations
+						for(auto* header : batch)
+						{
+							dispose(*header);
+							slab_allocator::get_instance().deallocate(header);
+						}
+
+						// Makes drops by destructors visible to the next pass
+						flush_deferred();
+						batch.clear();
+					}
+
+					lock.lock();
+				}
+
+				// Whatever remains in the nursery has survived this sweep
+				promoted += shard.nursery_live;
+
+				shard.nursery_live = 0;
+				shard.nursery_start = shard.next_id;
+			}
+
+			// Destructors that are still running might drop more references
+			if(this->finalizers != nullptr)
+			{
+				this->finalizers->wait();
+			}
+		} while(modified);
+
+		return freed;
+	}
+
+	std::size_t garbage_collector::free_cycles()
+	{
+		using color = allocation::cycle_color;
+		using node = std::pair<std::size_t, allocation*>;
+
+		auto find = [this](std::size_t id) -> allocation*
+		{
+			auto& shard = this->get_shard_of(id);
+			std::lock_guard lock{shard.mutex};
+
+			auto* found = shard.allocations.search(id);
+			return found != nullptr ? *found : nullptr;
+		};
+
+		auto for_each_child = [&find](allocation& parent, auto action)
+		{
+			if(parent.payload_type.trace != nullptr)
+			{
+				tracer_of visitor{[&](std::size_t id)
+				{
+					if(auto* child = find(id); child != nullptr)
+					{
+						action(node{id, child});
+					}
+				}};
+
+				parent.payload_type.trace(parent.get_payload_base(), parent.count, visitor);
+			}
+		};
+
+		// Candidates whose refcount is already zero will be swept normally
+		std::vector<node> roots;
+		for(auto& shard : this->shards)
+		{
+			std::lock_guard lock{shard.mutex};
+			for(std::size_t id : shard.candidates)
+			{
+				auto* found = shard.allocations.search(id);
+				if(found != nullptr)
+				{
+					(*found)->buffered.store(false, std::memory_order_relaxed);
+					if((*found)->references > 0)
+					{
+						roots.emplace_back(id, *found);
+					}
+				}
+			}
+
+			shard.candidates.clear();
+		}
+
+		/* Iterative forms of MarkGray(), Scan(), ScanBlack() and CollectWhite(),
+		 * as described by Bacon and Rajan. Subtracting internal references
+		 * leaves nonzero counts only on objects reachable from outside.
+		 */
+		std::vector<node> pending;
+		for(auto root : roots)
+		{
+			if(root.second->color != color::gray)
+			{
+				root.second->color = color::gray;
+				pending.push_back(root);
+			}
+
+			while(!pending.empty())
+			{
+				auto [id, header] = pending.back();
+				pending.pop_back();
+
+				for_each_child(*header, [&pending](node child)
+				{
+					child.second->references.fetch_sub(1, std::memory_order_relaxed);
+					if(child.second->color != color::gray)
+					{
+						child.second->color = color::gray;
+						pending.push_back(child);
+					}
+				});
+			}
+		}
+
+		auto scan_black = [&for_each_child](allocation& reachable)
+		{
+			std::vector<allocation*> blackened{&reachable};
+			reachable.color = color::black;
+
+			while(!blackened.empty())
+			{
+				auto* header = blackened.back();
+				blackened.pop_back();
+
+				for_each_child(*header, [&blackened](node child)
+				{
+					child.second->references.fetch_add(1, std::memory_order_relaxed);
+					if(child.second->color != color::black)
+					{
+						child.second->color = color::black;
+						blackened.push_back(child.second);
+					}
+				});
+			}
+		};
+
+		for(auto root : roots)
+		{
+			pending.push_back(root);
+			while(!pending.empty())
+			{
+				auto [id, header] = pending.back();
+				pending.pop_back();
+
+				if(header->color != color::gray)
+				{
+					continue;
+				} else if(header->references > 0)
+				{
+					scan_black(*header);
+					continue;
+				}
+
+				header->color = color::white;
+				for_each_child(*header, [&pending](node child)
+				{
+					pending.push_back(child);
+				});
+			}
+		}
+
+		std::vector<node> garbage;
+		for(auto root : roots)
+		{
+			pending.push_back(root);
+			while(!pending.empty())
+			{
+				auto current = pending.back();
+				pending.pop_back();
+
+				if(current.second->color == color::white)
+				{
+					current.second->color = color::black;
+					garbage.push_back(current);
+
+					for_each_child(*current.second, [&pending](node child)
+					{
+						pending.push_back(child);
+					});
+				}
+			}
+		}
+
+		/* Restores the references held by garbage objects, so that
+		 * destructors drop them as usual. An extra reference to each
+		 * garbage object prevents it from being swept meanwhile.
+		 */
+		for(auto [id, header] : garbage)
+		{
+			for_each_child(*header, [](node child)
+			{
+				child.second->references.fetch_add(1, std::memory_order_relaxed);
+			});
+		}
+
+		for(auto [id, header] : garbage)
+		{
+			header->references.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		for(auto [id, header] : garbage)
+		{
+			dispose(*header);
+		}
+
+		flush_deferred();
+
+		for(auto [id, header] : garbage)
+		{
+			assert(header->references == 1);
+			{
+				auto& shard = this->get_shard_of(id);
+
+				std::lock_guard lock{shard.mutex};
+				shard.allocations.remove(id);
+			}
+
+			slab_allocator::get_instance().deallocate(header);
+		}
+
+		return garbage.size();
+	}
+
+	void garbage_collector::mark_dead(const allocation& header, std::size_t id)
+	{
+		auto& shard = this->get_shard_of(id);
+		std::size_t size = header.get_total_size();
+
+		bool crossed;
+		{
+			std::lock_guard lock{shard.mutex};
+			crossed = this->push_dead(shard, id, size);
+		}
+
+		if(crossed)
+		{
+			this->trigger_sweep();
+		}
+	}
+
+	void garbage_collector::defer_drop(allocation& header, std::size_t id)
+	{
+		using log_type = reference_log;
+
+		if(deferred_drops == nullptr)
+		{
+			deferred_drops = new reference_log{};
+
+			// Registers the log for flushing at thread exit
+			[[maybe_unused]]
+			volatile auto* guard = &deferred_drops_guard;
+		}
+
+		auto& log = *deferred_drops;
+		if(log.retired)
+		{
+			release(header, id, 1);
+			return;
+		}
+
+		std::size_t slot = log_type::get_slot_of(header);
+		while(true)
+		{
+			auto& entry = log.entries[slot];
+			if(entry.header == &header)
+			{
+				// A cancelled entry might be stale if its allocation was freed meanwhile
+				if(entry.drops++ == 0)
+				{
+					entry.id = id;
+				}
+
+				return;
+			} else if(entry.header == nullptr)
+			{
+				entry = log_type::entry{&header, id, 1};
+				if(++log.used >= log_type::FLUSH_THRESHOLD)
+				{
+					flush_deferred();
+				}
+
+				return;
+			}
+
+			slot = (slot + 1) & (log_type::CAPACITY - 1);
+		}
+	}
+
+	bool garbage_collector::cancel_deferred_drop(allocation& header) noexcept
+	{
+		if(deferred_drops == nullptr || deferred_drops->used == 0)
+		{
+			return false;
+		}
+
+		auto& log = *deferred_drops;
+
+		std::size_t slot = reference_log::get_slot_of(header);
+		while(true)
+		{
+			auto& entry = log.entries[slot];
+			if(entry.header == nullptr)
+			{
+				return false;
+			} else if(entry.header == &header)
+			{
+				if(entry.drops == 0)
+				{
+					return false;
+				}
+
+				--entry.drops;
+				return true;
+			}
+
+			slot = (slot + 1) & (reference_log::CAPACITY - 1);
+		}
+	}
+
+	bool garbage_collector::push_dead(shard& owner, std::size_t id, std::size_t size)
+	{
+		bool is_young = id >= owner.nursery_start;
+		if(is_young)
+		{
+			owner.young_dead.push_back(id);
+			if(owner.nursery_live > 0)
+			{
+				--owner.nursery_live;
+			}
+		} else
+		{
+			owner.old_dead.push_back(id);
+		}
+
+		auto& counter = this->pending[is_young ? 0 : 1];
+
+		std::size_t count = counter.count.fetch_add(1, std::memory_order_relaxed) + 1;
+		std::size_t bytes = counter.bytes.fetch_add(size, std::memory_order_relaxed) + size;
+
+		return (count >= this->dead_count_threshold.load(std::memory_order_relaxed)
+		    || bytes >= this->dead_bytes_threshold.load(std::memory_order_relaxed))
+		    && !counter.triggered.exchange(true, std::memory_order_relaxed);
+	}
+
+	void garbage_collector::trigger_sweep()
+	{
+		std::lock_guard lock{this->mutex};
+
+		this->sweep_triggered = true;
+		this->wakeup.notify_one();
+	}
+
+	auto garbage_collector::get_home_shard() noexcept -> shard&
+	{
+		thread_local std::size_t home = next_home_shard++ % SHARD_COUNT;
+		return this->shards[home];
+	}
+
+	void garbage_collector::claim_ids(shard& owner, std::size_t ids)
+	{
+		std::lock_guard lock{this->block_mutex};
+
+		// IDs within a shard must keep increasing, see shard::nursery_start
+		std::size_t start = this->next_block << SHARD_SPAN_ORDER;
+		if(owner.block_end == start)
+		{
+			start = owner.next_id;
+		}
+
+		if(ids > (MAX_BLOCKS << SHARD_SPAN_ORDER) - start)
+		{
+			throw std::bad_alloc{};
+		}
+
+		auto index = static_cast<std::uint8_t>(&owner - this->shards);
+		std::size_t end_block = (start + ids + SHARD_SPAN - 1) >> SHARD_SPAN_ORDER;
+
+		for(; this->next_block < end_block; ++this->next_block)
+		{
+			this->block_owners[this->next_block].store(index, std::memory_order_relaxed);
+		}
+
+		owner.next_id = start;
+		owner.block_end = end_block << SHARD_SPAN_ORDER;
+	}
 }
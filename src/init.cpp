@@ -148,6 +148,15 @@ namespace
 		// This starts the GC thread.
 		default_manager = &ce2103::mm::garbage_collector::get_instance();
 	}
+
+	//! Applies settings that don't depend on the default manager
+	void apply_options(const ce2103::mm::options& settings)
+	{
+		using ce2103::mm::refcounting, ce2103::mm::garbage_collector;
+
+		bool deferred = settings.local_references == refcounting::deferred;
+		garbage_collector::set_deferred_references(deferred);
+	}
 }
 
 namespace ce2103::mm
@@ -161,6 +170,11 @@ namespace ce2103::mm
 		this->value = stream.str();
 	}
 
+	bool _detail::is_debug_enabled() noexcept
+	{
+		return debug_logger.has_value();
+	}
+
 	void _detail::debug_log(debug_chain* last)
 	{
 		if(debug_logger)
@@ -169,18 +183,19 @@ namespace ce2103::mm
 		}
 	}
 
-	void initialize_local()
+	void initialize_local(const options& settings)
 	{
-		std::call_once(initialization_flag, []()
+		std::call_once(initialization_flag, [&]()
 		{
 			initialize_debug();
+			apply_options(settings);
 			set_local_default();
 		});
 	}
 
-	void initialize()
+	void initialize(const options& settings)
 	{
-		auto perform = []()
+		auto perform = [&settings]()
 		{
 			using ce2103::mm::remote_manager, ce2103::socket, ce2103::ip_endpoint;
 
@@ -199,7 +214,11 @@ namespace ce2103::mm
 				} else if(!client_socket.connect(*endpoint))
 				{
 					std::cerr << "=== Connection to server failed ===\n";
-				} else if(!remote_manager::initialize(std::move(client_socket), key))
+				} else if(!remote_manager::initialize
+				(
+					std::move(client_socket), key, settings.remote_paging,
+					settings.large_object_threshold, settings.compress_remote_pages
+				))
 				{
 					std::cerr << "=== Handshake failed (wrong MM_PSK?) ===\n";
 				} else
@@ -225,6 +244,7 @@ namespace ce2103::mm
 		std::call_once(initialization_flag, [&]()
 		{
 			initialize_debug();
+			apply_options(settings);
 			perform();
 		});
 	}
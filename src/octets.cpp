@@ -0,0 +1,414 @@
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "ce2103/mm/octets.hpp"
+
+using ce2103::mm::_detail::octet_isa;
+using ce2103::mm::_detail::octet_kernels;
+using ce2103::mm::_detail::ZERO_RUN_LENGTH;
+
+namespace
+{
+	//! Lowercase hex digits by value
+	constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+	//! Values of hex digits by character, 0xff for anything else
+	struct nibble_table
+	{
+		std::uint8_t values[256];
+
+		constexpr nibble_table() noexcept
+		: values{}
+		{
+			for(auto& value : this->values)
+			{
+				value = 0xff;
+			}
+
+			for(std::uint8_t i = 0; i < 16; ++i)
+			{
+				this->values[static_cast<std::uint8_t>(HEX_DIGITS[i])] = i;
+			}
+		}
+	};
+
+	constexpr nibble_table NIBBLES;
+
+	void encode_hex_scalar(const char* input, std::size_t length, char* output) noexcept
+	{
+		for(std::size_t i = 0; i < length; ++i)
+		{
+			auto byte = static_cast<std::uint8_t>(input[i]);
+
+			output[2 * i] = HEX_DIGITS[byte >> 4];
+			output[2 * i + 1] = HEX_DIGITS[byte & 0x0f];
+		}
+	}
+
+	bool decode_hex_scalar(const char* input, std::size_t length, char* output) noexcept
+	{
+		// Invalid characters map to values with high bits set, which accumulate
+		std::uint8_t seen = 0;
+		for(std::size_t i = 0; i < length; ++i)
+		{
+			std::uint8_t high = NIBBLES.values[static_cast<std::uint8_t>(input[2 * i])];
+			std::uint8_t low = NIBBLES.values[static_cast<std::uint8_t>(input[2 * i + 1])];
+
+			seen |= high | low;
+			output[i] = static_cast<char>(high << 4 | low);
+		}
+
+		return (seen & 0xf0) == 0;
+	}
+
+	std::size_t find_zero_run_scalar(const char* input, std::size_t length) noexcept
+	{
+		std::size_t run = 0;
+		for(std::size_t i = 0; i < length; ++i)
+		{
+			run = input[i] == '\0' ? run + 1 : 0;
+			if(run == ZERO_RUN_LENGTH)
+			{
+				return i + 1 - ZERO_RUN_LENGTH;
+			}
+		}
+
+		return length;
+	}
+
+	std::size_t find_nonzero_scalar(const char* input, std::size_t length) noexcept
+	{
+		std::size_t i = 0;
+		while(i < length && input[i] == '\0')
+		{
+			++i;
+		}
+
+		return i;
+	}
+
+	//! Offset of the first run start among the zero bytes of a 64-byte window, if any
+	inline std::size_t find_run_start(std::uint64_t zeros) noexcept
+	{
+		static_assert(ZERO_RUN_LENGTH == 3);
+
+		// Runs near the end are missed, since their last bytes lie past the window
+		std::uint64_t starts = zeros & zeros >> 1 & zeros >> 2;
+		return starts != 0 ? __builtin_ctzll(starts) : 64;
+	}
+
+	constexpr octet_kernels scalar_kernels
+	{
+		octet_isa::scalar, encode_hex_scalar, decode_hex_scalar,
+		find_zero_run_scalar, find_nonzero_scalar
+	};
+
+#ifdef __SSE2__
+	//! Converts a nibble per byte to lowercase hex digits.
+	inline __m128i to_hex_sse2(__m128i nibbles) noexcept
+	{
+		__m128i letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+		__m128i digits = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+
+		return _mm_add_epi8(digits, _mm_and_si128(letters, _mm_set1_epi8('a' - '0' - 10)));
+	}
+
+	/*!
+	 * \brief Converts lowercase hex digits to a nibble per byte, setting
+	 *        the lanes of 'invalid' which held any other character.
+	 */
+	inline __m128i from_hex_sse2(__m128i digits, __m128i& invalid) noexcept
+	{
+		// Signed comparisons also reject non-ASCII characters, which are negative
+		__m128i is_digit = _mm_and_si128
+		(
+			_mm_cmpgt_epi8(digits, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(digits, _mm_set1_epi8('9' + 1))
+		);
+
+		__m128i is_letter = _mm_and_si128
+		(
+			_mm_cmpgt_epi8(digits, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(digits, _mm_set1_epi8('f' + 1))
+		);
+
+		invalid = _mm_or_si128(invalid, _mm_cmpeq_epi8(_mm_or_si128(is_digit, is_letter), _mm_setzero_si128()));
+
+		__m128i digit_values = _mm_and_si128(is_digit, _mm_sub_epi8(digits, _mm_set1_epi8('0')));
+		__m128i letter_values = _mm_and_si128(is_letter, _mm_sub_epi8(digits, _mm_set1_epi8('a' - 10)));
+
+		return _mm_or_si128(digit_values, letter_values);
+	}
+
+	//! Joins each pair of nibbles, high first, into the low byte of its 16-bit lane.
+	inline __m128i join_nibbles_sse2(__m128i nibbles) noexcept
+	{
+		__m128i joined = _mm_or_si128(_mm_slli_epi16(nibbles, 4), _mm_srli_epi16(nibbles, 8));
+		return _mm_and_si128(joined, _mm_set1_epi16(0x00ff));
+	}
+
+	//! Bit mask of the zero bytes among the 16 at 'input'
+	inline std::uint32_t zero_mask_sse2(const char* input) noexcept
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+		return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128())));
+	}
+
+	void encode_hex_sse2(const char* input, std::size_t length, char* output) noexcept
+	{
+		std::size_t i = 0;
+		for(; i + 16 <= length; i += 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+
+			__m128i high = to_hex_sse2(_mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0f)));
+			__m128i low = to_hex_sse2(_mm_and_si128(bytes, _mm_set1_epi8(0x0f)));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 2 * i), _mm_unpacklo_epi8(high, low));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+		}
+
+		encode_hex_scalar(input + i, length - i, output + 2 * i);
+	}
+
+	bool decode_hex_sse2(const char* input, std::size_t length, char* output) noexcept
+	{
+		__m128i invalid = _mm_setzero_si128();
+
+		std::size_t i = 0;
+		for(; i + 16 <= length; i += 16)
+		{
+			__m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 2 * i));
+			__m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 2 * i + 16));
+
+			first = join_nibbles_sse2(from_hex_sse2(first, invalid));
+			second = join_nibbles_sse2(from_hex_sse2(second, invalid));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(first, second));
+		}
+
+		return _mm_movemask_epi8(invalid) == 0
+		    && decode_hex_scalar(input + 2 * i, length - i, output + i);
+	}
+
+	std::size_t find_zero_run_sse2(const char* input, std::size_t length) noexcept
+	{
+		// Windows overlap, so that runs which cross their ends are found by the next one
+		std::size_t i = 0;
+		for(; i + 64 <= length; i += 64 - (ZERO_RUN_LENGTH - 1))
+		{
+			std::uint64_t zeros = static_cast<std::uint64_t>(zero_mask_sse2(input + i))
+			                    | static_cast<std::uint64_t>(zero_mask_sse2(input + i + 16)) << 16
+			                    | static_cast<std::uint64_t>(zero_mask_sse2(input + i + 32)) << 32
+			                    | static_cast<std::uint64_t>(zero_mask_sse2(input + i + 48)) << 48;
+
+			if(auto start = find_run_start(zeros); start < 64)
+			{
+				return i + start;
+			}
+		}
+
+		return i + find_zero_run_scalar(input + i, length - i);
+	}
+
+	std::size_t find_nonzero_sse2(const char* input, std::size_t length) noexcept
+	{
+		std::size_t i = 0;
+		for(; i + 16 <= length; i += 16)
+		{
+			if(auto zeros = zero_mask_sse2(input + i); zeros != 0xffff)
+			{
+				return i + __builtin_ctz(~zeros);
+			}
+		}
+
+		return i + find_nonzero_scalar(input + i, length - i);
+	}
+
+	constexpr octet_kernels sse2_kernels
+	{
+		octet_isa::sse2, encode_hex_sse2, decode_hex_sse2,
+		find_zero_run_sse2, find_nonzero_sse2
+	};
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+	// These are only called after checking for AVX2 at runtime
+
+	[[gnu::target("avx2")]]
+	inline __m256i to_hex_avx2(__m256i nibbles) noexcept
+	{
+		__m256i letters = _mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9));
+		__m256i digits = _mm256_add_epi8(nibbles, _mm256_set1_epi8('0'));
+
+		return _mm256_add_epi8(digits, _mm256_and_si256(letters, _mm256_set1_epi8('a' - '0' - 10)));
+	}
+
+	[[gnu::target("avx2")]]
+	inline __m256i from_hex_avx2(__m256i digits, __m256i& invalid) noexcept
+	{
+		__m256i is_digit = _mm256_and_si256
+		(
+			_mm256_cmpgt_epi8(digits, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), digits)
+		);
+
+		__m256i is_letter = _mm256_and_si256
+		(
+			_mm256_cmpgt_epi8(digits, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), digits)
+		);
+
+		__m256i valid = _mm256_or_si256(is_digit, is_letter);
+		invalid = _mm256_or_si256(invalid, _mm256_cmpeq_epi8(valid, _mm256_setzero_si256()));
+
+		__m256i digit_values = _mm256_and_si256(is_digit, _mm256_sub_epi8(digits, _mm256_set1_epi8('0')));
+		__m256i letter_values = _mm256_and_si256(is_letter, _mm256_sub_epi8(digits, _mm256_set1_epi8('a' - 10)));
+
+		return _mm256_or_si256(digit_values, letter_values);
+	}
+
+	[[gnu::target("avx2")]]
+	inline __m256i join_nibbles_avx2(__m256i nibbles) noexcept
+	{
+		__m256i joined = _mm256_or_si256(_mm256_slli_epi16(nibbles, 4), _mm256_srli_epi16(nibbles, 8));
+		return _mm256_and_si256(joined, _mm256_set1_epi16(0x00ff));
+	}
+
+	[[gnu::target("avx2")]]
+	inline std::uint32_t zero_mask_avx2(const char* input) noexcept
+	{
+		__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+		return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_setzero_si256())));
+	}
+
+	[[gnu::target("avx2")]]
+	void encode_hex_avx2(const char* input, std::size_t length, char* output) noexcept
+	{
+		std::size_t i = 0;
+		for(; i + 32 <= length; i += 32)
+		{
+			__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+
+			__m256i high = to_hex_avx2(_mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0f)));
+			__m256i low = to_hex_avx2(_mm256_and_si256(bytes, _mm256_set1_epi8(0x0f)));
+
+			// Unpacking works within 128-bit lanes, which are then put back in order
+			__m256i first = _mm256_unpacklo_epi8(high, low);
+			__m256i second = _mm256_unpackhi_epi8(high, low);
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+		}
+
+		encode_hex_scalar(input + i, length - i, output + 2 * i);
+	}
+
+	[[gnu::target("avx2")]]
+	bool decode_hex_avx2(const char* input, std::size_t length, char* output) noexcept
+	{
+		__m256i invalid = _mm256_setzero_si256();
+
+		std::size_t i = 0;
+		for(; i + 32 <= length; i += 32)
+		{
+			__m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + 2 * i));
+			__m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + 2 * i + 32));
+
+			first = join_nibbles_avx2(from_hex_avx2(first, invalid));
+			second = join_nibbles_avx2(from_hex_avx2(second, invalid));
+
+			// Packing also works within lanes, which leaves 64-bit quarters out of order
+			__m256i packed = _mm256_packus_epi16(first, second);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), _mm256_permute4x64_epi64(packed, 0b11'01'10'00));
+		}
+
+		return _mm256_movemask_epi8(invalid) == 0
+		    && decode_hex_scalar(input + 2 * i, length - i, output + i);
+	}
+
+	[[gnu::target("avx2")]]
+	std::size_t find_zero_run_avx2(const char* input, std::size_t length) noexcept
+	{
+		std::size_t i = 0;
+		for(; i + 64 <= length; i += 64 - (ZERO_RUN_LENGTH - 1))
+		{
+			std::uint64_t zeros = static_cast<std::uint64_t>(zero_mask_avx2(input + i))
+			                    | static_cast<std::uint64_t>(zero_mask_avx2(input + i + 32)) << 32;
+
+			if(auto start = find_run_start(zeros); start < 64)
+			{
+				return i + start;
+			}
+		}
+
+		return i + find_zero_run_scalar(input + i, length - i);
+	}
+
+	[[gnu::target("avx2")]]
+	std::size_t find_nonzero_avx2(const char* input, std::size_t length) noexcept
+	{
+		std::size_t i = 0;
+		for(; i + 32 <= length; i += 32)
+		{
+			if(auto zeros = zero_mask_avx2(input + i); zeros != 0xffff'ffff)
+			{
+				return i + __builtin_ctz(~zeros);
+			}
+		}
+
+		return i + find_nonzero_scalar(input + i, length - i);
+	}
+
+	constexpr octet_kernels avx2_kernels
+	{
+		octet_isa::avx2, encode_hex_avx2, decode_hex_avx2,
+		find_zero_run_avx2, find_nonzero_avx2
+	};
+#endif
+}
+
+namespace ce2103::mm::_detail
+{
+	const octet_kernels& get_octet_kernels() noexcept
+	{
+		static const octet_kernels& best = []() -> const octet_kernels&
+		{
+			for(auto isa : {octet_isa::avx2, octet_isa::sse2})
+			{
+				if(const auto* kernels = find_octet_kernels(isa); kernels != nullptr)
+				{
+					return *kernels;
+				}
+			}
+
+			return scalar_kernels;
+		}();
+
+		return best;
+	}
+
+	const octet_kernels* find_octet_kernels(octet_isa isa) noexcept
+	{
+		switch(isa)
+		{
+			case octet_isa::scalar:
+				return &scalar_kernels;
+
+#ifdef __SSE2__
+			case octet_isa::sse2:
+				return &sse2_kernels;
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+			case octet_isa::avx2:
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("avx2") ? &avx2_kernels : nullptr;
+#endif
+
+			default:
+				return nullptr;
+		}
+	}
+}
@@ -0,0 +1,671 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <algorithm>
+#include <string_view>
+
+#include "ce2103/list.hpp"
+#include "ce2103/hash_map.hpp"
+
+#include "ce2103/mm/gc.hpp"
+#include "ce2103/mm/server.hpp"
+
+using nlohmann::json;
+
+using ce2103::mm::server_session;
+
+namespace
+{
+	//! Object tables which other sessions of the same client may join, by token
+	ce2103::hash_map<std::uint64_t, std::weak_ptr<server_session::object_table>> joinable_tables;
+
+	//! Whether to print compression statistics as sessions end, see set_compression_reports()
+	bool report_compression = false;
+}
+
+namespace ce2103::mm
+{
+	server_session::~server_session() noexcept
+	{
+		if(!this->objects)
+		{
+			return;
+		}
+
+		// Reports the compression ratio and cost of the session, if requested
+		if(const auto& stats = this->get_compression_stats(); report_compression && this->is_compressed())
+		{
+			auto ratio = [](std::uint64_t bytes, std::uint64_t wire)
+			{
+				return wire > 0 ? static_cast<double>(bytes) / wire : 0.0;
+			};
+
+			auto cost = [](std::uint64_t nanoseconds, std::uint64_t pages)
+			{
+				return pages > 0 ? nanoseconds / 1000.0 / pages : 0.0;
+			};
+
+			std::clog << "Compression: " << stats.packed_pages << " pages sent ("
+			          << stats.zero_pages << " zero) at " << ratio(stats.packed_bytes, stats.packed_wire)
+			          << "x, " << cost(stats.packing_ns, stats.packed_pages) << "us/page; "
+			          << stats.unpacked_pages << " received at " << ratio(stats.unpacked_bytes, stats.unpacked_wire)
+			          << "x, " << cost(stats.unpacking_ns, stats.unpacked_pages) << "us/page\n";
+		}
+
+		if(this->token)
+		{
+			joinable_tables.remove(*this->token);
+		}
+
+		// Objects are released along with the last session that shares them
+		if(this->objects.use_count() == 1)
+		{
+			for(const auto& [id, pair] : *this->objects)
+			{
+				while(garbage_collector::get_instance().drop(id) != drop_result::lost)
+				{
+					continue;
+				}
+			}
+		}
+	}
+
+	bool server_session::on_input()
+	{
+		// Pipelined requests may be buffered already, epoll won't report them again
+		do
+		{
+			if(this->is_binary())
+			{
+				this->on_frame();
+				continue;
+			}
+
+			auto command = this->receive();
+			if(!command)
+			{
+				this->fail_bad_request();
+				this->discard();
+
+				return false;
+			}
+
+			this->execute(*command);
+		} while(!this->is_lost() && this->has_pending_input());
+
+		return !this->is_lost();
+	}
+
+	void server_session::execute(const nlohmann::json& command)
+	{
+		try
+		{
+			if(auto hash = command.find("auth"); hash != command.end())
+			{
+				this->authorize
+				(
+					*hash, command.value("framing", "") == "binary", command.value("batch", false),
+					command.value("compression", "") == "lz"
+				);
+			} else if(command.contains("bye"))
+			{
+				this->finalize();
+			} else if(!this->authorized)
+			{
+				this->send_error("unauthorized");
+			} else if(command.contains("share"))
+			{
+				this->share();
+			} else if(auto token = command.find("join"); token != command.end())
+			{
+				this->join(*token);
+			} else if(auto lifts = command.find("alloc"); lifts != command.end())
+			{
+				this->allocate
+				(
+					command.value("unit", 0), command.value("parts", 0),
+					command.value("rem", 0), *lifts
+				);
+			} else if(auto id = command.find("read"); id != command.end())
+			{
+				this->read_contents(*id);
+			} else if(auto id = command.find("write"); id != command.end())
+			{
+				std::optional<std::size_t> offset;
+				if(auto at = command.find("at"); at != command.end())
+				{
+					offset = at->get<std::size_t>();
+				}
+
+				if(this->write_contents(*id, command.at("value"), offset))
+				{
+					this->send_empty();
+				}
+			} else if(auto batch = command.find("writes"); batch != command.end())
+			{
+				this->write_many(*batch);
+			} else if(auto range = command.find("reads"); range != command.end())
+			{
+				this->read_range(*range);
+			} else if(auto range = command.find("lifts"); range != command.end())
+			{
+				this->lift_range(*range);
+			} else if(auto range = command.find("drops"); range != command.end())
+			{
+				this->drop_range(*range);
+			} else if(auto id = command.find("lift"); id != command.end())
+			{
+				this->lift(*id);
+			} else if(auto id = command.find("drop"); id != command.end())
+			{
+				this->drop(*id);
+			} else
+			{
+				this->fail_bad_request();
+			}
+		} catch(const json::exception&)
+		{
+			this->fail_bad_request();
+		}
+	}
+
+	void server_session::on_frame()
+	{
+		auto header = this->receive_header();
+		if(!header)
+		{
+			this->fail_bad_request();
+			this->discard();
+
+			return;
+		} else if(header->type != opcode::message && !this->authorized)
+		{
+			// Authorization might be revoked by a later, failed attempt
+			this->receive_payload(nullptr, header->length);
+			this->send_error("unauthorized");
+
+			return;
+		}
+
+		switch(header->type)
+		{
+			case opcode::message:
+				if(auto command = this->receive_message(*header))
+				{
+					this->execute(*command);
+				} else
+				{
+					this->fail_bad_request();
+					this->discard();
+				}
+
+				break;
+
+			case opcode::read:
+				this->read_contents(header->id);
+				break;
+
+			case opcode::write:
+				this->write_frame(*header);
+				break;
+
+			default:
+				this->fail_bad_request();
+				this->discard();
+
+				break;
+		}
+	}
+
+	void server_session::authorize(const nlohmann::json& input, bool binary, bool batches, bool compression)
+	{
+		char hash_bytes[sizeof(std::uint64_t[2])];
+		if(!deserialize_octets(input, hash_bytes, sizeof hash_bytes))
+		{
+			this->fail_bad_request();
+		} else
+		{
+			// Verifies the password hash
+
+			secret_hash hash{0, 0};
+			for(unsigned i = 0; i < sizeof hash_bytes; ++i)
+			{
+				auto& half = i < sizeof(std::uint64_t) ? hash.first : hash.second;
+				half = half << 8 | static_cast<std::uint8_t>(hash_bytes[i]);
+			}
+
+			// Accepted proposals are listed instead of replying 'true'
+			this->authorized = hash == this->secret.get();
+			if(this->authorized && (binary || batches))
+			{
+				json accepted = json::object();
+				if(binary)
+				{
+					accepted["framing"] = "binary";
+				}
+
+				if(batches)
+				{
+					accepted["batch"] = true;
+				}
+
+				if(binary && compression)
+				{
+					accepted["compression"] = "lz";
+				}
+
+				// This is the last line, frames follow from now on if accepted
+				this->send(std::move(accepted));
+				if(binary)
+				{
+					this->set_binary();
+				}
+
+				if(binary && compression)
+				{
+					this->set_compressed();
+				}
+			} else
+			{
+				this->send(this->authorized);
+			}
+		}
+	}
+
+	void server_session::finalize()
+	{
+		// Only the last session that shares the objects checks for leaks
+		ce2103::linked_list<std::size_t> stale_ids;
+		if(this->objects.use_count() == 1)
+		{
+			for(const auto& [id, pair] : *this->objects)
+			{
+				stale_ids.append(id);
+			}
+		}
+
+		// Check for leaks
+		if(stale_ids.get_size() > 0)
+		{
+			this->send({{"leaked", std::vector<std::size_t>(stale_ids.begin(), stale_ids.end())}});
+		} else
+		{
+			this->send_empty();
+		}
+
+		this->discard();
+	}
+
+	void server_session::share()
+	{
+		if(!this->token)
+		{
+			std::random_device source;
+			std::uint64_t candidate;
+
+			do
+			{
+				candidate = static_cast<std::uint64_t>(source()) << 32 | source();
+			} while(joinable_tables.search(candidate) != nullptr);
+
+			joinable_tables.insert(candidate, this->objects);
+			this->token = candidate;
+		}
+
+		this->send(*this->token);
+	}
+
+	void server_session::join(std::uint64_t token)
+	{
+		auto* shared = joinable_tables.search(token);
+		if(shared == nullptr || shared->expired() || this->objects->get_size() > 0)
+		{
+			this->send_error("cannot join");
+			return;
+		}
+
+		this->objects = shared->lock();
+		this->send_empty();
+	}
+
+	void server_session::allocate
+	(
+		std::size_t part_size, std::size_t parts,
+		std::size_t remainder, std::size_t initial_count
+	)
+	{
+		if((part_size == 0 || parts == 0) && remainder == 0)
+		{
+			this->fail_wrong_size();
+			return;
+		} else if(initial_count > UINT32_MAX)
+		{
+			// Reference counts are 32 bits wide
+			this->fail_bad_request();
+			return;
+		}
+
+		auto& gc = garbage_collector::get_instance();
+		gc.require_contiguous_ids((part_size > 0 ? parts : 0) + (remainder > 0 ? 1 : 0));
+
+		std::optional<std::size_t> first_id;
+		auto allocate_next = [&, this](std::size_t size)
+		{
+			[[maybe_unused]]
+			auto [id, resource, base] = gc.allocate_of<char>(size);
+
+			if(!first_id)
+			{
+				first_id = id;
+			}
+
+			this->objects->insert(id, std::make_pair(base, size));
+		};
+
+		// Exactly as many objects as IDs were required, or ranges would be wrong
+		for(std::size_t i = 0; part_size > 0 && i < parts; ++i)
+		{
+			allocate_next(part_size);
+		}
+
+		if(remainder > 0)
+		{
+			allocate_next(remainder);
+		}
+		if(initial_count > 0)
+		{
+			gc.lift_range(*first_id, 1, static_cast<std::uint32_t>(initial_count));
+		}
+
+		this->send(*first_id);
+	}
+
+	void server_session::lift(std::size_t id)
+	{
+		if(this->expect_extant(id) != nullptr)
+		{
+			garbage_collector::get_instance().lift(id);
+			this->send_empty();
+		}
+	}
+
+	void server_session::drop(std::size_t id)
+	{
+		if(this->expect_extant(id) != nullptr)
+		{
+			switch(garbage_collector::get_instance().drop(id))
+			{
+				case drop_result::hanging:
+					this->send({{"hanging", true}});
+					break;
+
+				case drop_result::lost:
+					this->send({{"lost", true}});
+					this->objects->remove(id);
+
+					break;
+
+				default:
+					this->send_empty();
+			}
+		}
+	}
+
+	void server_session::lift_range(const nlohmann::json& range)
+	{
+		if(auto parsed = this->expect_range(range);
+		   parsed && this->expect_extant_range(parsed->first, parsed->second))
+		{
+			garbage_collector::get_instance().lift_range(parsed->first, parsed->second);
+			this->send_empty();
+		}
+	}
+
+	void server_session::drop_range(const nlohmann::json& range)
+	{
+		auto parsed = this->expect_range(range);
+		if(!parsed || !this->expect_extant_range(parsed->first, parsed->second))
+		{
+			return;
+		}
+
+		auto [first, count] = *parsed;
+		auto results = garbage_collector::get_instance().drop_range(first, count);
+
+		// Reduced objects are implied by omission
+		json hanging = json::array();
+		json lost = json::array();
+
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			if(results[i] == drop_result::hanging)
+			{
+				hanging.push_back(first + i);
+			} else if(results[i] == drop_result::lost)
+			{
+				lost.push_back(first + i);
+				this->objects->remove(first + i);
+			}
+		}
+
+		this->send({{"hanging", std::move(hanging)}, {"lost", std::move(lost)}});
+	}
+
+	void server_session::read_range(const nlohmann::json& range)
+	{
+		if(auto parsed = this->expect_range(range); parsed)
+		{
+			// Otherwise, a huge range would keep the reactor busy with errors
+			auto [first, count] = *parsed;
+			if(count > this->objects->get_size())
+			{
+				this->fail_bad_request();
+				this->discard();
+
+				return;
+			}
+
+			for(std::size_t id = first; id < first + count; ++id)
+			{
+				this->read_contents(id);
+			}
+		}
+	}
+
+	void server_session::read_contents(std::size_t id)
+	{
+		if(auto* pair = this->expect_extant(id); pair != nullptr)
+		{
+			auto [base, size] = *pair;
+			if(!this->is_binary())
+			{
+				this->send(serialize_octets(std::string_view{base, size}));
+			} else if(size > UINT32_MAX)
+			{
+				this->fail_wrong_size();
+			} else
+			{
+				std::string frame;
+				this->put_octets(frame, {opcode::contents, false, 0, id}, {base, size});
+
+				this->send_frames(frame);
+			}
+		}
+	}
+
+	bool server_session::write_contents
+	(
+		std::size_t id, const nlohmann::json& contents, std::optional<std::size_t> offset
+	)
+	{
+		auto* pair = this->expect_extant(id);
+		if(pair == nullptr)
+		{
+			return false;
+		}
+
+		// Whole writes must match the object size, partial ones must fit in it
+		auto [base, size] = *pair;
+		if(offset)
+		{
+			auto length = deserialized_size(contents);
+			if(!length || *length > size || *offset > size - *length)
+			{
+				this->fail_wrong_size();
+				return false;
+			}
+
+			base += *offset;
+			size = *length;
+		}
+
+		if(!deserialize_octets(contents, base, size))
+		{
+			this->fail_wrong_size();
+			return false;
+		}
+
+		return true;
+	}
+
+	void server_session::write_many(const nlohmann::json& batch)
+	{
+		if(!batch.is_array())
+		{
+			this->fail_bad_request();
+			return;
+		}
+
+		for(const auto& entry : batch)
+		{
+			std::optional<std::size_t> offset;
+			if(entry.size() > 2)
+			{
+				offset = entry.at(1).get<std::size_t>();
+			}
+
+			if(!this->write_contents(entry.at(0), entry.at(entry.size() - 1), offset))
+			{
+				return;
+			}
+		}
+
+		this->send_empty();
+	}
+
+	void server_session::write_frame(const frame_header& header)
+	{
+		// Once a write of a batch fails, the rest of the batch is skipped
+		auto locate = [this, &header](std::size_t length)
+		{
+			char* target = nullptr;
+			if(!this->batch_failed)
+			{
+				if(auto* pair = this->expect_extant(header.id); pair != nullptr)
+				{
+					auto [base, size] = *pair;
+					if(length <= size && header.offset <= size - length)
+					{
+						target = base + header.offset;
+					} else
+					{
+						this->fail_wrong_size();
+					}
+				}
+
+				this->batch_failed = target == nullptr;
+			}
+
+			return target;
+		};
+
+		if(!this->receive_octets(header, locate))
+		{
+			this->fail_bad_request();
+			this->discard();
+
+			return;
+		} else if(!header.more)
+		{
+			if(!this->batch_failed)
+			{
+				this->send_empty();
+			}
+
+			this->batch_failed = false;
+		}
+	}
+
+	std::pair<char*, std::size_t>* server_session::expect_extant(std::size_t id) noexcept
+	{
+		auto* pair = this->objects->search(id);
+		if(pair == nullptr)
+		{
+			this->send_error("object not found");
+		}
+
+		return pair;
+	}
+
+	auto server_session::expect_range(const nlohmann::json& range)
+	-> std::optional<std::pair<std::size_t, std::size_t>>
+	{
+		if(range.is_array() && range.size() == 2)
+		{
+			auto first = range.at(0).get<std::size_t>();
+			auto count = range.at(1).get<std::size_t>();
+
+			if(count <= SIZE_MAX - first)
+			{
+				return std::make_pair(first, count);
+			}
+		}
+
+		this->fail_bad_request();
+		return std::nullopt;
+	}
+
+	bool server_session::expect_extant_range(std::size_t first, std::size_t count) noexcept
+	{
+		for(std::size_t id = first; id < first + count; ++id)
+		{
+			if(this->expect_extant(id) == nullptr)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void server_session::send_empty()
+	{
+		this->send(json({}));
+	}
+
+	void server_session::send_error(const char* message)
+	{
+		this->send({{"error", message}});
+	}
+
+	void server_session::fail_bad_request()
+	{
+		this->send_error("bad request");
+	}
+
+	void server_session::fail_wrong_size()
+	{
+		this->send_error("wrong size");
+	}
+
+	void server_session::set_compression_reports(bool enabled) noexcept
+	{
+		report_compression = enabled;
+	}
+}
@@ -1,28 +1,44 @@
+#include <chrono>
 #include <vector>
 #include <string>
 #include <utility>
 #include <cstddef>
 #include <cstdint>
 #include <cassert>
+#include <climits>
 #include <optional>
 #include <algorithm>
+#include <functional>
 #include <string_view>
 
 #include "nlohmann/json.hpp"
 
+#include "ce2103/lz.hpp"
+
 #include "ce2103/mm/client.hpp"
+#include "ce2103/mm/octets.hpp"
 #include "ce2103/mm/session.hpp"
 
 using nlohmann::json;
 
+namespace
+{
+	//! Size of the contents size that prefixes compressed payloads
+	constexpr std::size_t PACKED_SIZE_PREFIX = sizeof(std::uint32_t);
+
+	//! Nanoseconds elapsed since a point in time
+	std::uint64_t nanoseconds_since(std::chrono::steady_clock::time_point start) noexcept
+	{
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	}
+}
+
 namespace ce2103::mm
 {
 	json session::serialize_octets(std::string_view input)
 	{
-		auto get_nibble_char = [](std::uint8_t nibble) -> char
-		{
-			return nibble < 0x0a ? '0' + nibble : 'a' + nibble - 0x0a;
-		};
+		const auto& kernels = _detail::get_octet_kernels();
 
 		/* Breaking at less than three consecutive zeros will increase the
 		 * serialized length instead of shortening it.
@@ -32,22 +48,20 @@ namespace ce2103::mm
 		 *   ["aa0000bb"] (length 12) => ["aa",2,"bb"] (length 13)
 		 *   ["aa000000bb"] (length 14) => ["aa",3,"bb"] (length 13)
 		 */
-		constexpr char least_break[] = {'\0', '\0', '\0'};
+		constexpr std::size_t least_break = _detail::ZERO_RUN_LENGTH;
 
 		std::vector<json> fragments;
 		while(input.length() > 0)
 		{
-			auto barrier = input.find(least_break, 0, sizeof least_break);
+			auto barrier = kernels.find_zero_run(input.data(), input.length());
 
 			bool is_break = barrier == 0;
 			if(is_break)
 			{
-				barrier = input.find_first_not_of('\0', sizeof least_break);
-			}
-
-			if(barrier == std::string_view::npos)
-			{
-				barrier = input.length();
+				barrier = least_break + kernels.find_nonzero
+				(
+					input.data() + least_break, input.length() - least_break
+				);
 			}
 
 			/* In the resulting vector, strings hold serialized data,
@@ -59,16 +73,8 @@ namespace ce2103::mm
 				fragments.push_back(barrier);
 			} else
 			{
-				std::string fragment;
-				fragment.reserve(barrier * 2);
-
-				for(char as_char : input.substr(0, barrier))
-				{
-					auto byte = static_cast<std::uint8_t>(as_char);
-
-					fragment.push_back(get_nibble_char(byte >> 4));
-					fragment.push_back(get_nibble_char(byte & 0b0000'1111));
-				}
+				std::string fragment(barrier * 2, '\0');
+				kernels.encode_hex(input.data(), barrier, fragment.data());
 
 				fragments.push_back(std::move(fragment));
 			}
@@ -114,24 +120,13 @@ namespace ce2103::mm
 
 	bool session::deserialize_octets(const json& input, char* output, std::size_t bytes) noexcept
 	{
-		auto get_nibble = [](char digit) -> std::uint8_t
-		{
-			if(digit >= '0' && digit <= '9')
-			{
-				return digit - '0';
-			} else if(digit >= 'a' && digit <= 'f')
-			{
-				return digit - 'a' + 0x0a;
-			}
-
-			__builtin_unreachable();
-		};
-
 		if(!input.is_array())
 		{
 			return false;
 		}
 
+		const auto& kernels = _detail::get_octet_kernels();
+
 		// See serialize_octets() for format documentation
 
 		for(const auto& fragment : input)
@@ -162,22 +157,10 @@ namespace ce2103::mm
 			if(is_break)
 			{
 				std::fill(output, output + length, '\0');
-			} else
+			} else if(!kernels.decode_hex(fragment.get_ref<const std::string&>().data(), length, output))
 			{
-				const char* source = fragment.get_ref<const std::string&>().data();
-				for(std::size_t i = 0; i < length; ++i)
-				{
-					std::uint8_t first = get_nibble(source[2 * i]);
-					std::uint8_t second = get_nibble(source[2 * i + 1]);
-
-					//! Check that these are indeed valid nibbles
-					if(first > 0b000'1111 || second > 0b0000'1111)
-					{
-						return false;
-					}
-
-					output[i] = static_cast<char>(first << 4 | second);
-				}
+				// Only lowercase hex digits are valid
+				return false;
 			}
 
 			output += length;
@@ -189,17 +172,43 @@ namespace ce2103::mm
 
 	void session::send(json data)
 	{
-		if(this->peer)
+		if(!this->peer)
+		{
+			return;
+		} else if(this->binary)
 		{
-			std::string line = data.dump();
-			line.push_back('\n');
+			std::string frame;
+			std::string text = data.dump();
 
-			this->peer->write(line);
+			put_frame(frame, {opcode::message, false, static_cast<std::uint32_t>(text.length())}, text);
+			this->peer->write(frame);
+
+			return;
 		}
+
+		std::string line = data.dump();
+		line.push_back('\n');
+
+		this->peer->write(line);
 	}
 
 	std::optional<json> session::receive()
 	{
+		if(this->binary)
+		{
+			auto header = this->receive_header();
+			if(!header)
+			{
+				return std::nullopt;
+			} else if(header->type != opcode::message)
+			{
+				this->receive_payload(nullptr, header->length);
+				return std::nullopt;
+			}
+
+			return this->receive_message(*header);
+		}
+
 		std::string line;
 		json data;
 
@@ -211,4 +220,209 @@ namespace ce2103::mm
 
 		return std::nullopt;
 	}
+
+	void session::put_frame(std::string& output, const frame_header& header, std::string_view payload)
+	{
+		assert(payload.length() == header.length);
+
+		auto put_integer = [&output](std::uint64_t value, std::size_t bytes)
+		{
+			for(std::size_t i = 0; i < bytes; ++i)
+			{
+				output.push_back(static_cast<char>(value >> (i * CHAR_BIT)));
+			}
+		};
+
+		output.reserve(output.length() + FRAME_HEADER_SIZE + payload.length());
+
+		put_integer(static_cast<std::uint8_t>(header.type), 1);
+		put_integer(header.more, 1);
+		put_integer(static_cast<std::uint8_t>(header.format), 1);
+		put_integer(0, 1);
+		put_integer(header.length, sizeof header.length);
+		put_integer(header.id, sizeof header.id);
+		put_integer(header.offset, sizeof header.offset);
+
+		output += payload;
+	}
+
+	void session::put_octets(std::string& output, frame_header header, std::string_view contents)
+	{
+		assert(contents.length() <= UINT32_MAX);
+
+		header.length = static_cast<std::uint32_t>(contents.length());
+		header.format = packing::raw;
+
+		if(!this->compressed || contents.length() < COMPRESSION_THRESHOLD)
+		{
+			put_frame(output, header, contents);
+			return;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		// The size prefix is followed by nothing or by the compressed block
+		this->scratch.resize(contents.length());
+		for(std::size_t i = 0; i < PACKED_SIZE_PREFIX; ++i)
+		{
+			this->scratch[i] = static_cast<char>(contents.length() >> (i * CHAR_BIT));
+		}
+
+		std::size_t packed_size = 0;
+
+		const auto& kernels = _detail::get_octet_kernels();
+		if(kernels.find_nonzero(contents.data(), contents.length()) == contents.length())
+		{
+			header.format = packing::zeros;
+			++this->stats.zero_pages;
+		} else
+		{
+			// Compression is given up on once it can't be shorter than the contents
+			packed_size = lz::compress
+			(
+				contents, &this->scratch[PACKED_SIZE_PREFIX],
+				contents.length() - PACKED_SIZE_PREFIX - 1
+			);
+
+			if(packed_size > 0)
+			{
+				header.format = packing::lz;
+			}
+		}
+
+		if(header.format == packing::raw)
+		{
+			put_frame(output, header, contents);
+		} else
+		{
+			header.length = static_cast<std::uint32_t>(PACKED_SIZE_PREFIX + packed_size);
+			put_frame(output, header, {this->scratch.data(), header.length});
+		}
+
+		++this->stats.packed_pages;
+		this->stats.packed_bytes += contents.length();
+		this->stats.packed_wire += header.length;
+		this->stats.packing_ns += nanoseconds_since(start);
+	}
+
+	void session::send_frames(std::string_view frames)
+	{
+		if(this->peer)
+		{
+			this->peer->write(frames);
+		}
+	}
+
+	auto session::receive_header() -> std::optional<frame_header>
+	{
+		char bytes[FRAME_HEADER_SIZE];
+		if(!this->peer || !this->peer->read(bytes, sizeof bytes))
+		{
+			return std::nullopt;
+		}
+
+		const char* next = bytes;
+		auto get_integer = [&next](std::size_t size)
+		{
+			std::uint64_t value = 0;
+			for(std::size_t i = 0; i < size; ++i)
+			{
+				value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(*next++)) << (i * CHAR_BIT);
+			}
+
+			return value;
+		};
+
+		auto type = get_integer(1);
+		auto more = get_integer(1);
+		auto format = get_integer(1);
+		auto reserved = get_integer(1);
+
+		frame_header header{static_cast<opcode>(type), more != 0};
+		header.length = get_integer(sizeof header.length);
+		header.id = get_integer(sizeof header.id);
+		header.offset = get_integer(sizeof header.offset);
+		header.format = static_cast<packing>(format);
+
+		bool has_octets = header.type == opcode::contents || header.type == opcode::write;
+		if(type > static_cast<std::uint8_t>(opcode::write) || more > 1 || reserved != 0
+		|| format > static_cast<std::uint8_t>(has_octets ? packing::zeros : packing::raw))
+		{
+			return std::nullopt;
+		}
+
+		return header;
+	}
+
+	bool session::receive_payload(char* output, std::size_t length)
+	{
+		return this->peer && this->peer->read(output, length);
+	}
+
+	bool session::receive_octets
+	(
+		const frame_header& header, const std::function<char*(std::size_t)>& locate
+	)
+	{
+		if(header.format == packing::raw)
+		{
+			return this->receive_payload(locate(header.length), header.length);
+		} else if(!this->compressed || header.length < PACKED_SIZE_PREFIX)
+		{
+			return false;
+		}
+
+		this->scratch.resize(header.length);
+		if(!this->receive_payload(this->scratch.data(), header.length))
+		{
+			return false;
+		}
+
+		std::size_t size = 0;
+		for(std::size_t i = 0; i < PACKED_SIZE_PREFIX; ++i)
+		{
+			size |= static_cast<std::size_t>(static_cast<std::uint8_t>(this->scratch[i])) << (i * CHAR_BIT);
+		}
+
+		std::string_view block{this->scratch};
+		block.remove_prefix(PACKED_SIZE_PREFIX);
+
+		char* output = locate(size);
+		auto start = std::chrono::steady_clock::now();
+
+		bool well_formed = header.format == packing::lz || block.empty();
+		if(output != nullptr && well_formed)
+		{
+			if(header.format == packing::zeros)
+			{
+				std::fill(output, output + size, '\0');
+			} else
+			{
+				well_formed = lz::decompress(block, output, size);
+			}
+		}
+
+		++this->stats.unpacked_pages;
+		this->stats.unpacked_bytes += size;
+		this->stats.unpacked_wire += header.length;
+		this->stats.unpacking_ns += nanoseconds_since(start);
+
+		return well_formed;
+	}
+
+	std::optional<json> session::receive_message(const frame_header& header)
+	{
+		std::string text(header.length, '\0');
+		if(!this->receive_payload(text.data(), text.length()))
+		{
+			return std::nullopt;
+		}
+
+		if(json data = json::parse(text, nullptr, false); !data.is_discarded())
+		{
+			return data;
+		}
+
+		return std::nullopt;
+	}
 }
@@ -1,17 +1,24 @@
-/* Implements page fault management in userspace by handling SIGSEGV.
- * This depends on virtual memory overcommitting by the kernel, which
- * is on by default but can be disabled. Makes use of anonymous
- * sparse files and some x86-specific and Linux-specific :features.
+/* Implements page fault management in userspace by handling SIGSEGV
+ * or, if requested and available, through userfaultfd(2). This depends
+ * on virtual memory overcommitting by the kernel, which is on by default
+ * but can be disabled. Makes use of anonymous sparse files and some
+ * x86-specific and Linux-specific :features.
  */
 
 #include <tuple>
 #include <mutex>
+#include <memory>
 #include <string>
 #include <chrono>
 #include <thread>
+#include <vector>
 #include <cerrno>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <cassert>
+#include <algorithm>
+#include <iostream>
 #include <optional>
 #include <exception>
 #include <functional>
@@ -19,16 +26,24 @@
 #include <system_error>
 #include <condition_variable>
 
+#include <poll.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <signal.h>
 #include <sys/mman.h>
+#include <sys/ioctl.h>
 #include <sys/types.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+
+#include "ce2103/hash_map.hpp"
 
 #include "ce2103/mm/gc.hpp"
 #include "ce2103/mm/error.hpp"
 #include "ce2103/mm/client.hpp"
- 
+
+using ce2103::mm::paging;
 using ce2103::mm::client_session;
 
 namespace
@@ -39,9 +54,39 @@ namespace
 	//! 256MiB/1TiB of virtual address space for 32-bit/64-bit platforms.
 	constexpr auto REGION_SIZE = sizeof(char) << (16 + 3 * sizeof(void*));
 
+	//! The upper half of the trap region holds large allocations, in chunks, if enabled
+	constexpr auto LARGE_AREA_OFFSET = REGION_SIZE / 2;
+
+	//! Size and alignment of chunks, same as a huge page on x86-64
+	constexpr std::size_t CHUNK_SIZE = sizeof(char) << 21;
+
 	//! See Intel SDM vol. 3, section 4.7, figure 4-12, bit 1 (W/R)
 	constexpr auto WRITE_FAULT_BIT = 1 << 1;
 
+	//! Default number of pages that might be resident at once
+	constexpr std::size_t DEFAULT_RESIDENT_PAGES = 256;
+
+	//! Default number of chunks that might be resident at once, if enabled
+	constexpr std::size_t DEFAULT_RESIDENT_CHUNKS = 16;
+
+	//! Pages read ahead once sequential access is first detected
+	constexpr std::size_t MIN_READAHEAD = 4;
+
+	//! Largest readahead window, also limited to a quarter of the resident set
+	constexpr std::size_t MAX_READAHEAD = 64;
+
+	//! Largest distance, in pages, between accesses that form a stride
+	constexpr std::ptrdiff_t MAX_STRIDE = 16;
+
+	//! Longest time that a page may remain dirty before being written back
+	constexpr std::chrono::milliseconds WRITEBACK_DELAY{5};
+
+	//! Number of dirty pages which causes an early writeback
+	constexpr std::size_t WRITEBACK_BATCH = 32;
+
+	//! Changed byte ranges closer than this are written back as one
+	constexpr std::size_t DELTA_MERGE_GAP = 16;
+
 	//! Result of a request made to the fault handler
 	enum class result
 	{
@@ -56,15 +101,200 @@ namespace
 	{
 		begin_read,  //!< Prepare for a read operation at the specified page
 		begin_write, //!< Prepare for a write at the specified page
-		terminate,   //!< Terminate the fault handler thread
 		wipe,        //!< Assume a page as containing all-zeros and make it writable
-		evict        //!< Flush a pending writeback operation
+		evict,       //!< Flush a pending writeback operation
+		discard      //!< Forget a page's contents without writing them back, and its binding
 	};
 
 	//! In case of a fault handling failure, throws the result code
 	[[noreturn]]
 	void throw_result(result which);
 
+	/*!
+	 * \brief Returns the size of the unit of paging, either a page or
+	 *        a chunk, at the given offset into the trap region.
+	 *
+	 * \param large_area offset where chunks start, REGION_SIZE if disabled
+	 */
+	inline std::size_t get_extent_at(std::size_t offset, std::size_t large_area) noexcept
+	{
+		return offset >= large_area ? CHUNK_SIZE : PAGE_SIZE;
+	}
+
+	/*!
+	 * \brief Returns the offset of the buffer that belongs to a frame,
+	 *        for buffers of pages followed by buffers of chunks.
+	 *
+	 * \param slot       frame index
+	 * \param page_slots number of page frames, which come first
+	 */
+	inline std::size_t get_slot_offset(std::size_t slot, std::size_t page_slots) noexcept
+	{
+		return slot < page_slots ? slot * PAGE_SIZE
+		     : page_slots * PAGE_SIZE + (slot - page_slots) * CHUNK_SIZE;
+	}
+
+	/*!
+	 * \brief Maps the trap region, or an alias of it, aligned to a chunk
+	 *        so that chunks may be backed by transparent huge pages.
+	 *
+	 * \return the mapping, or MAP_FAILED on error
+	 */
+	void* map_region(int protection, int flags, int fd) noexcept;
+
+	/*!
+	 * \brief Kernel mechanism through which trap region pages are mapped,
+	 *        protected and reported on fault. Pages are either absent
+	 *        (faulting on any access), read-only or writable. Their
+	 *        contents arrive through a staging buffer before mapping.
+	 */
+	class paging_backend
+	{
+		public:
+			virtual ~paging_backend() = default;
+
+			/*!
+			 * \brief Reserves the trap region and starts reporting its faults.
+			 *
+			 * \param slots       number of resident page frames, see stage()
+			 * \param chunk_slots number of resident chunk frames, after page frames
+			 * \param readers     number of threads that may report faults at once
+			 *
+			 * \return trap region base, or nullptr if unavailable
+			 */
+			virtual void* install(std::size_t slots, std::size_t chunk_slots, std::size_t readers) = 0;
+
+			//! Stops reporting faults and frees the trap region.
+			virtual void uninstall() noexcept = 0;
+
+			//! Returns the page buffer into which contents for a frame are fetched.
+			virtual char* stage(void* page, std::size_t slot) noexcept = 0;
+
+			//! Maps an absent page with the contents staged for its frame.
+			virtual bool map(void* page, std::size_t slot, bool writable) noexcept = 0;
+
+			//! Maps an absent page as writable and filled with zeros.
+			virtual bool wipe(void* page, std::size_t slot) noexcept = 0;
+
+			//! Changes the rights of a mapped page.
+			virtual bool protect(void* page, bool writable) noexcept = 0;
+
+			/*!
+			 * \brief Revokes write access before a writeback, and all access
+			 *        if the page is being invalidated as well.
+			 */
+			virtual bool seal(void* page, bool invalidate) noexcept = 0;
+
+			//! Returns the contents of a page, which must not be absent.
+			virtual const char* read(void* page) noexcept = 0;
+
+			/*!
+			 * \brief Makes a page absent and frees its memory.
+			 *
+			 * \param page   target page
+			 * \param sealed whether the page was sealed for invalidation
+			 *               or was never mapped since last being absent
+			 */
+			virtual bool invalidate(void* page, bool sealed) noexcept = 0;
+
+		protected:
+			void*       base       = nullptr;     //!< Trap region base
+			std::size_t large_area = REGION_SIZE; //!< Offset of the first chunk, see get_extent_at()
+
+			//! Size of the page or chunk which starts at the given address
+			inline std::size_t get_extent(const void* page) const noexcept
+			{
+				return get_extent_at
+				(
+					static_cast<const char*>(page) - static_cast<const char*>(this->base), this->large_area
+				);
+			}
+	};
+
+	/*!
+	 * \brief Traps accesses to pages by mprotect()ing a shared mapping of a
+	 *        sparse file and handling SIGSEGV. The sparse file is written
+	 *        through a second, always writable mapping.
+	 */
+	class signal_backend final : public paging_backend
+	{
+		public:
+			virtual void* install(std::size_t slots, std::size_t chunk_slots, std::size_t readers) final override;
+
+			virtual void uninstall() noexcept final override;
+
+			virtual char* stage(void* page, std::size_t slot) noexcept final override;
+
+			virtual bool map(void* page, std::size_t slot, bool writable) noexcept final override;
+
+			virtual bool wipe(void* page, std::size_t slot) noexcept final override;
+
+			virtual bool protect(void* page, bool writable) noexcept final override;
+
+			virtual bool seal(void* page, bool invalidate) noexcept final override;
+
+			virtual const char* read(void* page) noexcept final override;
+
+			virtual bool invalidate(void* page, bool sealed) noexcept final override;
+
+		private:
+			//! Sparse file which is mapped in the trap region
+			int landing_fd = -1;
+
+			//! Second, always writable mapping of the sparse file
+			char* alias = nullptr;
+
+			//! Offset of a page into the sparse file
+			inline std::size_t get_offset_of(void* page) const noexcept
+			{
+				return static_cast<char*>(page) - static_cast<char*>(this->base);
+			}
+	};
+
+	/*!
+	 * \brief Registers an anonymous trap region with userfaultfd(2). Absent
+	 *        pages are filled with UFFDIO_COPY from per-frame staging pages,
+	 *        and write-protect faults make read-only pages writable. Faults
+	 *        are read by dedicated threads, but no signal is involved.
+	 */
+	class userfault_backend final : public paging_backend
+	{
+		public:
+			virtual void* install(std::size_t slots, std::size_t chunk_slots, std::size_t readers) final override;
+
+			virtual void uninstall() noexcept final override;
+
+			virtual char* stage(void* page, std::size_t slot) noexcept final override;
+
+			virtual bool map(void* page, std::size_t slot, bool writable) noexcept final override;
+
+			virtual bool wipe(void* page, std::size_t slot) noexcept final override;
+
+			virtual bool protect(void* page, bool writable) noexcept final override;
+
+			virtual bool seal(void* page, bool invalidate) noexcept final override;
+
+			virtual const char* read(void* page) noexcept final override;
+
+			virtual bool invalidate(void* page, bool sealed) noexcept final override;
+
+		private:
+			int         fault_fd     = -1;      //!< The userfaultfd
+			int         stop_fd      = -1;      //!< eventfd which stops the reader threads
+			char*       staging      = nullptr; //!< One page or chunk per frame, then a chunk of zeros
+			std::size_t staging_size = 0;       //!< Size of the staging area in bytes
+			std::size_t page_slots   = 0;       //!< Number of page frames
+
+			//! Read and resolve faults until stop_fd is signaled
+			std::vector<std::thread> reader_threads;
+
+			//! Main loop of a reader thread
+			void read_faults() noexcept;
+
+			//! Performs an UFFDIO_COPY from a staging page to a trap region page
+			bool copy(void* page, const char* source, bool writable) noexcept;
+	};
+
 	/*!
 	 * \brief Handles page faults, probe/evict hints and creates the
 	 *        illusion of "remote virtual memory".
@@ -75,180 +305,1473 @@ namespace
 			//! Free resources associated to the trap region
 			~fault_handler();
 
-			void* install(client_session& client);
+			/*!
+			 * \brief Reserves the trap region and starts one worker per
+			 *        session, so that faults are serviced concurrently.
+			 *
+			 * \param client   main session
+			 * \param channels additional sessions which joined the main one
+			 * \param mode     requested backend
+			 * \param chunks   whether to reserve frames for chunks
+			 */
+			void* install
+			(
+				client_session& client,
+				const std::vector<std::unique_ptr<client_session>>& channels,
+				paging mode, bool chunks
+			);
+
+			//! Returns the mechanism through which faults are being caught
+			inline paging get_mode() const noexcept
+			{
+				return this->mode;
+			}
 
+			//! Returns how many pages precede the chunks, or fill the region if there are none
+			inline std::size_t get_page_count() const noexcept
+			{
+				return this->large_area / PAGE_SIZE;
+			}
+
+			/*!
+			 * \brief Performs an operation on a page and waits for its
+			 *        completion. Operations on the same page are serialized,
+			 *        while those on different pages may run in parallel.
+			 */
 			result process(operation action, const void* address, std::size_t limit = 0);
 
+			/*!
+			 * \brief Writes back every dirty page and waits until the
+			 *        server acknowledges, including for writebacks that
+			 *        were already in progress.
+			 *
+			 * \return any failure not yet reported, or result::success
+			 */
+			result synchronize();
+
+			//! Associates a chunk with the remote object that holds it.
+			void bind(const void* chunk, std::size_t id);
+
 		private:
+			//! Threads waiting for a page are spread among this many queues
+			static constexpr std::size_t PAGE_WAIT_QUEUES = 64;
+
+			//! A slot of the resident page set
+			struct frame
+			{
+				void*       page       = nullptr; //!< Resident page, nullptr if free
+				std::size_t length     = 0;       //!< Size of the remote part in this page
+				bool        writable   = false;   //!< Mapped read-write, thus possibly dirty
+				bool        referenced = false;   //!< Accessed since last passed by the clock hand
+				bool        prefetched = false;   //!< Read ahead and not accessed since
+				bool        pristine   = false;   //!< Writable, with its original contents kept
+			};
+
+			/*!
+			 * \brief Tracks misses and hits on read-ahead pages, which
+			 *        are expected to follow a constant stride.
+			 */
+			struct readahead_state
+			{
+				std::size_t    last   = 0; //!< Page number of the last tracked access
+				std::ptrdiff_t stride = 0; //!< Distance between the last two of them, if small
+				std::size_t    window = 0; //!< Pages to read ahead, zero if not sequential
+				std::size_t    next   = 0; //!< Page number where the next readahead starts
+				std::size_t    marker = 0; //!< Hitting this page triggers the next readahead
+			};
+
 			struct transaction
 			{
-				operation   type;
-				void*       address;
-				std::size_t limit;
-				result      response;
+				operation    type;
+				void*        page;
+				std::size_t  limit;
+				result       response;
+				bool         done = false;   //!< Set by the worker once serviced
+				transaction* next = nullptr; //!< Next queued transaction
+
+				inline transaction(operation type, void* page, std::size_t limit) noexcept
+				: type{type}, page{page}, limit{limit}
+				{}
+			};
+
+			//! Protects all of the following state, but is never held during I/O
+			mutable std::mutex mutex;
+
+			//! Oldest queued transaction, nullptr if none
+			transaction* queue_head = nullptr;
+
+			//! Newest queued transaction
+			transaction* queue_tail = nullptr;
+
+			//! Used to wake up workers on new transactions
+			std::condition_variable pending;
+
+			/*!
+			 * \brief Threads that wait for a page to become idle, by page
+			 *        number modulo PAGE_WAIT_QUEUES.
+			 */
+			std::condition_variable page_idle[PAGE_WAIT_QUEUES];
+
+			//! Used to wait for a frame when every one of them is busy
+			std::condition_variable frame_idle;
+
+			//! Wakes up the writer when a batch of writebacks is due
+			std::condition_variable writeback_due;
+
+			//! Used to wait for writebacks in progress, see synchronize()
+			std::condition_variable writeback_done;
+
+			/*!
+			 * \brief Numbers of the pages which an operation is currently
+			 *        working on, mapped to its transaction (nullptr if the
+			 *        operation is internal, such as readahead or eviction).
+			 */
+			ce2103::hash_map<std::size_t, transaction*> busy_pages;
+
+			/*!
+			 * \brief Signal handlers are very limited, so separate threads
+			 *        are needed. Each one owns an entry of 'sessions'.
+			 */
+			std::vector<std::thread> workers;
+
+			//! Writes back dirty pages in batches, through the main session
+			std::thread writer;
+
+			//! Set to make workers exit once the queue is empty
+			bool stopping = false;
+
+			//! Trap region base
+			void* base;
+
+			//! Offset of the first chunk, REGION_SIZE if chunks are disabled
+			std::size_t large_area = REGION_SIZE;
+
+			//! Page mapping and fault reporting mechanism
+			std::unique_ptr<paging_backend> backend;
+
+			//! Which backend is in use
+			paging mode = paging::signals;
+
+			//! Sessions for remote memory operations, the main one first
+			std::vector<client_session*> sessions;
+
+			//! Resident page set, page frames first and chunk frames after them
+			std::vector<frame> frames;
+
+			//! Number of page frames
+			std::size_t page_frames = 0;
+
+			//! Remote object IDs of chunks, by page number (see bind())
+			ce2103::hash_map<std::size_t, std::size_t> chunk_ids;
+
+			/*!
+			 * \brief One page or chunk per frame. Holds the contents as
+			 *        they were when it became writable, so that writebacks
+			 *        only send what changed since. Allocated, but not touched,
+			 *        for every frame.
+			 */
+			std::unique_ptr<char[]> pristine_pages;
+
+			//! Maps page numbers to indices into 'frames'
+			ce2103::hash_map<std::size_t, std::size_t> resident;
+
+			//! Next frame to be considered for replacement (CLOCK algorithm)
+			std::size_t clock_hand = 0;
+
+			//! Same as 'clock_hand', but relative to the first chunk frame
+			std::size_t chunk_clock_hand = 0;
+
+			//! Number of writable frames
+			std::size_t dirty_frames = 0;
+
+			//! Dirty pages are written back no later than this
+			std::chrono::steady_clock::time_point writeback_deadline;
+
+			//! Number of flushes which are waiting for the server
+			std::size_t writebacks_in_flight = 0;
+
+			/*!
+			 * \brief Failures of operations on pages, such as writebacks,
+			 *        by page number. Each one is reported once, by the next
+			 *        operation on the page or by synchronize().
+			 */
+			ce2103::hash_map<std::size_t, result> failed_pages;
+
+			//! Access pattern detection
+			readahead_state readahead;
+
+			//! Main loop of a worker thread
+			void serve(std::size_t index);
+
+			/*!
+			 * \brief Main loop of the writer thread. Dirty pages are
+			 *        written back together once enough of them accumulate
+			 *        or the oldest one has been dirty for long enough.
+			 */
+			void write_behind();
+
+			/*!
+			 * \brief Attempts to complete an operation without a worker,
+			 *        which is possible for idle resident pages that need
+			 *        no data transfer.
+			 *
+			 * \return the response, if the operation was completed
+			 */
+			std::optional<result> try_shortcut(operation action, std::size_t page_number);
+
+			/*!
+			 * \brief Accounts for a frame that has just become writable,
+			 *        waking up the writer if needed.
+			 */
+			void mark_dirty(frame& target);
+
+			//! Makes a resident read-only page writable.
+			bool upgrade(frame& target);
+
+			//! Returns the page that holds the original contents of a frame.
+			inline char* get_pristine_copy(std::size_t slot) noexcept
+			{
+				return this->pristine_pages.get() + get_slot_offset(slot, this->page_frames);
+			}
+
+			//! Size of the page or chunk which starts at the given address
+			inline std::size_t get_extent(const void* page) const noexcept
+			{
+				return get_extent_at
+				(
+					static_cast<const char*>(page) - static_cast<const char*>(this->base), this->large_area
+				);
+			}
+
+			//! Returns the remote object ID of a page or chunk, if known.
+			std::optional<std::size_t> get_remote_id(std::size_t page_number) const noexcept;
+
+			/*!
+			 * \brief Appends patches for the byte ranges in which a page
+			 *        differs from its pristine copy.
+			 *
+			 * \param id       remote object ID
+			 * \param current  contents of the page
+			 * \param original pristine copy of the page
+			 * \param length   size of the remote part in the page
+			 * \param output   where to append the patches
+			 */
+			static void diff
+			(
+				std::size_t id, const char* current, const char* original,
+				std::size_t length, std::vector<client_session::patch>& output
+			);
+
+			//! Performs a transaction on behalf of a worker.
+			result service
+			(
+				std::unique_lock<std::mutex>& lock, client_session& channel,
+				transaction& request, bool& ahead
+			);
+
+			//! Marks a page as idle and wakes up whoever waits for it.
+			void settle(std::size_t page_number);
+
+			//! Records a failure on a page, unless an earlier one is still unreported.
+			void record_failure(std::size_t page_number, result failure);
+
+			//! Takes the unreported failure of a page, if any, or result::success.
+			result take_failure(std::size_t page_number);
+
+			//! Takes every unreported failure, returning any of them, or result::success.
+			result take_failures();
+
+			//! Returns the frame which holds a page, or nullptr if not resident.
+			frame* find_frame(void* page);
+
+			/*!
+			 * \brief Frees a frame for a new page, replacing the least recently
+			 *        used one (approximately) if the resident set is full.
+			 *        Frames whose pages are busy are never replaced. Pages
+			 *        and chunks take frames from their own pools.
+			 *
+			 * \param page     page or chunk that needs a frame
+			 * \param output   set to the free frame on success, or to nullptr
+			 *                 if the pool has no frames at all
+			 * \param may_wait whether to wait if every frame is busy, otherwise
+			 *                 output is set to nullptr in that case
+			 *
+			 * A failure to write back the replaced page is recorded for it.
+			 */
+			void take_frame
+			(
+				std::unique_lock<std::mutex>& lock, client_session& channel,
+				void* page, frame*& output, bool may_wait = true
+			);
+
+			/*!
+			 * \brief Writes back those frames which are writable, all
+			 *        within a single message, and then makes them read-only
+			 *        or, if invalidating, frees them. Pages must be busy,
+			 *        since the lock is released during the writeback.
+			 *
+			 * \param targets    resident frames
+			 * \param invalidate whether to remove the pages from the resident set
+			 * \param writeback  whether to write back pages that are dirty
+			 *
+			 * Failures are recorded for the pages they affect, see take_failure().
+			 */
+			void flush
+			(
+				std::unique_lock<std::mutex>& lock, client_session& channel,
+				const std::vector<frame*>& targets, bool invalidate, bool writeback = true
+			);
+
+			//! Same as above, for a single frame.
+			inline void flush
+			(
+				std::unique_lock<std::mutex>& lock, client_session& channel,
+				frame& target, bool invalidate, bool writeback = true
+			)
+			{
+				this->flush(lock, channel, std::vector<frame*>{&target}, invalidate, writeback);
+			}
+
+			/*!
+			 * \brief Flushes every writable frame, or every frame if invalidating.
+			 *
+			 * \param wait whether to wait for busy pages instead of skipping them
+			 */
+			void flush_all
+			(
+				std::unique_lock<std::mutex>& lock, client_session& channel,
+				bool invalidate, bool wait = false
+			);
+
+			/*!
+			 * \brief Updates access pattern detection after a miss or a
+			 *        first hit on a read-ahead page.
+			 *
+			 * \return whether a readahead should follow
+			 */
+			bool track_access(std::size_t page_number, bool miss) noexcept;
+
+			/*!
+			 * \brief Fetches the current readahead window. Its pages are
+			 *        busy while in transit, so faults on them wait for
+			 *        their arrival instead of fetching them again.
+			 */
+			void read_ahead(std::unique_lock<std::mutex>& lock, client_session& channel);
+
+			/*!
+			 * \brief Fetches an absent page from the server and maps it.
+			 *
+			 * \param page     target virtual page
+			 * \param id       remote object ID
+			 * \param slot     index of the frame that will hold the page
+			 * \param writable whether the page should be made writable
+			 *
+			 * \return pair of result::success (otherwise an error) and
+			 *         the length of the new mapping
+			 */
+			std::pair<result, std::size_t> require
+			(
+				client_session& channel, void* page, std::size_t id, std::size_t slot, bool writable
+			);
+
+			//! Returns a (page number, offset) pair if the address is in the trap region
+			auto get_position_of(const void* page) const noexcept
+				-> std::optional<std::pair<std::size_t, std::size_t>>;
+	} handler;
+
+	/*!
+	 * \brief Signal handler for SIGSEGV. The function's signature is compatible
+	 *        with what ::sigaction() requires.
+	 *
+	 * \param signal_info kernel-provided signal state
+	 * \param context     kernel-provided thread context and CPU registers
+	 */
+	void handle_segmentation_fault(int, ::siginfo_t* signal_info, void* context) noexcept;
+
+	[[noreturn]]
+	void throw_result(result which)
+	{
+		using ce2103::mm::error_code;
+
+		error_code error;
+		switch(which)
+		{
+			case result::fetch_failure:
+				error = error_code::network_failure;
+				break;
+
+			case result::mapping_failure:
+				error = error_code::memory_error;
+				break;
+
+			default:
+				error = error_code::unknown;
+				break;
+		}
+
+		throw std::system_error{error};
+	}
+
+	void* map_region(int protection, int flags, int fd) noexcept
+	{
+		// Some excess is reserved so that an aligned start can be found within
+		void* reservation = ::mmap
+		(
+			nullptr, REGION_SIZE + CHUNK_SIZE, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0
+		);
+
+		if(reservation == MAP_FAILED)
+		{
+			return MAP_FAILED;
+		}
+
+		auto start = reinterpret_cast<std::uintptr_t>(reservation);
+		auto aligned = (start + CHUNK_SIZE - 1) & ~(CHUNK_SIZE - 1);
+
+		void* region = ::mmap
+		(
+			reinterpret_cast<void*>(aligned), REGION_SIZE, protection, flags | MAP_FIXED, fd, 0
+		);
+
+		if(region == MAP_FAILED)
+		{
+			::munmap(reservation, REGION_SIZE + CHUNK_SIZE);
+			return MAP_FAILED;
+		}
+
+		// Trims the excess on both sides
+		if(std::size_t head = aligned - start; head > 0)
+		{
+			::munmap(reservation, head);
+		}
+
+		if(std::size_t tail = CHUNK_SIZE - (aligned - start); tail > 0)
+		{
+			::munmap(static_cast<char*>(region) + REGION_SIZE, tail);
+		}
+
+		// Huge pages are not always available, so failure is ignored
+		::madvise(static_cast<char*>(region) + LARGE_AREA_OFFSET, REGION_SIZE - LARGE_AREA_OFFSET, MADV_HUGEPAGE);
+		return region;
+	}
+
+	fault_handler::~fault_handler()
+	{
+		if(!this->workers.empty())
+		{
+			{
+				std::lock_guard lock{this->mutex};
+				this->stopping = true;
+			}
+
+			this->pending.notify_all();
+			this->writeback_due.notify_all();
+
+			for(auto& worker : this->workers)
+			{
+				worker.join();
+			}
+
+			this->writer.join();
+
+			std::unique_lock lock{this->mutex};
+
+			this->flush_all(lock, *this->sessions.front(), true);
+			auto result = this->take_failures();
+
+			lock.unlock();
+			if(result != result::success)
+			{
+				throw_result(result);
+			}
+
+			this->backend->uninstall();
+
+			// The main session goes last, since it is the one which checks for leaks
+			for(auto session = this->sessions.rbegin(); session != this->sessions.rend(); ++session)
+			{
+				(*session)->finalize();
+			}
+		}
+	}
+
+	void* fault_handler::install
+	(
+		client_session& client,
+		const std::vector<std::unique_ptr<client_session>>& channels,
+		paging mode, bool chunks
+	)
+	{
+		std::lock_guard lock{this->mutex};
+
+		assert(this->workers.empty());
+
+		auto read_capacity = [](const char* variable, std::size_t fallback)
+		{
+			if(const char* text = std::getenv(variable); text != nullptr)
+			{
+				char* end;
+				auto parsed = std::strtoull(text, &end, 10);
+
+				if(*text != '\0' && *end == '\0' && parsed > 0)
+				{
+					return static_cast<std::size_t>(parsed);
+				}
+
+				std::cerr << "=== Ignoring invalid " << variable << " ===\n";
+			}
+
+			return fallback;
+		};
+
+		std::size_t capacity = read_capacity("MM_REMOTE_PAGES", DEFAULT_RESIDENT_PAGES);
+		std::size_t chunk_capacity = chunks ? read_capacity("MM_REMOTE_CHUNKS", DEFAULT_RESIDENT_CHUNKS) : 0;
+
+		this->sessions.assign(1, &client);
+		for(const auto& channel : channels)
+		{
+			this->sessions.push_back(channel.get());
+		}
+
+		this->base = nullptr;
+		if(mode == paging::userfaultfd)
+		{
+			this->backend = std::make_unique<userfault_backend>();
+			if((this->base = this->backend->install(capacity, chunk_capacity, this->sessions.size())) == nullptr)
+			{
+				std::cerr << "=== userfaultfd is unavailable, falling back to SIGSEGV ===\n";
+				mode = paging::signals;
+			}
+		}
+
+		if(this->base == nullptr)
+		{
+			// Throws on failure
+			this->backend = std::make_unique<signal_backend>();
+			this->base = this->backend->install(capacity, chunk_capacity, this->sessions.size());
+		}
+
+		this->mode = mode;
+		this->page_frames = capacity;
+		this->large_area = chunks ? LARGE_AREA_OFFSET : REGION_SIZE;
+		this->frames.assign(capacity + chunk_capacity, frame{});
+
+		// Untouched pages of a large allocation are never actually committed
+		this->pristine_pages.reset(new char[get_slot_offset(this->frames.size(), capacity)]);
+
+		for(std::size_t index = 0; index < this->sessions.size(); ++index)
+		{
+			this->workers.emplace_back(&fault_handler::serve, this, index);
+		}
+
+		this->writer = std::thread{&fault_handler::write_behind, this};
+
+		return this->base;
+	}
+
+	result fault_handler::process(operation action, const void* address, std::size_t limit)
+	{
+		auto position = this->get_position_of(address);
+		if(!position)
+		{
+			return result::uncaught;
+		}
+
+		/* Manipulate bits of the offset to determine the base of the
+		 * virtual page or chunk in which it is located. Normally, this will
+		 * just reset the lower 12 (2^12 bytes = 4KiB) bits of the offset.
+		 */
+		std::size_t offset = position->second & ~(get_extent_at(position->second, this->large_area) - 1);
+
+		void* page = static_cast<char*>(this->base) + offset;
+		std::size_t page_number = offset / PAGE_SIZE;
+		auto& idle = this->page_idle[page_number % PAGE_WAIT_QUEUES];
+
+		std::unique_lock lock{this->mutex};
+		if(auto response = this->try_shortcut(action, page_number))
+		{
+			return *response;
+		}
+
+		// Only one operation at a time may work on a given page
+		idle.wait(lock, [&, this]
+		{
+			return this->busy_pages.search(page_number) == nullptr;
+		});
+
+		transaction request{action, page, limit};
+		this->busy_pages.insert(page_number, &request);
+
+		if(this->queue_tail != nullptr)
+		{
+			this->queue_tail->next = &request;
+		} else
+		{
+			this->queue_head = &request;
+		}
+
+		this->queue_tail = &request;
+		this->pending.notify_one();
+
+		idle.wait(lock, [&request]
+		{
+			return request.done;
+		});
+
+		return request.response;
+	}
+
+	void fault_handler::serve(std::size_t index)
+	{
+		auto& channel = *this->sessions[index];
+
+		std::unique_lock lock{this->mutex};
+		while(true)
+		{
+			this->pending.wait(lock, [this]
+			{
+				return this->queue_head != nullptr || this->stopping;
+			});
+
+			// Pending requests are still serviced after stopping
+			transaction* request = this->queue_head;
+			if(request == nullptr)
+			{
+				break;
+			}
+
+			this->queue_head = request->next;
+			if(this->queue_head == nullptr)
+			{
+				this->queue_tail = nullptr;
+			}
+
+			bool ahead = false;
+			request->response = this->service(lock, channel, *request, ahead);
+
+			// The request might be gone as soon as it is done
+			std::size_t page_number = this->get_position_of(request->page)->first;
+			request->done = true;
+
+			this->settle(page_number);
+
+			// The faulting thread may go on while more pages arrive
+			if(ahead)
+			{
+				this->read_ahead(lock, channel);
+			}
+		}
+	}
+
+	void fault_handler::write_behind()
+	{
+		auto& channel = *this->sessions.front();
+
+		std::unique_lock lock{this->mutex};
+		while(!this->stopping)
+		{
+			if(this->dirty_frames == 0)
+			{
+				this->writeback_due.wait(lock);
+				continue;
+			} else if(this->dirty_frames < WRITEBACK_BATCH
+			       && this->writeback_due.wait_until(lock, this->writeback_deadline)
+			       == std::cv_status::no_timeout)
+			{
+				continue;
+			}
+
+			// Written-back pages remain resident, but read-only
+			this->flush_all(lock, channel, false);
+
+			// Busy pages are skipped, so some might be left over
+			this->writeback_deadline = std::chrono::steady_clock::now() + WRITEBACK_DELAY;
+		}
+	}
+
+	std::optional<result> fault_handler::try_shortcut(operation action, std::size_t page_number)
+	{
+		// Failures are reported by service()
+		if(this->failed_pages.search(page_number) != nullptr)
+		{
+			return std::nullopt;
+		} else if(action == operation::evict)
+		{
+			// Dirty pages are left to write_behind(), which batches them
+			return result::success;
+		} else if(action != operation::begin_read && action != operation::begin_write)
+		{
+			return std::nullopt;
+		}
+
+		auto* index = this->resident.search(page_number);
+		if(index == nullptr || this->busy_pages.search(page_number) != nullptr)
+		{
+			return std::nullopt;
+		}
+
+		// Read-ahead pages must be tracked on first access
+		frame& target = this->frames[*index];
+		if(target.prefetched)
+		{
+			return std::nullopt;
+		}
+
+		target.referenced = true;
+		if(action == operation::begin_write && !target.writable && !this->upgrade(target))
+		{
+			return result::mapping_failure;
+		}
+
+		return result::success;
+	}
+
+	void fault_handler::mark_dirty(frame& target)
+	{
+		target.writable = true;
+		if(++this->dirty_frames == 1)
+		{
+			this->writeback_deadline = std::chrono::steady_clock::now() + WRITEBACK_DELAY;
+			this->writeback_due.notify_one();
+		} else if(this->dirty_frames == WRITEBACK_BATCH)
+		{
+			this->writeback_due.notify_one();
+		}
+	}
+
+	bool fault_handler::upgrade(frame& target)
+	{
+		// The page is read-only, so its contents are the server's
+		std::size_t slot = &target - &this->frames[0];
+		std::memcpy(this->get_pristine_copy(slot), this->backend->read(target.page), target.length);
+
+		if(!this->backend->protect(target.page, true))
+		{
+			return false;
+		}
+
+		target.pristine = true;
+		this->mark_dirty(target);
+
+		return true;
+	}
+
+	void fault_handler::diff
+	(
+		std::size_t id, const char* current, const char* original,
+		std::size_t length, std::vector<client_session::patch>& output
+	)
+	{
+		std::size_t offset = 0;
+		while(true)
+		{
+			offset = std::mismatch(current + offset, current + length, original + offset).first - current;
+			if(offset == length)
+			{
+				break;
+			}
+
+			// A range ends once enough unchanged bytes follow it
+			std::size_t end = offset + 1;
+			for(std::size_t i = end; i < length && i - end < DELTA_MERGE_GAP; ++i)
+			{
+				if(current[i] != original[i])
+				{
+					end = i + 1;
+				}
+			}
+
+			output.push_back({id, offset, std::string_view{current + offset, end - offset}});
+			offset = end;
+		}
+	}
+
+	result fault_handler::synchronize()
+	{
+		std::unique_lock lock{this->mutex};
+
+		this->flush_all(lock, *this->sessions.front(), false, true);
+
+		// Pages might have been taken by other flushes, which must finish too
+		this->writeback_done.wait(lock, [this]
+		{
+			return this->writebacks_in_flight == 0;
+		});
+
+		return this->take_failures();
+	}
+
+	void fault_handler::bind(const void* chunk, std::size_t id)
+	{
+		std::lock_guard lock{this->mutex};
+		this->chunk_ids.insert(this->get_position_of(chunk)->first, id);
+	}
+
+	result fault_handler::service
+	(
+		std::unique_lock<std::mutex>& lock, client_session& channel,
+		transaction& request, bool& ahead
+	)
+	{
+		void* page = request.page;
+		std::size_t page_number = this->get_position_of(page)->first;
+
+		frame* target = this->find_frame(page);
+
+		// Failures of earlier operations on this page are reported here
+		if(auto failure = this->take_failure(page_number); failure != result::success)
+		{
+			return failure;
+		}
+
+		switch(request.type)
+		{
+			case operation::evict:
+				// Dirty pages are left to write_behind(), which batches them
+				return result::success;
+
+			case operation::discard:
+				if(target != nullptr)
+				{
+					this->flush(lock, channel, *target, true, false);
+				}
+
+				// The remote object is about to be freed
+				this->chunk_ids.remove(page_number);
+				return this->take_failure(page_number);
+
+			case operation::wipe:
+				// A resident page must be stale, since the part is new
+				if(target != nullptr)
+				{
+					this->flush(lock, channel, *target, true, false);
+					if(auto failure = this->take_failure(page_number); failure != result::success)
+					{
+						return failure;
+					}
+				}
+
+				this->take_frame(lock, channel, page, target);
+				if(target == nullptr || !this->backend->wipe(page, target - &this->frames[0]))
+				{
+					return result::mapping_failure;
+				}
+
+				*target = frame{page, request.limit, false, true};
+				this->resident.insert(page_number, target - &this->frames[0]);
+
+				this->mark_dirty(*target);
+				return result::success;
+
+			default:
+				break;
+		}
+
+		bool begin_write = request.type == operation::begin_write;
+		if(target != nullptr)
+		{
+			if(target->prefetched)
+			{
+				target->prefetched = false;
+				ahead = this->track_access(page_number, false);
+
+				if(!this->backend->map(page, target - &this->frames[0], false))
+				{
+					return result::mapping_failure;
+				}
+			}
+
+			// Grant more rights to a resident page, if needed
+			target->referenced = true;
+			if(begin_write && !target->writable && !this->upgrade(*target))
+			{
+				return result::mapping_failure;
+			}
+
+			return result::success;
+		}
+
+		// Chunks of freed allocations have no remote object
+		auto id = this->get_remote_id(page_number);
+		if(!id)
+		{
+			return result::fetch_failure;
+		}
+
+		this->take_frame(lock, channel, page, target);
+		if(target == nullptr)
+		{
+			return result::mapping_failure;
+		}
+
+		// The frame is reserved for as long as the page is busy
+		std::size_t slot = target - &this->frames[0];
+		*target = frame{page, 0, false, true};
+
+		lock.unlock();
+		auto [outcome, length] = this->require(channel, page, *id, slot, begin_write);
+		lock.lock();
+
+		if(outcome != result::success)
+		{
+			*target = frame{};
+			return outcome;
+		}
+
+		*target = frame{page, length, false, true};
+		this->resident.insert(page_number, slot);
+
+		if(begin_write)
+		{
+			// See require()
+			target->pristine = true;
+			this->mark_dirty(*target);
+		}
+
+		// Chunks are large enough on their own
+		ahead = this->get_extent(page) == PAGE_SIZE && this->track_access(page_number, true);
+		return result::success;
+	}
+
+	void fault_handler::settle(std::size_t page_number)
+	{
+		this->busy_pages.remove(page_number);
+
+		this->page_idle[page_number % PAGE_WAIT_QUEUES].notify_all();
+		this->frame_idle.notify_all();
+	}
+
+	void fault_handler::record_failure(std::size_t page_number, result failure)
+	{
+		if(this->failed_pages.search(page_number) == nullptr)
+		{
+			this->failed_pages.insert(page_number, failure);
+		}
+	}
+
+	result fault_handler::take_failure(std::size_t page_number)
+	{
+		return this->failed_pages.remove(page_number).value_or(result::success);
+	}
+
+	result fault_handler::take_failures()
+	{
+		auto outcome = result::success;
+		for(const auto& [page_number, failure] : this->failed_pages)
+		{
+			outcome = failure;
+			break;
+		}
+
+		this->failed_pages.clear();
+		return outcome;
+	}
+
+	std::optional<std::size_t> fault_handler::get_remote_id(std::size_t page_number) const noexcept
+	{
+		// Pages are remote objects of their own, with the same number
+		if(page_number < this->get_page_count())
+		{
+			return page_number;
+		} else if(const auto* id = this->chunk_ids.search(page_number); id != nullptr)
+		{
+			return *id;
+		}
+
+		return std::nullopt;
+	}
+
+	auto fault_handler::find_frame(void* page) -> frame*
+	{
+		auto position = this->get_position_of(page);
+		if(!position)
+		{
+			return nullptr;
+		}
+
+		auto* index = this->resident.search(position->first);
+		return index != nullptr ? &this->frames[*index] : nullptr;
+	}
+
+	void fault_handler::take_frame
+	(
+		std::unique_lock<std::mutex>& lock, client_session& channel,
+		void* page, frame*& output, bool may_wait
+	)
+	{
+		bool chunk = this->get_extent(page) == CHUNK_SIZE;
+
+		std::size_t first = chunk ? this->page_frames : 0;
+		std::size_t count = chunk ? this->frames.size() - this->page_frames : this->page_frames;
+		std::size_t& hand = chunk ? this->chunk_clock_hand : this->clock_hand;
+
+		// No frame would ever become idle
+		if(count == 0)
+		{
+			output = nullptr;
+			return;
+		}
+
+		// Referenced frames get a second chance, so this takes at most two laps
+		std::size_t visited = 0;
+		while(true)
+		{
+			if(visited == 2 * count)
+			{
+				if(!may_wait)
+				{
+					output = nullptr;
+					return;
+				}
+
+				// Every frame is busy, so one of them must become idle first
+				this->frame_idle.wait(lock);
+				visited = 0;
+			}
+
+			auto& candidate = this->frames[first + hand];
+			hand = (hand + 1) % count;
+
+			++visited;
+			if(candidate.page == nullptr)
+			{
+				output = &candidate;
+				return;
+			}
+
+			std::size_t page_number = this->get_position_of(candidate.page)->first;
+			if(this->busy_pages.search(page_number) != nullptr)
+			{
+				continue;
+			} else if(candidate.referenced)
+			{
+				candidate.referenced = false;
+				continue;
+			}
+
+			// The victim page is busy while it is being written back
+			this->busy_pages.insert(page_number, nullptr);
+			this->flush(lock, channel, candidate, true);
+			this->settle(page_number);
+
+			output = &candidate;
+			return;
+		}
+	}
+
+	void fault_handler::flush
+	(
+		std::unique_lock<std::mutex>& lock, client_session& channel,
+		const std::vector<frame*>& targets, bool invalidate, bool writeback
+	)
+	{
+		auto fail = [this](const frame& target, result which)
+		{
+			this->record_failure(this->get_position_of(target.page)->first, which);
+		};
+
+		// Indices and IDs of the targets to write back, and whether they have a pristine copy
+		std::vector<std::tuple<std::size_t, std::size_t, bool>> writebacks;
+		std::vector<bool> sealed(targets.size(), false);
+
+		for(std::size_t i = 0; i < targets.size(); ++i)
+		{
+			frame& target = *targets[i];
+			if(!target.writable)
+			{
+				continue;
+			}
+
+			// Failed pages are dropped anyway, their state is unknown
+			target.writable = false;
+			--this->dirty_frames;
+
+			if(writeback && target.length > 0)
+			{
+				if(!(sealed[i] = this->backend->seal(target.page, invalidate)))
+				{
+					fail(target, result::mapping_failure);
+					continue;
+				}
+
+				// Dirty chunks are still bound, since they aren't discarded
+				auto page_number = this->get_position_of(target.page)->first;
+				writebacks.emplace_back(i, *this->get_remote_id(page_number), target.pristine);
+			} else if(!invalidate && !this->backend->protect(target.page, false))
+			{
+				fail(target, result::mapping_failure);
+			}
+
+			target.pristine = false;
+		}
+
+		// All writebacks travel together in a single message
+		if(!writebacks.empty())
+		{
+			++this->writebacks_in_flight;
+			lock.unlock();
+
+			// Busy pages are sealed, and their frames and pristine copies remain untouched
+			std::vector<client_session::patch> patches;
+			for(auto [index, id, has_pristine] : writebacks)
+			{
+				const frame& target = *targets[index];
+				const char* contents = this->backend->read(target.page);
+
+				if(has_pristine)
+				{
+					std::size_t slot = &target - &this->frames[0];
+					diff(id, contents, this->get_pristine_copy(slot), target.length, patches);
+				} else
+				{
+					patches.push_back({id, 0, std::string_view{contents, target.length}});
+				}
+			}
+
+			// Pages might not have changed at all
+			bool written = patches.empty() || channel.overwrite_many(patches);
+			lock.lock();
+
+			if(--this->writebacks_in_flight == 0)
+			{
+				this->writeback_done.notify_all();
+			}
+
+			// Any page of the batch might have been lost
+			if(!written)
+			{
+				for(const auto& writeback : writebacks)
+				{
+					fail(*targets[std::get<0>(writeback)], result::fetch_failure);
+				}
+			}
+		}
+
+		if(invalidate)
+		{
+			for(std::size_t i = 0; i < targets.size(); ++i)
+			{
+				frame& target = *targets[i];
+
+				// Read-ahead pages that were never used indicate a large window
+				if(target.prefetched)
+				{
+					this->readahead.window = std::max(this->readahead.window / 2, MIN_READAHEAD);
+				}
+
+				if(!this->backend->invalidate(target.page, sealed[i]))
+				{
+					fail(target, result::mapping_failure);
+				}
+
+				this->resident.remove(this->get_position_of(target.page)->first);
+				target = frame{};
+			}
+		}
+	}
+
+	void fault_handler::flush_all
+	(
+		std::unique_lock<std::mutex>& lock, client_session& channel, bool invalidate, bool wait
+	)
+	{
+		auto is_candidate = [invalidate](const frame& target)
+		{
+			return target.page != nullptr && (invalidate || target.writable);
+		};
+
+		std::vector<frame*> targets;
+		std::vector<std::size_t> page_numbers;
+		std::vector<std::size_t> skipped;
+
+		for(auto& target : this->frames)
+		{
+			if(!is_candidate(target))
+			{
+				continue;
+			}
+
+			std::size_t page_number = this->get_position_of(target.page)->first;
+			if(this->busy_pages.search(page_number) != nullptr)
+			{
+				skipped.push_back(page_number);
+				continue;
+			}
+
+			this->busy_pages.insert(page_number, nullptr);
+
+			targets.push_back(&target);
+			page_numbers.push_back(page_number);
+		}
+
+		if(!targets.empty())
+		{
+			this->flush(lock, channel, targets, invalidate);
+			for(std::size_t page_number : page_numbers)
+			{
+				this->settle(page_number);
+			}
+		}
+
+		// Busy pages are otherwise left to whoever is working on them
+		if(!wait)
+		{
+			return;
+		}
+
+		for(std::size_t page_number : skipped)
+		{
+			this->page_idle[page_number % PAGE_WAIT_QUEUES].wait(lock, [&, this]
+			{
+				return this->busy_pages.search(page_number) == nullptr;
+			});
+
+			auto* index = this->resident.search(page_number);
+			if(index == nullptr || !is_candidate(this->frames[*index]))
+			{
+				continue;
+			}
+
+			this->busy_pages.insert(page_number, nullptr);
+			this->flush(lock, channel, this->frames[*index], invalidate);
+			this->settle(page_number);
+		}
+	}
+
+	bool fault_handler::track_access(std::size_t page_number, bool miss) noexcept
+	{
+		auto& state = this->readahead;
+		std::size_t max_window = std::min(MAX_READAHEAD, this->page_frames / 4);
+
+		auto distance = static_cast<std::ptrdiff_t>(page_number - state.last);
+		state.last = page_number;
+
+		if(max_window < MIN_READAHEAD)
+		{
+			return false;
+		} else if(!miss)
+		{
+			// Sequential access is ongoing, so the window grows each time
+			if(page_number != state.marker)
+			{
+				return false;
+			}
+		} else if(state.stride == 0 || distance != state.stride)
+		{
+			state.stride = distance != 0 && std::abs(distance) <= MAX_STRIDE ? distance : 0;
+			state.window = 0;
+
+			return false;
+		} else
+		{
+			// Misses mean that readahead is either starting or falling behind
+			state.next = page_number + state.stride;
+		}
+
+		state.window = std::clamp(state.window * 2, MIN_READAHEAD, max_window);
+		return true;
+	}
+
+	void fault_handler::read_ahead(std::unique_lock<std::mutex>& lock, client_session& channel)
+	{
+		auto& state = this->readahead;
+
+		std::vector<std::pair<std::size_t, char*>> targets;
+		std::vector<frame*> reserved;
+
+		auto is_taken = [this](std::size_t page_number)
+		{
+			return this->resident.search(page_number) != nullptr
+			    || this->busy_pages.search(page_number) != nullptr;
+		};
+
+		// take_frame() might release the lock, so the state could change meanwhile
+		std::size_t stride = state.stride;
+		std::size_t window = state.window;
+
+		// Unsigned wraparound handles negative strides
+		std::size_t page_number = state.next;
+		for(std::size_t i = 0; i < window; ++i, page_number += stride)
+		{
+			// Only pages are read ahead
+			if(page_number >= this->get_page_count())
+			{
+				break;
+			} else if(is_taken(page_number))
+			{
+				continue;
+			}
+
+			// Waiting here could starve other operations of frames
+			frame* target;
+			void* page = static_cast<char*>(this->base) + page_number * PAGE_SIZE;
+
+			this->take_frame(lock, channel, page, target, false);
+			if(target == nullptr)
+			{
+				break;
+			} else if(is_taken(page_number))
+			{
+				continue;
+			}
 
-				inline transaction(operation type, void* address, std::size_t limit) noexcept
-				: type{type}, address{address}, limit{limit}
-				{}
-			};
+			// Keeps the frame from being taken again until the page arrives
+			*target = frame{page, 0, false, true};
 
-			//! Current active transaction
-			transaction* request = nullptr;
+			this->busy_pages.insert(page_number, nullptr);
 
-			//! Mutex for thread synchronization
-			mutable std::mutex mutex;
+			char* staging = this->backend->stage(page, target - &this->frames[0]);
+			targets.emplace_back(page_number, staging);
+			reserved.push_back(target);
+		}
 
-			//! Used to wake-up the handler thread on request
-			std::condition_variable transition;
+		state.next = page_number;
+		if(targets.empty())
+		{
+			return;
+		}
 
-			//! Signal handlers are very limited, so a separate thread is needed
-			std::thread handler_thread;
+		// Halfway through this window, the next one is requested
+		state.marker = targets[targets.size() / 2].first;
 
-			//! Trap region base
-			void* base;
+		std::vector<std::optional<std::size_t>> lengths(targets.size());
 
-			//! Sparse file which is mapped in the trap region
-			int landing_fd;
+		auto on_arrival = [&lengths](std::size_t index, auto length)
+		{
+			lengths[index] = length;
+		};
 
-			//! Session through which to perform remote memory operations
-			client_session* client;
+		// Ascending runs without gaps are requested as a single range
+		std::size_t first = targets.front().first;
+		bool contiguous = targets.back().first - first == targets.size() - 1;
 
-			//! Main loop of the handler thread
-			void main_loop();
+		lock.unlock();
+		if(contiguous && channel.has_batches())
+		{
+			std::vector<char*> outputs;
+			for(const auto& [page_number, staging] : targets)
+			{
+				outputs.push_back(staging);
+			}
 
-			/*!
-			 * \brief Reduces rights and resources of an active page.
-			 *
-			 * \param page             active page
-			 * \param invalidate       whether the page should be invalidated
-			 * \param writeback_length non-zero to cause a writeback of that
-			 *                         length; zero to not invoke a writeback
-			 *
-			 * \return result::success, otherwise an error
-			 */
-			result release(void* page, bool invalidate, std::size_t writeback_length);
+			channel.fetch_range(first, outputs, PAGE_SIZE, on_arrival);
+		} else
+		{
+			channel.fetch_many(targets, PAGE_SIZE, on_arrival);
+		}
 
-			/*!
-			 * \brief Require the creation or promotion of a virtual
-			 *        memory mapping.
-			 *
-			 * \param page     target virtual page
-			 * \param fetch    whether to fetch this page from the server
-			 * \param writable whether the page should be made writable
-			 *
-			 * If fetch is false and the page is not already mapped, it will
-			 * be wiped. If it is already mapped, it might only be made writable
-			 * depending on the corresponding parameter.
-			 *
-			 * \return pair of result::success (otherwise an error) and
-			 *         the length of the new mapping (0 if the mapping
-			 *         has not changed or a wipe was requested).
+		lock.lock();
+		for(std::size_t index = 0; index < targets.size(); ++index)
+		{
+			frame& target = *reserved[index];
+
+			/* The page remains inaccessible until its first use, which
+			 * faults without a round trip and lets readahead keep track.
+			 * It stays referenced, so a full lap passes before eviction.
 			 */
-			std::pair<result, std::size_t> require(void* page, bool fetch, bool writable);
+			if(auto length = lengths[index])
+			{
+				target.length = *length;
+				target.prefetched = true;
 
-			//! Returns a (page number, offset) pair if the address is in the trap region
-			auto get_position_of(void* page) const noexcept
-				-> std::optional<std::pair<std::size_t, std::size_t>>;
-	} handler;
+				this->resident.insert(targets[index].first, &target - &this->frames[0]);
+			} else
+			{
+				// Pages past the end of an allocation are not found, for example
+				this->backend->invalidate(target.page, true);
+				target = frame{};
+			}
 
-	/*!
-	 * \brief Signal handler for SIGSEGV. The function's signature is compatible
-	 *        with what ::sigaction() requires.
-	 *
-	 * \param signal_info kernel-provided signal state
-	 * \param context     kernel-provided thread context and CPU registers
-	 */
-	void handle_segmentation_fault(int, ::siginfo_t* signal_info, void* context) noexcept;
+			this->settle(targets[index].first);
+		}
+	}
 
-	[[noreturn]]
-	void throw_result(result which)
+	std::pair<result, std::size_t> fault_handler::require
+	(
+		client_session& channel, void* page, std::size_t id, std::size_t slot, bool writable
+	)
 	{
-		using ce2103::mm::error_code;
+		// Contents are deserialized straight into the staging page
+		auto fetched = channel.fetch(id, this->backend->stage(page, slot), this->get_extent(page));
 
-		error_code error;
-		switch(which)
+		if(!fetched)
 		{
-			case result::fetch_failure:
-				error = error_code::network_failure;
-				break;
-
-			case result::mapping_failure:
-				error = error_code::memory_error;
-				break;
+			// Partial contents would break the assumptions of later wipes
+			this->backend->invalidate(page, true);
+			return std::make_pair(result::fetch_failure, 0);
+		} else if(writable)
+		{
+			// Once mapped, other threads might write to the page at any time
+			std::memcpy(this->get_pristine_copy(slot), this->backend->stage(page, slot), *fetched);
+		}
 
-			default:
-				error = error_code::unknown;
-				break;
+		if(!this->backend->map(page, slot, writable))
+		{
+			return std::make_pair(result::mapping_failure, 0);
 		}
 
-		throw std::system_error{error};
+		return std::make_pair(result::success, *fetched);
 	}
 
-	fault_handler::~fault_handler()
+	auto fault_handler::get_position_of(const void* page) const noexcept
+		-> std::optional<std::pair<std::size_t, std::size_t>>
 	{
-		if(this->handler_thread.joinable())
+		auto difference = static_cast<const char*>(page) - static_cast<const char*>(this->base);
+		if(difference >= 0 && difference < static_cast<std::ptrdiff_t>(REGION_SIZE))
 		{
-			if(auto result = this->process(operation::terminate, nullptr);
-			   result != result::success)
-			{
-				throw_result(result);
-			}
-
-			this->handler_thread.join();
-
-			::munmap(this->base, REGION_SIZE);
-			::close(landing_fd);
-
-			this->client->finalize();
+			auto offset = static_cast<std::size_t>(difference);
+			return std::make_pair(offset / PAGE_SIZE, offset);
 		}
+
+		return std::nullopt;
 	}
 
-	void* fault_handler::install(client_session& client)
+	void* signal_backend::install(std::size_t, std::size_t chunk_slots, std::size_t)
 	{
-		std::lock_guard lock{this->mutex};
-
-		assert(!this->handler_thread.joinable());
+		this->large_area = chunk_slots > 0 ? LARGE_AREA_OFFSET : REGION_SIZE;
 
 		struct ::sigaction action = {};
 		action.sa_flags = SA_SIGINFO;
 		action.sa_sigaction = &handle_segmentation_fault;
 
-		this->landing_fd = -1;
-		this->base = MAP_FAILED;
+		void* base = MAP_FAILED;
+		void* alias = MAP_FAILED;
 
 		/* In order:
 		 *   - Sets the SIGSEGV handler
 		 *   - Creates the anonymous sparse file
 		 *   - Maps the trap region into the virtual address space
-		 *   - Starts the handler thread
+		 *   - Maps the alias region
 		 */
 		if(::sigaction(SIGSEGV, &action, nullptr) != -1
 		&& (this->landing_fd = ::memfd_create("landing", MFD_CLOEXEC)) != -1
 		&& ::ftruncate(this->landing_fd, REGION_SIZE) != -1
-		&& MAP_FAILED != (this->base = ::mmap
-		(
-			nullptr, REGION_SIZE, PROT_NONE,
-			MAP_SHARED | MAP_NORESERVE, this->landing_fd, 0
-		)))
+		&& MAP_FAILED != (base = map_region(PROT_NONE, MAP_SHARED | MAP_NORESERVE, this->landing_fd))
+		&& MAP_FAILED != (alias = map_region(PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, this->landing_fd)))
 		{
-			this->client = &client;
-			this->handler_thread = std::thread{&fault_handler::main_loop, this};
-
-			return this->base;
+			this->alias = static_cast<char*>(alias);
+			return this->base = base;
 		}
 
 		// If something failed, undo the previous operations
 
 		int old_errno = errno;
 
-		if(this->base != MAP_FAILED)
+		if(alias != MAP_FAILED)
+		{
+			::munmap(alias, REGION_SIZE);
+		}
+
+		if(base != MAP_FAILED)
 		{
-			::munmap(this->base, REGION_SIZE);
+			::munmap(base, REGION_SIZE);
 		}
 
 		if(this->landing_fd != -1)
 		{
 			::close(this->landing_fd);
+			this->landing_fd = -1;
 		}
 
 		action.sa_handler = SIG_DFL;
@@ -257,269 +1780,270 @@ namespace
 		throw std::system_error{old_errno, std::system_category()};
 	}
 
-	result fault_handler::process(operation action, const void* address, std::size_t limit)
+	void signal_backend::uninstall() noexcept
 	{
-		std::unique_lock lock{this->mutex};
-
-		this->transition.wait(lock, [this]
-		{
-			return this->request == nullptr;
-		});
+		::munmap(this->base, REGION_SIZE);
+		::munmap(this->alias, REGION_SIZE);
+		::close(this->landing_fd);
+	}
 
-		transaction request{action, const_cast<void*>(address), limit};
-		this->request = &request;
-		this->transition.notify_all();
+	char* signal_backend::stage(void* page, std::size_t) noexcept
+	{
+		// Writing through the alias fills the page without trapping
+		return this->alias + this->get_offset_of(page);
+	}
 
-		this->transition.wait(lock, [&, this]
-		{
-			return this->request != &request;
-		});
+	bool signal_backend::map(void* page, std::size_t, bool writable) noexcept
+	{
+		return this->protect(page, writable);
+	}
 
-		return request.response;
+	bool signal_backend::wipe(void* page, std::size_t) noexcept
+	{
+		// Absent pages are holes in the sparse file, thus already zeroed
+		return this->protect(page, true);
 	}
 
-	void fault_handler::main_loop()
+	bool signal_backend::protect(void* page, bool writable) noexcept
 	{
-		constexpr std::chrono::milliseconds WRITEBACK_TIMEOUT{5};
+		int protection = PROT_READ | (writable ? PROT_WRITE : 0);
+		return ::mprotect(page, this->get_extent(page), protection) != -1;
+	}
 
-		auto is_pending = [this]
-		{
-			return this->request != nullptr;
-		};
+	bool signal_backend::seal(void* page, bool invalidate) noexcept
+	{
+		return ::mprotect(page, this->get_extent(page), invalidate ? PROT_NONE : PROT_READ) != -1;
+	}
 
-		std::unique_lock lock{this->mutex};
+	const char* signal_backend::read(void* page) noexcept
+	{
+		return this->alias + this->get_offset_of(page);
+	}
 
-		void* active = nullptr;
-		bool writeback = false;
-		std::size_t length = 0;
+	bool signal_backend::invalidate(void* page, bool sealed) noexcept
+	{
+		constexpr auto FALLOCATE_FLAGS = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
 
-		bool terminate = false;
+		// fallocate() punches a hole in the sparse file where the page was stored
+		std::size_t extent = this->get_extent(page);
+		return (sealed || ::mprotect(page, extent, PROT_NONE) != -1)
+		    && ::fallocate(this->landing_fd, FALLOCATE_FLAGS, this->get_offset_of(page), extent) != -1;
+	}
 
-		// An error condition might need to be propagated to the next request
-		auto delayed_result = result::success;
+	void* userfault_backend::install(std::size_t slots, std::size_t chunk_slots, std::size_t readers)
+	{
+		constexpr int FLAGS = O_CLOEXEC | O_NONBLOCK;
 
-		while(!terminate)
+		// User-mode-only descriptors don't require privileges, but are newer
+		this->fault_fd = ::syscall(SYS_userfaultfd, FLAGS | UFFD_USER_MODE_ONLY);
+		if(this->fault_fd == -1 && errno == EINVAL)
 		{
-			// Wait for either a request or a writeback timeout
-			bool requested = true;
-			if(writeback)
-			{
-				requested = this->transition.wait_for(lock, WRITEBACK_TIMEOUT, is_pending);
-			} else
-			{
-				this->transition.wait(lock, is_pending);
-			}
-
-			bool wipe = false;
-			bool evict = false;
+			this->fault_fd = ::syscall(SYS_userfaultfd, FLAGS);
+		}
 
-			if(requested)
-			{
-				// Set flags from the request block
-				switch(this->request->type)
-				{
-					case operation::wipe:
-						wipe = true;
-						break;
+		struct ::uffdio_api api = {};
+		api.api = UFFD_API;
+		api.features = UFFD_FEATURE_PAGEFAULT_FLAG_WP;
 
-					case operation::evict:
-						evict = true;
-						break;
+		struct ::uffdio_register registration = {};
+		registration.mode = UFFDIO_REGISTER_MODE_MISSING | UFFDIO_REGISTER_MODE_WP;
 
-					case operation::terminate:
-						terminate = true;
-						break;
+		constexpr auto REQUIRED_IOCTLS = (1ull << _UFFDIO_COPY) | (1ull << _UFFDIO_WRITEPROTECT);
 
-					default:
-						break;
-				}
-			}
+		void* base = MAP_FAILED;
+		void* staging = MAP_FAILED;
 
-			/* Manipulate bits of this->request->address to
-			 * determine the base of the virtual page in which
-			 * it is located. Normally, this will just reset
-			 * the lower 12 (2^12 bytes = 4KiB) bits of the address.
-			 */
-			void* page = !requested || terminate ? nullptr : reinterpret_cast<void*>
-			(
-				  reinterpret_cast<std::uintptr_t>(this->request->address)
-				& ~(PAGE_SIZE - 1) 
-			);
+		this->page_slots = slots;
+		this->large_area = chunk_slots > 0 ? LARGE_AREA_OFFSET : REGION_SIZE;
+		this->staging_size = get_slot_offset(slots + chunk_slots, slots) + CHUNK_SIZE;
 
-			// The current active page must be invalidated under any of these conditions
-			bool invalidate = evict == (active == page) || wipe || page == nullptr;
+		/* In order:
+		 *   - Negotiates write-protect faults
+		 *   - Creates the eventfd that stops the reader threads
+		 *   - Maps the trap region and the staging area
+		 *   - Registers the trap region
+		 *   - Starts the reader threads
+		 */
+		if(this->fault_fd != -1 && ::ioctl(this->fault_fd, UFFDIO_API, &api) != -1
+		&& (this->stop_fd = ::eventfd(0, EFD_CLOEXEC)) != -1
+		&& MAP_FAILED != (base = map_region
+		(
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1
+		))
+		&& MAP_FAILED != (staging = ::mmap
+		(
+			nullptr, this->staging_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+		))
+		&& (registration.range = {reinterpret_cast<std::uintptr_t>(base), REGION_SIZE},
+		    ::ioctl(this->fault_fd, UFFDIO_REGISTER, &registration) != -1)
+		&& (registration.ioctls & REQUIRED_IOCTLS) == REQUIRED_IOCTLS)
+		{
+			this->base = base;
+			this->staging = static_cast<char*>(staging);
 
-			if(active != nullptr)
+			// Faults on different pages are read concurrently
+			for(std::size_t i = 0; i < readers; ++i)
 			{
-				std::size_t writeback_length = writeback ? length : 0;
-
-				/* If the active page is writable, writes back and makes it
-				 * read-only. Conditionally, it also invalidates the page.
-				 */
-				auto release_result = this->release(active, invalidate, writeback_length);
-				if(delayed_result == result::success)
-				{
-					delayed_result = release_result;
-				}
-
-				writeback = false;
-				if(invalidate)
-				{
-					active = nullptr;
-				}
+				this->reader_threads.emplace_back(&userfault_backend::read_faults, this);
 			}
 
-			if(requested)
-			{
-				auto& response = this->request->response;
+			return this->base;
+		}
 
-				// Delayed results are forwarded here, and terminate/evict break here.
-				if(delayed_result != result::success || terminate || evict)
-				{
-					response = delayed_result;
-					delayed_result = result::success;
-				} else
-				{
-					/* Whether the current page is writeable and whether
-					 * the next (possibly the same) active page should bhe
-					 * made writable.
-					 */
-					bool writable = !invalidate && writeback;
-					bool begin_write = wipe || this->request->type == operation::begin_write;
+		// If something failed, undo the previous operations
 
-					/* Either setup a new active page or grant more
-					 * rights to the current one.
-					 */
-					std::size_t new_length;
-					std::tie(response, new_length) = this->require
-					(
-						page, invalidate && !wipe, begin_write && !writable
-					);
-
-					// This occurs on wipes and on promotions of the current active page
-					if(new_length == 0)
-					{
-						new_length = wipe ? this->request->limit : length;
-					}
+		if(staging != MAP_FAILED)
+		{
+			::munmap(staging, this->staging_size);
+		}
 
-					if(response == result::success)
-					{
-						active = page;
-						length = new_length;
-						writeback = writable || begin_write;
-					}
-				}
+		if(base != MAP_FAILED)
+		{
+			::munmap(base, REGION_SIZE);
+		}
 
-				// Request is done, allow the next one in
-				this->request = nullptr;
-				this->transition.notify_all();
+		for(int* descriptor : {&this->stop_fd, &this->fault_fd})
+		{
+			if(*descriptor != -1)
+			{
+				::close(*descriptor);
+				*descriptor = -1;
 			}
 		}
+
+		return nullptr;
 	}
 
-	result fault_handler::release(void* page, bool invalidate, std::size_t writeback_length)
+	void userfault_backend::uninstall() noexcept
 	{
-		if(writeback_length > 0)
+		std::uint64_t increment = 1;
+		::write(this->stop_fd, &increment, sizeof increment);
+
+		for(auto& reader : this->reader_threads)
 		{
-			//! Disable writing
-			if(::mprotect(page, PAGE_SIZE, invalidate ? PROT_NONE : PROT_READ) == -1)
-			{
-				return result::mapping_failure;
-			}
+			reader.join();
+		}
 
-			// Prepare the writeback buffer
-			std::string contents;
-			contents.resize(writeback_length);
+		::munmap(this->base, REGION_SIZE);
+		::munmap(this->staging, this->staging_size);
+		::close(this->stop_fd);
+		::close(this->fault_fd);
+	}
 
-			auto position = this->get_position_of(page);
-			assert(position);
+	char* userfault_backend::stage(void*, std::size_t slot) noexcept
+	{
+		return this->staging + get_slot_offset(slot, this->page_slots);
+	}
 
-			// Remote object ID == page number
-			auto [id, page_offset] = *position;
+	bool userfault_backend::map(void* page, std::size_t slot, bool writable) noexcept
+	{
+		return this->copy(page, this->stage(page, slot), writable);
+	}
 
-			/* Since the page is/was a mapping of the sparse file,
-			 * the contents to writeback can be read from this file.
-			 */
-			if(::lseek(this->landing_fd, page_offset, SEEK_SET) == -1
-			|| ::read(this->landing_fd, &contents[0], writeback_length)
-			   != static_cast<::ssize_t>(writeback_length)
-			|| !client->overwrite(id, contents))
-			{
-				return result::fetch_failure;
-			}
-		}
+	bool userfault_backend::wipe(void* page, std::size_t) noexcept
+	{
+		// The last staging chunk is never written to
+		return this->copy(page, this->staging + this->staging_size - CHUNK_SIZE, true);
+	}
 
-		if(invalidate)
-		{
-			constexpr auto MMAP_FLAGS = MAP_FIXED | MAP_SHARED | MAP_NORESERVE;
-			constexpr auto FALLOCATE_FLAGS = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+	bool userfault_backend::protect(void* page, bool writable) noexcept
+	{
+		// Lifting write protection also wakes up the faulting threads
+		struct ::uffdio_writeprotect request = {};
+		request.range = {reinterpret_cast<std::uintptr_t>(page), this->get_extent(page)};
+		request.mode = writable ? 0 : UFFDIO_WRITEPROTECT_MODE_WP;
 
-			// mmap() recreates the whole trap region, invalidating the package
-			if(::mmap(this->base, REGION_SIZE, PROT_NONE,
-					  MMAP_FLAGS, this->landing_fd, 0) != this->base
-			// fallocate() punches a hole in the sparse file where the page was stored
-			|| ::fallocate(this->landing_fd, FALLOCATE_FLAGS, 0, REGION_SIZE) == -1)
-			{
-				return result::mapping_failure;
-			}
+		return ::ioctl(this->fault_fd, UFFDIO_WRITEPROTECT, &request) != -1;
+	}
+
+	bool userfault_backend::seal(void* page, bool) noexcept
+	{
+		// Readers may go on until the page is actually invalidated
+		return this->protect(page, false);
+	}
+
+	const char* userfault_backend::read(void* page) noexcept
+	{
+		return static_cast<const char*>(page);
+	}
+
+	bool userfault_backend::invalidate(void* page, bool) noexcept
+	{
+		// Next access to the page will be a missing fault
+		return ::madvise(page, this->get_extent(page), MADV_DONTNEED) != -1;
+	}
+
+	bool userfault_backend::copy(void* page, const char* source, bool writable) noexcept
+	{
+		struct ::uffdio_copy request = {};
+		request.dst = reinterpret_cast<std::uintptr_t>(page);
+		request.src = reinterpret_cast<std::uintptr_t>(source);
+		request.len = this->get_extent(page);
+		request.mode = writable ? 0 : UFFDIO_COPY_MODE_WP;
+
+		// EAGAIN means that the address space changed concurrently
+		int status;
+		while((status = ::ioctl(this->fault_fd, UFFDIO_COPY, &request)) == -1 && errno == EAGAIN)
+		{
+			request.copy = 0;
 		}
 
-		return result::success;
+		return status != -1;
 	}
 
-	std::pair<result, std::size_t> fault_handler::require(void* page, bool fetch, bool writable)
+	void userfault_backend::read_faults() noexcept
 	{
-		std::size_t length = 0;
-		if(fetch)
+		struct ::pollfd descriptors[] =
 		{
-			auto position = this->get_position_of(page);
-			if(!position)
-			{
-				return std::make_pair(result::uncaught, 0);
-			}
+			{this->fault_fd, POLLIN, 0},
+			{this->stop_fd, POLLIN, 0}
+		};
 
-			// Actually retrieve the page contents from the server
-			auto [id, page_offset] = *position;
-			auto contents = this->client->fetch(id);
+		while(true)
+		{
+			if(::poll(descriptors, 2, -1) == -1)
+			{
+				if(errno == EINTR)
+				{
+					continue;
+				}
 
-			/* Write the page contents into the corresponding part
-			 * of the sparse file, thereby writing it into the
-			 * virtual mapping.
-			 */
-			if(!contents
-			|| (length = contents->length()) > PAGE_SIZE
-			|| ::lseek(this->landing_fd, page_offset, SEEK_SET) == -1
-			|| ::write(this->landing_fd, contents->data(), length)
-			   != static_cast<::ssize_t>(length))
+				break;
+			} else if(descriptors[1].revents != 0)
 			{
-				return std::make_pair(result::fetch_failure, 0);
+				break;
 			}
-		}
 
-		if(fetch || writable)
-		{
-			// Enable or increase access rights of the page
-			int protection = PROT_READ | (writable ? PROT_WRITE : 0);
-			if(::mprotect(page, PAGE_SIZE, protection) == -1)
+			// Another reader might have taken the message first
+			struct ::uffd_msg message;
+			if(::read(this->fault_fd, &message, sizeof message) != sizeof message
+			|| message.event != UFFD_EVENT_PAGEFAULT)
 			{
-				return std::make_pair(result::mapping_failure, 0);
+				continue;
 			}
-		}
 
-		return std::make_pair(result::success, length);
-	}
+			auto address = message.arg.pagefault.address & ~(PAGE_SIZE - 1);
+			bool was_write = message.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WRITE;
 
-	auto fault_handler::get_position_of(void* page) const noexcept
-		-> std::optional<std::pair<std::size_t, std::size_t>>
-	{
-		auto difference = static_cast<char*>(page) - static_cast<char*>(this->base);
-		if(difference >= 0 && difference < static_cast<std::ptrdiff_t>(REGION_SIZE))
-		{
-			auto offset = static_cast<std::size_t>(difference);
-			return std::make_pair(offset / PAGE_SIZE, offset);
-		}
+			// Faults within a chunk are resolved for the whole chunk
+			auto offset = address - reinterpret_cast<std::uintptr_t>(this->base);
+			address -= offset & (get_extent_at(offset, this->large_area) - 1);
 
-		return std::nullopt;
+			auto type = was_write ? operation::begin_write : operation::begin_read;
+			if(handler.process(type, reinterpret_cast<void*>(address)) != result::success)
+			{
+				// Unlike with SIGSEGV, there is no way to fail the access
+				std::string_view last_words = "=== Unchecked remote memory operation failed ===\n";
+				::write(STDERR_FILENO, last_words.data(), last_words.length());
+
+				std::terminate();
+			}
+
+			// Other faults on the same page might have been resolved already
+			struct ::uffdio_range range = {address, this->get_extent(reinterpret_cast<void*>(address))};
+			::ioctl(this->fault_fd, UFFDIO_WAKE, &range);
+		}
 	}
 
 	void handle_segmentation_fault(int, ::siginfo_t* signal_info, void* context) noexcept
@@ -578,9 +2102,27 @@ namespace ce2103::mm
 		}
 	}
 
+	void remote_manager::flush()
+	{
+		if(auto result = handler.synchronize(); result != result::success)
+		{
+			throw_result(result);
+		}
+	}
+
 	allocation& remote_manager::get_base_of(std::size_t id)
 	{
-		return *reinterpret_cast<allocation*>(static_cast<char*>(this->trap_base) + PAGE_SIZE * id);
+		// Packed IDs are offsets in units of PACKED_GRANULE, large ones are chunk numbers
+		std::size_t offset = PAGE_SIZE * id;
+		if(is_packed(id))
+		{
+			offset = (id & ~PACKED_ID_BIT) * PACKED_GRANULE;
+		} else if(is_large(id))
+		{
+			offset = LARGE_AREA_OFFSET + (id & ~LARGE_ID_BIT) * CHUNK_SIZE;
+		}
+
+		return *reinterpret_cast<allocation*>(static_cast<char*>(this->trap_base) + offset);
 	}
 
 	void remote_manager::do_evict(std::size_t id)
@@ -593,9 +2135,14 @@ namespace ce2103::mm
 		}
 	}
 
-	void remote_manager::install_trap_region()
+	void remote_manager::install_trap_region(paging mode)
+	{
+		this->trap_base = handler.install(this->client, this->channels, mode, this->large_threshold > 0);
+	}
+
+	paging remote_manager::get_paging() const noexcept
 	{
-		this->trap_base = handler.install(this->client);
+		return handler.get_mode();
 	}
 
 	std::size_t remote_manager::get_part_size() const noexcept
@@ -603,6 +2150,26 @@ namespace ce2103::mm
 		return PAGE_SIZE;
 	}
 
+	std::size_t remote_manager::get_chunk_size() const noexcept
+	{
+		return CHUNK_SIZE;
+	}
+
+	std::size_t remote_manager::get_chunk_capacity() const noexcept
+	{
+		return (REGION_SIZE - LARGE_AREA_OFFSET) / CHUNK_SIZE;
+	}
+
+	std::size_t remote_manager::get_part_capacity() const noexcept
+	{
+		return handler.get_page_count();
+	}
+
+	void remote_manager::bind_chunk(std::size_t chunk, std::size_t id)
+	{
+		handler.bind(&this->get_base_of(LARGE_ID_BIT | chunk), id);
+	}
+
 	void remote_manager::wipe(std::size_t id, std::size_t size)
 	{
 		void* address = &this->get_base_of(id);
@@ -612,4 +2179,14 @@ namespace ce2103::mm
 			throw_result(result);
 		}
 	}
+
+	void remote_manager::discard(std::size_t id)
+	{
+		void* address = &this->get_base_of(id);
+		if(auto result = handler.process(operation::discard, address);
+		   result != result::success)
+		{
+			throw_result(result);
+		}
+	}
 }
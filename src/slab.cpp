@@ -0,0 +1,450 @@
+#include <new>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "ce2103/mm/slab.hpp"
+
+namespace
+{
+	//! System page size
+	const std::size_t PAGE_SIZE = ::sysconf(_SC_PAGESIZE);
+}
+
+namespace ce2103::mm
+{
+	struct slab_allocator::thread_cache
+	{
+		//! Maximum number of cached blocks per class
+		static constexpr std::size_t CAPACITY = 64;
+
+		//! Cached free blocks, by class
+		void* blocks[CLASS_COUNT][CAPACITY];
+
+		//! Number of cached blocks, by class
+		std::size_t usage[CLASS_COUNT];
+
+		//! Set on thread exit; blocks go straight to the pools afterwards
+		bool retired;
+	};
+
+	struct slab_allocator::thread_cache_guard
+	{
+		//! Returns all cached blocks to the central pools
+		~thread_cache_guard();
+	};
+
+	[[gnu::tls_model("initial-exec")]]
+	thread_local slab_allocator::thread_cache* slab_allocator::cache = nullptr;
+
+	thread_local slab_allocator::thread_cache_guard slab_allocator::cache_guard;
+
+	slab_allocator::thread_cache_guard::~thread_cache_guard()
+	{
+		auto& self = slab_allocator::get_instance();
+		for(std::size_t size_class = 0; size_class < CLASS_COUNT; ++size_class)
+		{
+			if(cache->usage[size_class] > 0)
+			{
+				self.give(size_class, cache->blocks[size_class], cache->usage[size_class]);
+			}
+		}
+
+		// Shared by every exited thread, blocks go straight to the pools
+		static thread_cache retired_cache = {{}, {}, true};
+
+		delete cache;
+		cache = &retired_cache;
+	}
+
+	auto slab_allocator::make_cache() -> thread_cache&
+	{
+		cache = new thread_cache{};
+
+		// Registers the cache for flushing at thread exit
+		[[maybe_unused]]
+		volatile auto* guard = &cache_guard;
+
+		return *cache;
+	}
+
+	slab_allocator& slab_allocator::get_instance()
+	{
+		//! Per the Standard, initialization will occur on the first call.
+		static slab_allocator allocator;
+		return allocator;
+	}
+
+	void* slab_allocator::allocate(std::size_t size)
+	{
+		if(size > MAX_BLOCK_SIZE)
+		{
+			span* owner = this->take_large(size + SPAN_HEADER_SIZE);
+			owner->used = size;
+
+			std::lock_guard lock{this->large_mutex};
+			this->large_live += size;
+
+			return reinterpret_cast<char*>(owner) + SPAN_HEADER_SIZE;
+		}
+
+		std::size_t size_class = get_size_class(size);
+
+		auto& local = get_cache();
+		if(local.retired)
+		{
+			void* block;
+			this->take(size_class, &block, 1);
+
+			return block;
+		}
+
+		auto& usage = local.usage[size_class];
+		if(usage == 0)
+		{
+			usage = this->take(size_class, local.blocks[size_class], thread_cache::CAPACITY / 2);
+		}
+
+		return local.blocks[size_class][--usage];
+	}
+
+	void slab_allocator::deallocate(void* block) noexcept
+	{
+		if(block == nullptr)
+		{
+			return;
+		}
+
+		span* owner = get_span_of(block);
+		std::size_t size_class = owner->size_class;
+
+		if(size_class == CLASS_COUNT)
+		{
+			{
+				std::lock_guard lock{this->large_mutex};
+				this->large_live -= owner->used;
+			}
+
+			this->give_large(owner);
+			return;
+		}
+
+		// Threads which have never allocated have no cache, and won't get one here
+		thread_cache* local = cache;
+		if(local == nullptr || local->retired)
+		{
+			this->give(size_class, &block, 1);
+			return;
+		}
+
+		constexpr auto HALF = thread_cache::CAPACITY / 2;
+
+		auto& usage = local->usage[size_class];
+		if(usage == thread_cache::CAPACITY)
+		{
+			// Returns the older half of the cache to the pool
+			this->give(size_class, local->blocks[size_class], HALF);
+			for(std::size_t i = 0; i < HALF; ++i)
+			{
+				local->blocks[size_class][i] = local->blocks[size_class][HALF + i];
+			}
+
+			usage = HALF;
+		}
+
+		local->blocks[size_class][usage++] = block;
+	}
+
+	slab_stats slab_allocator::get_stats(std::size_t size_class) const
+	{
+		if(size_class >= CLASS_COUNT)
+		{
+			std::lock_guard lock{this->large_mutex};
+			return slab_stats{0, this->large_reserved, this->large_live};
+		}
+
+		const auto& pool = this->pools[size_class];
+		std::size_t block_size = get_block_size(size_class);
+
+		std::lock_guard lock{pool.mutex};
+		return slab_stats{block_size, pool.slabs * SLAB_SIZE, pool.live * block_size};
+	}
+
+	std::size_t slab_allocator::get_block_size(std::size_t size_class) noexcept
+	{
+		/* Eight classes of 16-byte steps up to 128 bytes, then
+		 * four classes for every following power of two.
+		 */
+		if(size_class < 8)
+		{
+			return (size_class + 1) << 4;
+		}
+
+		std::size_t order = 7 + (size_class - 8) / 4;
+		return (sizeof(char) << order) + ((size_class - 8) % 4 + 1) * (sizeof(char) << (order - 2));
+	}
+
+	std::size_t slab_allocator::get_size_class(std::size_t size) noexcept
+	{
+		if(size <= 128)
+		{
+			return size > 0 ? (size - 1) >> 4 : 0;
+		}
+
+		std::size_t last = size - 1;
+		std::size_t order = sizeof(std::size_t) * 8 - 1 - __builtin_clzl(last);
+
+		return 8 + (order - 7) * 4 + ((last >> (order - 2)) & 0b11);
+	}
+
+	std::size_t slab_allocator::take(std::size_t size_class, void** output, std::size_t count)
+	{
+		auto& pool = this->pools[size_class];
+		std::size_t block_size = get_block_size(size_class);
+		std::size_t capacity = (SLAB_SIZE - SPAN_HEADER_SIZE) / block_size;
+
+		std::lock_guard lock{pool.mutex};
+
+		std::size_t taken = 0;
+		while(taken < count)
+		{
+			span* source = pool.partial;
+			if(source == nullptr)
+			{
+				if(pool.spare != nullptr)
+				{
+					source = pool.spare;
+					pool.spare = nullptr;
+				} else if(taken > 0)
+				{
+					// Better to return a few blocks now than to fail later
+					try
+					{
+						source = map_span(size_class, SLAB_SIZE);
+					} catch(const std::bad_alloc&)
+					{
+						break;
+					}
+
+					++pool.slabs;
+				} else
+				{
+					source = map_span(size_class, SLAB_SIZE);
+					++pool.slabs;
+				}
+
+				source->next = nullptr;
+				source->previous = nullptr;
+				pool.partial = source;
+			}
+
+			while(taken < count && source->used < capacity)
+			{
+				if(source->free_list != nullptr)
+				{
+					output[taken++] = source->free_list;
+					source->free_list = *static_cast<void**>(source->free_list);
+				} else
+				{
+					output[taken++] = source->bump;
+					source->bump += block_size;
+				}
+
+				++source->used;
+			}
+
+			// Full slabs are not kept in any list
+			if(source->used == capacity)
+			{
+				pool.partial = source->next;
+				if(pool.partial != nullptr)
+				{
+					pool.partial->previous = nullptr;
+				}
+			}
+		}
+
+		pool.live += taken;
+		return taken;
+	}
+
+	void slab_allocator::give(std::size_t size_class, void* const* blocks, std::size_t count) noexcept
+	{
+		auto& pool = this->pools[size_class];
+		std::size_t block_size = get_block_size(size_class);
+		std::size_t capacity = (SLAB_SIZE - SPAN_HEADER_SIZE) / block_size;
+
+		auto unlink = [&pool](span* target)
+		{
+			if(target->previous != nullptr)
+			{
+				target->previous->next = target->next;
+			} else
+			{
+				pool.partial = target->next;
+			}
+
+			if(target->next != nullptr)
+			{
+				target->next->previous = target->previous;
+			}
+		};
+
+		std::lock_guard lock{pool.mutex};
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			span* owner = get_span_of(blocks[i]);
+			bool was_full = owner->used == capacity;
+
+			*static_cast<void**>(blocks[i]) = owner->free_list;
+			owner->free_list = blocks[i];
+			--owner->used;
+
+			if(was_full)
+			{
+				owner->previous = nullptr;
+				owner->next = pool.partial;
+
+				if(pool.partial != nullptr)
+				{
+					pool.partial->previous = owner;
+				}
+
+				pool.partial = owner;
+			}
+
+			if(owner->used == 0)
+			{
+				unlink(owner);
+
+				if(pool.spare == nullptr)
+				{
+					owner->free_list = nullptr;
+					owner->bump = reinterpret_cast<char*>(owner) + SPAN_HEADER_SIZE;
+
+					pool.spare = owner;
+				} else
+				{
+					unmap_span(owner);
+					--pool.slabs;
+				}
+			}
+		}
+
+		pool.live -= count;
+	}
+
+	auto slab_allocator::take_large(std::size_t length) -> span*
+	{
+		length = (length + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+		{
+			std::lock_guard lock{this->large_mutex};
+
+			// Best fit, as long as no more than a quarter would be wasted
+			span** best = nullptr;
+			for(auto& slot : this->large_cache)
+			{
+				if(slot != nullptr && slot->length >= length && slot->length - length <= length / 4
+				&& (best == nullptr || slot->length < (*best)->length))
+				{
+					best = &slot;
+				}
+			}
+
+			if(best != nullptr)
+			{
+				span* reused = *best;
+				*best = nullptr;
+
+				this->large_cached -= reused->length;
+				this->large_reserved += reused->length;
+
+				return reused;
+			}
+		}
+
+		span* created = map_span(CLASS_COUNT, length);
+
+		std::lock_guard lock{this->large_mutex};
+		this->large_reserved += length;
+
+		return created;
+	}
+
+	void slab_allocator::give_large(span* target) noexcept
+	{
+		std::size_t length = target->length;
+		if(length <= LARGE_CACHE_SIZE)
+		{
+			// The page that holds the span header remains resident
+			::madvise(reinterpret_cast<char*>(target) + PAGE_SIZE, length - PAGE_SIZE, MADV_DONTNEED);
+
+			std::lock_guard lock{this->large_mutex};
+			if(this->large_cached + length <= LARGE_CACHE_SIZE)
+			{
+				for(auto& slot : this->large_cache)
+				{
+					if(slot == nullptr)
+					{
+						slot = target;
+
+						this->large_cached += length;
+						this->large_reserved -= length;
+
+						return;
+					}
+				}
+			}
+		}
+
+		{
+			std::lock_guard lock{this->large_mutex};
+			this->large_reserved -= length;
+		}
+
+		unmap_span(target);
+	}
+
+	auto slab_allocator::map_span(std::size_t size_class, std::size_t length) -> span*
+	{
+		/* Over-reserve address space and then trim it so that the
+		 * span is aligned to its own size (or to SLAB_SIZE, if larger).
+		 */
+		std::size_t reserved = length + SLAB_SIZE;
+		void* base = ::mmap
+		(
+			nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+		);
+
+		if(base == MAP_FAILED)
+		{
+			throw std::bad_alloc{};
+		}
+
+		auto address = reinterpret_cast<std::uintptr_t>(base);
+		auto aligned = (address + SLAB_SIZE - 1) & ~(SLAB_SIZE - 1);
+
+		if(std::size_t head = aligned - address; head > 0)
+		{
+			::munmap(base, head);
+		}
+
+		if(std::size_t tail = reserved - (aligned - address) - length; tail > 0)
+		{
+			::munmap(reinterpret_cast<void*>(aligned + length), tail);
+		}
+
+		auto* created = new(reinterpret_cast<void*>(aligned)) span{size_class, length};
+		created->bump = reinterpret_cast<char*>(created) + SPAN_HEADER_SIZE;
+
+		return created;
+	}
+
+	void slab_allocator::unmap_span(span* target) noexcept
+	{
+		::munmap(target, target->length);
+	}
+}
@@ -0,0 +1,135 @@
+#include "catch.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+
+#include "ce2103/mm/octets.hpp"
+
+namespace
+{
+	using ce2103::mm::_detail::octet_isa;
+	using ce2103::mm::_detail::octet_kernels;
+
+	//! Longest input that is tested
+	constexpr std::size_t MAX_LENGTH = 300;
+
+	//! Fills a buffer with contents of the given kind
+	std::string make_input(const char* kind, std::mt19937& generator)
+	{
+		std::string input(MAX_LENGTH + 1, '\0');
+		for(char& byte : input)
+		{
+			if(std::strcmp(kind, "sparse") == 0)
+			{
+				// Mostly zeros, so that runs of every length appear
+				byte = generator() % 8 == 0 ? static_cast<char>(generator()) : '\0';
+			} else if(std::strcmp(kind, "dense") == 0)
+			{
+				// Short runs of zeros among small values
+				byte = static_cast<char>(generator() % 3);
+			} else
+			{
+				byte = static_cast<char>(generator());
+			}
+		}
+
+		return input;
+	}
+}
+
+SCENARIO("octet kernels agree across instruction sets", "[mm][octets]")
+{
+	const octet_kernels* scalar = ce2103::mm::_detail::find_octet_kernels(octet_isa::scalar);
+	REQUIRE(scalar != nullptr);
+
+	std::vector<const octet_kernels*> candidates;
+	for(auto isa : {octet_isa::scalar, octet_isa::sse2, octet_isa::avx2})
+	{
+		if(const auto* kernels = ce2103::mm::_detail::find_octet_kernels(isa); kernels != nullptr)
+		{
+			REQUIRE(kernels->isa == isa);
+			candidates.push_back(kernels);
+		}
+	}
+
+	REQUIRE(&ce2103::mm::_detail::get_octet_kernels() == candidates.back());
+
+	GIVEN("sparse, dense and random inputs of up to 300 bytes")
+	{
+		std::mt19937 generator{2103};
+
+		THEN("every instruction set encodes, decodes and scans them as the scalar code does")
+		{
+			for(const char* kind : {"sparse", "dense", "random"})
+			{
+				// Odd offsets break the alignment that vector loads might assume
+				auto buffer = make_input(kind, generator);
+				for(std::size_t offset : {0, 1})
+				{
+					for(std::size_t length = 0; length + offset <= MAX_LENGTH; ++length)
+					{
+						const char* input = buffer.data() + offset;
+
+						std::string expected(2 * length, '\0');
+						scalar->encode_hex(input, length, expected.data());
+
+						for(const auto* kernels : candidates)
+						{
+							CAPTURE(kind, offset, length, static_cast<int>(kernels->isa));
+
+							std::string hex(2 * length, '\0');
+							kernels->encode_hex(input, length, hex.data());
+							REQUIRE(hex == expected);
+
+							std::string decoded(length, '\0');
+							REQUIRE(kernels->decode_hex(hex.data(), length, decoded.data()));
+							REQUIRE(decoded == std::string(input, length));
+
+							REQUIRE(kernels->find_zero_run(input, length) == scalar->find_zero_run(input, length));
+							REQUIRE(kernels->find_nonzero(input, length) == scalar->find_nonzero(input, length));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	GIVEN("hex strings with a single invalid digit")
+	{
+		std::mt19937 generator{42};
+		auto input = make_input("random", generator);
+
+		std::string hex(2 * MAX_LENGTH, '\0');
+		scalar->encode_hex(input.data(), MAX_LENGTH, hex.data());
+
+		THEN("every instruction set rejects them")
+		{
+			// Uppercase, non-ASCII and the neighbours of each valid range
+			const char invalid[] = {'A', 'F', 'G', '\x80', '\xff', '/', ':', '`', 'g', '\0', ' '};
+			const std::size_t lengths[] = {1, 15, 16, 31, 32, 33, 64, 100, MAX_LENGTH};
+
+			for(std::size_t length : lengths)
+			{
+				for(std::size_t position = 0; position < 2 * length; position += position < 70 ? 1 : 13)
+				{
+					for(char digit : invalid)
+					{
+						std::string corrupt = hex.substr(0, 2 * length);
+						corrupt[position] = digit;
+
+						for(const auto* kernels : candidates)
+						{
+							CAPTURE(length, position, static_cast<int>(digit), static_cast<int>(kernels->isa));
+
+							std::string decoded(length, '\0');
+							REQUIRE(!kernels->decode_hex(corrupt.data(), length, decoded.data()));
+						}
+					}
+				}
+			}
+		}
+	}
+}
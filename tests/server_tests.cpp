@@ -0,0 +1,235 @@
+#include "catch.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <string_view>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "ce2103/hash.hpp"
+#include "ce2103/network.hpp"
+
+#include "ce2103/mm/client.hpp"
+#include "ce2103/mm/server.hpp"
+
+namespace
+{
+	using ce2103::mm::drop_result;
+	using ce2103::mm::client_session;
+	using ce2103::mm::server_session;
+
+	//! Preshared key of every test session
+	constexpr std::string_view SECRET = "range commands";
+
+	//! Connects two sockets to each other through the loopback interface
+	std::pair<ce2103::socket, ce2103::socket> make_socket_pair()
+	{
+		ce2103::socket listener;
+		REQUIRE(listener.bind(*ce2103::ip_endpoint::try_from("127.0.0.1:0"), true));
+
+		struct ::sockaddr_in address = {};
+		::socklen_t address_size = sizeof address;
+		REQUIRE(::getsockname(listener.get_descriptor(), reinterpret_cast<struct ::sockaddr*>(&address),
+		                      &address_size) == 0);
+
+		auto endpoint = ce2103::ip_endpoint::try_from("127.0.0.1:" + std::to_string(ntohs(address.sin_port)));
+		REQUIRE(endpoint);
+
+		ce2103::socket client;
+		REQUIRE(client.connect(*endpoint));
+
+		auto server = listener.accept();
+		REQUIRE(server);
+
+		return {std::move(client), std::move(*server)};
+	}
+
+	//! A client session, served by a server session on a thread of its own
+	class served_session
+	{
+		public:
+			//! Connects and authorizes a new client session
+			served_session()
+			{
+				// Sessions lost by the client are written to by the server once more
+				std::signal(SIGPIPE, SIG_IGN);
+
+				auto [client_socket, server_socket] = make_socket_pair();
+				this->server.emplace(std::move(server_socket), this->secret);
+
+				this->serving = std::thread{[this]
+				{
+					while(this->server->on_input())
+					{
+						continue;
+					}
+				}};
+
+				this->client.emplace(std::move(client_socket), SECRET);
+				REQUIRE(!this->client->is_lost());
+				REQUIRE(this->client->has_batches());
+			}
+
+			//! Ends both sessions
+			~served_session()
+			{
+				if(!this->client->is_lost())
+				{
+					this->client->finalize();
+				}
+
+				this->client.reset();
+				this->serving.join();
+			}
+
+			//! Returns the client end
+			inline client_session& operator*() noexcept
+			{
+				return *this->client;
+			}
+
+			//! Returns the client end
+			inline client_session* operator->() noexcept
+			{
+				return &*this->client;
+			}
+
+		private:
+			server_session::secret_hash   secret = ce2103::md5::of(SECRET);
+			std::optional<server_session> server;
+			std::optional<client_session> client;
+			std::thread                   serving;
+	};
+}
+
+SCENARIO("objects are lifted and dropped by range", "[mm][server]")
+{
+	using results = std::vector<drop_result>;
+
+	GIVEN("an allocation of three parts, and a session that shares its objects")
+	{
+		served_session session;
+		served_session joined;
+
+		auto token = session->share();
+		REQUIRE(token);
+		REQUIRE(joined->join(*token));
+
+		// The first part starts with two references, the others with one
+		auto first = session->allocate(16, 3, 0, "char");
+		REQUIRE(first);
+
+		THEN("a range drop leaves the first part hanging and loses the others")
+		{
+			REQUIRE(session->drop_range(*first, 3) == results{drop_result::hanging, drop_result::lost,
+			                                                   drop_result::lost});
+			REQUIRE(session->drop(*first) == drop_result::lost);
+		}
+
+		THEN("lifted parts are reduced or left hanging instead")
+		{
+			REQUIRE(session->lift_range(*first, 3));
+			REQUIRE(session->drop_range(*first, 3) == results{drop_result::reduced, drop_result::hanging,
+			                                                   drop_result::hanging});
+
+			REQUIRE(session->drop_range(*first, 3) == results{drop_result::hanging, drop_result::lost,
+			                                                   drop_result::lost});
+			REQUIRE(session->drop(*first) == drop_result::lost);
+		}
+
+		THEN("ranges with missing IDs are rejected as a whole")
+		{
+			REQUIRE(!session->drop_range(*first, 4));
+			REQUIRE(session->is_lost());
+
+			REQUIRE(joined->drop_range(*first, 3) == results{drop_result::hanging, drop_result::lost,
+			                                                  drop_result::lost});
+			REQUIRE(joined->drop(*first) == drop_result::lost);
+		}
+
+		THEN("ranges whose end overflows are rejected")
+		{
+			// Starting from the second part, so that the end overflows even for ID zero
+			REQUIRE(!session->lift_range(*first + 1, SIZE_MAX));
+			REQUIRE(!joined->drop_range(*first + 1, SIZE_MAX));
+
+			served_session cleanup;
+			REQUIRE(cleanup->join(*token));
+
+			REQUIRE(cleanup->drop_range(*first, 3) == results{drop_result::hanging, drop_result::lost,
+			                                                   drop_result::lost});
+			REQUIRE(cleanup->drop(*first) == drop_result::lost);
+		}
+	}
+}
+
+SCENARIO("objects are read by range", "[mm][server]")
+{
+	GIVEN("three objects of distinct contents")
+	{
+		served_session session;
+
+		auto first = session->allocate(4, 3, 0, "char");
+		REQUIRE(first);
+
+		for(std::size_t i = 0; i < 3; ++i)
+		{
+			REQUIRE(session->overwrite(*first + i, std::string(4, static_cast<char>('a' + i))));
+		}
+
+		std::vector<std::string> buffers(4, std::string(4, '\0'));
+		std::vector<std::optional<std::size_t>> sizes(4);
+
+		auto read = [&](std::size_t from, std::size_t count)
+		{
+			std::vector<char*> outputs;
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				outputs.push_back(buffers[i].data());
+			}
+
+			return session->fetch_range(from, outputs, 4, [&sizes](std::size_t index, auto size)
+			{
+				sizes[index] = size;
+			});
+		};
+
+		THEN("each object in the range is read in order")
+		{
+			REQUIRE(read(*first, 3));
+			for(std::size_t i = 0; i < 3; ++i)
+			{
+				REQUIRE(sizes[i] == 4u);
+				REQUIRE(buffers[i] == std::string(4, static_cast<char>('a' + i)));
+			}
+
+			REQUIRE(session->drop_range(*first, 3));
+			REQUIRE(session->drop(*first) == drop_result::lost);
+		}
+
+		THEN("missing objects within the range fail on their own")
+		{
+			REQUIRE(read(*first + 1, 3));
+
+			REQUIRE(sizes[0] == 4u);
+			REQUIRE(sizes[1] == 4u);
+			REQUIRE(!sizes[2]);
+
+			REQUIRE(session->drop_range(*first, 3));
+			REQUIRE(session->drop(*first) == drop_result::lost);
+		}
+
+		THEN("a range longer than the number of objects ends the session")
+		{
+			REQUIRE(!read(*first, 4));
+			REQUIRE(session->is_lost());
+		}
+	}
+}
@@ -0,0 +1,325 @@
+#include "catch.hpp"
+
+#include <string>
+#include <random>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "ce2103/network.hpp"
+
+#include "ce2103/mm/session.hpp"
+
+namespace
+{
+	//! Exposes the frame codec of a session, without a server behind it
+	class loopback_session : public ce2103::mm::session
+	{
+		public:
+			using session::opcode;
+			using session::packing;
+			using session::frame_header;
+			using session::FRAME_HEADER_SIZE;
+			using session::COMPRESSION_THRESHOLD;
+
+			using session::put_frame;
+			using session::put_octets;
+			using session::send_frames;
+			using session::receive_header;
+			using session::receive_payload;
+			using session::receive_octets;
+			using session::set_compressed;
+
+			explicit loopback_session(ce2103::socket peer) noexcept
+			: session{std::move(peer)}
+			{}
+	};
+
+	using opcode = loopback_session::opcode;
+	using packing = loopback_session::packing;
+	using frame_header = loopback_session::frame_header;
+
+	//! Connects two sessions to each other through the loopback interface
+	std::pair<loopback_session, loopback_session> make_session_pair()
+	{
+		ce2103::socket listener;
+		REQUIRE(listener.bind(*ce2103::ip_endpoint::try_from("127.0.0.1:0"), true));
+
+		struct ::sockaddr_in address = {};
+		::socklen_t address_size = sizeof address;
+		REQUIRE(::getsockname(listener.get_descriptor(), reinterpret_cast<struct ::sockaddr*>(&address),
+		                      &address_size) == 0);
+
+		auto endpoint = ce2103::ip_endpoint::try_from("127.0.0.1:" + std::to_string(ntohs(address.sin_port)));
+		REQUIRE(endpoint);
+
+		// The kernel completes the handshake before accept() is called
+		ce2103::socket sender;
+		REQUIRE(sender.connect(*endpoint));
+
+		auto receiver = listener.accept();
+		REQUIRE(receiver);
+
+		return {loopback_session{std::move(sender)}, loopback_session{std::move(*receiver)}};
+	}
+
+	//! Builds the wire form of a frame header from its fields
+	std::string header_bytes
+	(
+		std::uint8_t type, std::uint8_t more, std::uint8_t format,
+		std::uint8_t reserved, std::uint32_t length = 0
+	)
+	{
+		std::string bytes{static_cast<char>(type), static_cast<char>(more),
+		                  static_cast<char>(format), static_cast<char>(reserved)};
+
+		for(std::size_t i = 0; i < 4; ++i)
+		{
+			bytes.push_back(static_cast<char>(length >> (8 * i)));
+		}
+
+		bytes.resize(loopback_session::FRAME_HEADER_SIZE, '\0');
+		return bytes;
+	}
+
+	//! Receives the contents of the next frame, if well-formed and of at most 'limit' bytes
+	std::optional<std::string> receive_contents
+	(
+		loopback_session& receiver, std::size_t limit, packing expected_format
+	)
+	{
+		auto header = receiver.receive_header();
+		REQUIRE(header);
+		REQUIRE(header->type == opcode::contents);
+		REQUIRE(header->format == expected_format);
+
+		std::string contents;
+		bool skipped = false;
+
+		bool well_formed = receiver.receive_octets(*header, [&](std::size_t size) -> char*
+		{
+			if(size > limit)
+			{
+				skipped = true;
+				return nullptr;
+			}
+
+			contents.resize(size);
+			return contents.data();
+		});
+
+		if(!well_formed || skipped)
+		{
+			return std::nullopt;
+		}
+
+		return contents;
+	}
+}
+
+SCENARIO("frame headers round-trip", "[mm][session]")
+{
+	auto [sender, receiver] = make_session_pair();
+
+	GIVEN("a write frame with every field set")
+	{
+		frame_header header{opcode::write, true, 3, 0x0102030405060708, 0x1112131415161718};
+
+		std::string frame;
+		loopback_session::put_frame(frame, header, "abc");
+
+		THEN("its fields are laid out in little-endian order")
+		{
+			std::string expected = header_bytes(3, 1, 0, 0, 3);
+			for(std::size_t i = 0; i < 8; ++i)
+			{
+				expected[8 + i] = static_cast<char>(8 - i);
+				expected[16 + i] = static_cast<char>(0x18 - i);
+			}
+
+			REQUIRE(frame == expected + "abc");
+		}
+
+		THEN("it is received as it was sent")
+		{
+			sender.send_frames(frame);
+
+			auto received = receiver.receive_header();
+			REQUIRE(received);
+			REQUIRE(received->type == opcode::write);
+			REQUIRE(received->more);
+			REQUIRE(received->length == 3);
+			REQUIRE(received->id == header.id);
+			REQUIRE(received->offset == header.offset);
+			REQUIRE(received->format == packing::raw);
+
+			std::string payload(3, '\0');
+			REQUIRE(receiver.receive_payload(payload.data(), payload.length()));
+			REQUIRE(payload == "abc");
+		}
+	}
+
+	GIVEN("malformed headers")
+	{
+		THEN("each one is rejected")
+		{
+			// Reserved byte, unknown opcode, non-boolean 'more'
+			for(const auto& bytes : {header_bytes(0, 0, 0, 1), header_bytes(4, 0, 0, 0),
+			                         header_bytes(0xff, 0, 0, 0), header_bytes(3, 2, 0, 0)})
+			{
+				sender.send_frames(bytes);
+				REQUIRE(!receiver.receive_header());
+			}
+
+			// Only contents and writes may be packed, and only in known formats
+			for(auto type : {opcode::message, opcode::read})
+			{
+				sender.send_frames(header_bytes(static_cast<std::uint8_t>(type), 0, 1, 0));
+				REQUIRE(!receiver.receive_header());
+			}
+
+			sender.send_frames(header_bytes(static_cast<std::uint8_t>(opcode::contents), 0, 3, 0));
+			REQUIRE(!receiver.receive_header());
+
+			// The stream is still in sync, since none of them had a payload
+			sender.send_frames(header_bytes(static_cast<std::uint8_t>(opcode::write), 0, 2, 0));
+			auto header = receiver.receive_header();
+
+			REQUIRE(header);
+			REQUIRE(header->format == packing::zeros);
+		}
+	}
+}
+
+SCENARIO("contents payloads are packed and unpacked", "[mm][session]")
+{
+	auto [sender, receiver] = make_session_pair();
+	sender.set_compressed();
+	receiver.set_compressed();
+
+	constexpr std::size_t PAGE = 4096;
+
+	std::string random(PAGE, '\0');
+	std::mt19937 generator{2103};
+
+	for(char& byte : random)
+	{
+		byte = static_cast<char>(generator());
+	}
+
+	std::string text;
+	while(text.length() < PAGE)
+	{
+		text += "remote memory pointer ";
+	}
+
+	text.resize(PAGE);
+	std::string zeros(PAGE, '\0');
+
+	auto send_contents = [&sender = sender](std::string_view contents)
+	{
+		std::string frame;
+		sender.put_octets(frame, {opcode::contents, false, 0, 1}, contents);
+		sender.send_frames(frame);
+
+		return frame.length() - loopback_session::FRAME_HEADER_SIZE;
+	};
+
+	GIVEN("contents of each kind")
+	{
+		THEN("they are sent in the smallest format that applies")
+		{
+			REQUIRE(send_contents(random.substr(0, loopback_session::COMPRESSION_THRESHOLD - 1))
+			        == loopback_session::COMPRESSION_THRESHOLD - 1);
+			REQUIRE(receive_contents(receiver, PAGE, packing::raw)
+			        == random.substr(0, loopback_session::COMPRESSION_THRESHOLD - 1));
+
+			REQUIRE(send_contents(random) == PAGE);
+			REQUIRE(receive_contents(receiver, PAGE, packing::raw) == random);
+
+			REQUIRE(send_contents(text) < PAGE / 8);
+			REQUIRE(receive_contents(receiver, PAGE, packing::lz) == text);
+
+			REQUIRE(send_contents(zeros) == 4);
+			REQUIRE(receive_contents(receiver, PAGE, packing::zeros) == zeros);
+		}
+	}
+
+	GIVEN("contents larger than the receiver allows")
+	{
+		THEN("they are skipped and the stream stays in sync")
+		{
+			send_contents(random);
+			REQUIRE(!receive_contents(receiver, PAGE - 1, packing::raw));
+
+			send_contents(text);
+			REQUIRE(!receive_contents(receiver, PAGE - 1, packing::lz));
+
+			// A declared size far beyond the payload itself
+			std::string frame;
+			loopback_session::put_frame(frame, {opcode::contents, false, 4, 1, 0, packing::zeros},
+			                            std::string_view{"\xff\xff\xff\x7f", 4});
+
+			sender.send_frames(frame);
+			REQUIRE(!receive_contents(receiver, PAGE, packing::zeros));
+
+			send_contents(text);
+			REQUIRE(receive_contents(receiver, PAGE, packing::lz) == text);
+		}
+	}
+
+	GIVEN("malformed packed payloads")
+	{
+		auto send_packed = [&sender = sender](packing format, std::string_view payload)
+		{
+			std::string frame;
+			loopback_session::put_frame
+			(
+				frame, {opcode::contents, false, static_cast<std::uint32_t>(payload.length()), 1, 0, format},
+				payload
+			);
+
+			sender.send_frames(frame);
+		};
+
+		std::string size_prefix{"\x00\x10\x00\x00", 4};
+
+		THEN("they are rejected")
+		{
+			// Shorter than the size prefix
+			send_packed(packing::lz, "\x00\x10");
+			REQUIRE(!receive_contents(receiver, PAGE, packing::lz));
+
+			// Zeros with trailing bytes
+			send_packed(packing::zeros, size_prefix + "x");
+			REQUIRE(!receive_contents(receiver, PAGE, packing::zeros));
+
+			// An LZ block that doesn't decompress to the declared size
+			send_packed(packing::lz, size_prefix + "\x10x");
+			REQUIRE(!receive_contents(receiver, PAGE, packing::lz));
+
+			send_contents(zeros);
+			REQUIRE(receive_contents(receiver, PAGE, packing::zeros) == zeros);
+		}
+	}
+
+	GIVEN("a receiver that didn't negotiate compression")
+	{
+		auto [plain_sender, plain_receiver] = make_session_pair();
+		plain_sender.set_compressed();
+
+		THEN("packed payloads are rejected")
+		{
+			std::string frame;
+			plain_sender.put_octets(frame, {opcode::contents, false, 0, 1}, text);
+			plain_sender.send_frames(frame);
+
+			REQUIRE(!receive_contents(plain_receiver, PAGE, packing::lz));
+		}
+	}
+}
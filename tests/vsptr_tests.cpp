@@ -4,15 +4,41 @@
 #include "ce2103/mm/vsptr.hpp"
 
 
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 
 #include "ce2103/mm/init.hpp"
 #include "ce2103/mm/vsptr.hpp"
+#include "ce2103/mm/client.hpp"
+
+namespace
+{
+	//! Remote allocations of at least this size are paged in chunks
+	constexpr std::size_t LARGE_THRESHOLD = 1 << 20;
+
+	//! Size of a chunk, see remote_manager
+	constexpr std::size_t CHUNK_SIZE = 2 << 20;
+
+	//! Initializes the library with the settings that every scenario expects
+	void initialize_library()
+	{
+		ce2103::mm::options settings;
+		settings.large_object_threshold = LARGE_THRESHOLD;
+
+		ce2103::mm::initialize(settings);
+	}
+}
 
 SCENARIO("basic VSPtr<T> usage", "[mm]")
 {
 	using ce2103::mm::VSPtr;
-	ce2103::mm::initialize();
+	initialize_library();
 
 	GIVEN("two VSPtr<int>s")
 	{
@@ -51,3 +77,517 @@ SCENARIO("basic VSPtr<T> usage", "[mm]")
 		}
 	}
 }
+
+namespace
+{
+	//! Keeps count of its live instances
+	struct tracked
+	{
+		static inline int alive = 0;
+
+		tracked() noexcept
+		{
+			++alive;
+		}
+
+		~tracked()
+		{
+			--alive;
+		}
+	};
+
+	//! A list node which might form reference cycles
+	struct linked : tracked
+	{
+		ce2103::mm::VSPtr<linked> next;
+
+		void trace(ce2103::mm::tracer& visitor) const
+		{
+			visitor(this->next);
+		}
+	};
+}
+
+SCENARIO("garbage collection of unreachable objects", "[mm][gc]")
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::generation;
+	using ce2103::mm::memory_manager;
+	using ce2103::mm::garbage_collector;
+
+	initialize_library();
+
+	// Remote objects are not collected by the local GC
+	if(memory_manager::get_default(at::any).get_locality() != at::local)
+	{
+		return;
+	}
+
+	GIVEN("a set of local objects")
+	{
+		auto& gc = garbage_collector::get_instance();
+		gc.collect();
+
+		auto single = VSPtr<tracked>::New();
+		auto array = VSPtr<tracked[]>::New(16);
+
+		REQUIRE(tracked::alive == 17);
+
+		WHEN("they are still referenced")
+		{
+			auto copy = single;
+			single = nullptr;
+
+			THEN("a sweep does not free them")
+			{
+				gc.collect();
+				REQUIRE(tracked::alive == 17);
+			}
+		}
+
+		WHEN("all references are dropped")
+		{
+			single = nullptr;
+			array = nullptr;
+
+			THEN("a sweep destroys and frees them")
+			{
+				REQUIRE(gc.collect() >= 2);
+				REQUIRE(tracked::alive == 0);
+			}
+		}
+
+		WHEN("enough garbage accumulates")
+		{
+			auto tuning = gc.get_tuning();
+
+			auto eager = tuning;
+			eager.dead_count = 64;
+			gc.set_tuning(eager);
+
+			auto triggers = gc.get_schedule_stats().triggers;
+			for(int i = 0; i < 128; ++i)
+			{
+				VSPtr<int>::New(i);
+			}
+
+			THEN("a sweep is triggered without waiting for the period")
+			{
+				auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+				while(gc.get_schedule_stats().triggers == triggers
+				   && std::chrono::steady_clock::now() < deadline)
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds{1});
+				}
+
+				REQUIRE(gc.get_schedule_stats().triggers > triggers);
+			}
+
+			gc.set_tuning(tuning);
+		}
+
+		WHEN("references are dropped while deferred")
+		{
+			garbage_collector::set_deferred_references(true);
+
+			for(int i = 0; i < 1'000; ++i)
+			{
+				auto copy = single;
+			}
+
+			single = nullptr;
+			array = nullptr;
+
+			THEN("they are freed once the thread flushes its decrements")
+			{
+				REQUIRE(gc.collect() >= 2);
+				REQUIRE(tracked::alive == 0);
+			}
+
+			garbage_collector::set_deferred_references(false);
+		}
+
+		WHEN("contiguous allocations are lifted and dropped by range")
+		{
+			using ce2103::mm::drop_result;
+
+			gc.require_contiguous_ids(3);
+
+			auto first = std::get<0>(gc.allocate_of<char>(1));
+			for(std::size_t i = 1; i < 3; ++i)
+			{
+				REQUIRE(std::get<0>(gc.allocate_of<char>(1)) == first + i);
+			}
+
+			gc.lift_range(first, 3, 2);
+
+			THEN("each range drop decrements every reference count once")
+			{
+				REQUIRE(gc.drop_range(first, 3) == std::vector(3, drop_result::reduced));
+				REQUIRE(gc.drop_range(first, 3) == std::vector(3, drop_result::hanging));
+				REQUIRE(gc.drop_range(first, 3) == std::vector(3, drop_result::lost));
+			}
+		}
+
+		WHEN("more contiguous allocations than an ID block holds are required")
+		{
+			constexpr std::size_t count = garbage_collector::SHARD_SPAN + 2;
+			gc.require_contiguous_ids(count);
+
+			auto first = std::get<0>(gc.allocate_of<char>(1));
+
+			bool contiguous = true;
+			for(std::size_t i = 1; i < count; ++i)
+			{
+				contiguous = contiguous && std::get<0>(gc.allocate_of<char>(1)) == first + i;
+			}
+
+			THEN("they take consecutive blocks")
+			{
+				REQUIRE(contiguous);
+				REQUIRE(gc.drop_range(first, count) == std::vector(count, ce2103::mm::drop_result::lost));
+			}
+		}
+
+		WHEN("they survive a sweep before being dropped")
+		{
+			auto promoted = gc.get_stats(generation::young).promoted;
+			gc.collect();
+
+			single = nullptr;
+			array = nullptr;
+
+			THEN("they are promoted and later freed as old objects")
+			{
+				REQUIRE(gc.get_stats(generation::young).promoted >= promoted + 2);
+				REQUIRE(gc.collect() >= 2);
+				REQUIRE(tracked::alive == 0);
+			}
+		}
+	}
+}
+
+SCENARIO("collection of reference cycles", "[mm][gc]")
+{
+	using ce2103::mm::at;
+	using ce2103::mm::VSPtr;
+	using ce2103::mm::memory_manager;
+	using ce2103::mm::garbage_collector;
+
+	initialize_library();
+	if(memory_manager::get_default(at::any).get_locality() != at::local)
+	{
+		return;
+	}
+
+	GIVEN("two local objects which point to each other")
+	{
+		auto& gc = garbage_collector::get_instance();
+		gc.set_cycle_collection(true);
+
+		// This is the only thread that touches these objects
+		garbage_collector::stopped_world world;
+
+		// Cleans up after previous runs of this scenario
+		gc.collect_cycles(world);
+		REQUIRE(tracked::alive == 0);
+
+		auto first = VSPtr<linked>::New();
+		auto second = VSPtr<linked>::New();
+		auto outside = VSPtr<linked>::New();
+
+		first->next = second;
+		second->next = first;
+		outside->next = first;
+
+		WHEN("the cycle is still referenced from outside")
+		{
+			first = nullptr;
+			second = nullptr;
+
+			THEN("it is not freed")
+			{
+				gc.collect_cycles(world);
+				REQUIRE(tracked::alive == 3);
+			}
+
+			// Cycles are never collected implicitly, not even at exit
+			outside = nullptr;
+			gc.collect_cycles(world);
+		}
+
+		WHEN("the cycle becomes unreachable")
+		{
+			first = nullptr;
+			second = nullptr;
+			outside = nullptr;
+
+			THEN("a regular sweep leaks it, but a cycle collection frees it")
+			{
+				gc.collect();
+				REQUIRE(tracked::alive == 2);
+
+				REQUIRE(gc.collect_cycles(world) == 2);
+				REQUIRE(tracked::alive == 0);
+			}
+		}
+	}
+}
+
+SCENARIO("small remote allocations share pages", "[mm][remote]")
+{
+	using ce2103::mm::at;
+	using ce2103::mm::allocation;
+	using ce2103::mm::drop_result;
+	using ce2103::mm::memory_manager;
+	using ce2103::mm::remote_manager;
+
+	initialize_library();
+
+	// Only remote managers pack allocations
+	if(memory_manager::get_default(at::any).get_locality() != at::remote)
+	{
+		return;
+	}
+
+	//! A packed allocation and the byte written to its payload
+	struct packed
+	{
+		std::size_t id;
+		std::size_t length;
+		allocation* header;
+		char        value;
+	};
+
+	auto& manager = remote_manager::get_instance();
+
+	auto allocate = [&manager](std::size_t length, char value)
+	{
+		auto [id, header, payload] = manager.allocate_of<char>(length, true);
+		*payload = value;
+
+		return packed{id, length, header, value};
+	};
+
+	GIVEN("small allocations of mixed sizes which fill several pages")
+	{
+		std::size_t pages = manager.get_packed_page_count();
+
+		// Each length falls in a different size class
+		const std::size_t lengths[] = {1, 40, 100, 180};
+
+		std::vector<packed> live;
+		for(std::size_t i = 0; i < 256; ++i)
+		{
+			live.push_back(allocate(lengths[i % 4], static_cast<char>(i)));
+		}
+
+		std::size_t full_pages = manager.get_packed_page_count();
+		REQUIRE(full_pages > pages);
+
+		WHEN("every other one of each size is freed and as many are allocated again")
+		{
+			std::vector<packed> kept;
+			std::vector<std::size_t> freed_lengths;
+			std::vector<const allocation*> freed;
+
+			// No page is left empty, since all of them hold blocks that remain
+			for(std::size_t i = 0; i < live.size(); ++i)
+			{
+				if(i / 4 % 2 == 0)
+				{
+					kept.push_back(live[i]);
+					continue;
+				}
+
+				freed_lengths.push_back(live[i].length);
+				freed.push_back(live[i].header);
+
+				REQUIRE(manager.drop(live[i].id) == drop_result::lost);
+			}
+
+			live = kept;
+
+			std::vector<const allocation*> reused;
+			for(std::size_t length : freed_lengths)
+			{
+				live.push_back(allocate(length, '\0'));
+				reused.push_back(live.back().header);
+			}
+
+			THEN("they take the freed blocks without new pages")
+			{
+				std::sort(freed.begin(), freed.end());
+				std::sort(reused.begin(), reused.end());
+
+				REQUIRE(reused == freed);
+				REQUIRE(manager.get_packed_page_count() == full_pages);
+			}
+
+			THEN("the contents of the others are kept")
+			{
+				for(const auto& object : kept)
+				{
+					REQUIRE(*static_cast<char*>(object.header->get_payload_base()) == object.value);
+				}
+			}
+		}
+
+		WHEN("an allocation is lifted and then dropped once")
+		{
+			auto copied = live.front();
+
+			manager.lift(copied.id);
+			REQUIRE(manager.drop(copied.id) == drop_result::reduced);
+
+			live.push_back(allocate(copied.length, '\0'));
+
+			THEN("its block is neither freed nor reused")
+			{
+				REQUIRE(live.back().header != copied.header);
+				REQUIRE(*static_cast<char*>(copied.header->get_payload_base()) == copied.value);
+			}
+		}
+
+		WHEN("all of them are freed")
+		{
+			for(const auto& object : live)
+			{
+				REQUIRE(manager.drop(object.id) == drop_result::lost);
+			}
+
+			live.clear();
+
+			THEN("the pages which they filled are released")
+			{
+				REQUIRE(manager.get_packed_page_count() == pages);
+			}
+		}
+
+		for(const auto& object : live)
+		{
+			manager.drop(object.id);
+		}
+	}
+}
+
+SCENARIO("large remote allocations are paged in chunks", "[mm][remote]")
+{
+	using ce2103::mm::at;
+	using ce2103::mm::allocation;
+	using ce2103::mm::drop_result;
+	using ce2103::mm::memory_manager;
+	using ce2103::mm::remote_manager;
+
+	initialize_library();
+	if(memory_manager::get_default(at::any).get_locality() != at::remote)
+	{
+		return;
+	}
+
+	auto& manager = remote_manager::get_instance();
+
+	auto allocate = [&manager](std::size_t length)
+	{
+		auto [id, header, payload] = manager.allocate_of<char>(length, true);
+		return std::make_pair(id, header);
+	};
+
+	auto address_of = [](const allocation* header)
+	{
+		return reinterpret_cast<std::uintptr_t>(header);
+	};
+
+	auto payload_of = [](allocation* header)
+	{
+		return static_cast<char*>(header->get_payload_base());
+	};
+
+	GIVEN("large allocations of one, two and one chunks, in that order")
+	{
+		auto first = allocate(LARGE_THRESHOLD);
+		auto second = allocate(CHUNK_SIZE + LARGE_THRESHOLD);
+		auto third = allocate(LARGE_THRESHOLD + LARGE_THRESHOLD / 2);
+
+		std::vector<std::size_t> live{first.first, second.first, third.first};
+
+		// Nothing else is allocated in chunks, so they are placed one after another
+		REQUIRE(address_of(second.second) == address_of(first.second) + CHUNK_SIZE);
+		REQUIRE(address_of(third.second) == address_of(second.second) + 2 * CHUNK_SIZE);
+
+		WHEN("one of them is freed and another one of the same size is allocated")
+		{
+			REQUIRE(manager.drop(second.first) == drop_result::lost);
+			live[1] = allocate(CHUNK_SIZE + LARGE_THRESHOLD).first;
+
+			THEN("its chunks are reused")
+			{
+				REQUIRE(address_of(&manager.get_base_of(live[1])) == address_of(second.second));
+			}
+		}
+
+		WHEN("two adjacent ones are freed and a larger one is allocated")
+		{
+			REQUIRE(manager.drop(second.first) == drop_result::lost);
+			REQUIRE(manager.drop(first.first) == drop_result::lost);
+
+			live = {third.first, allocate(2 * CHUNK_SIZE + LARGE_THRESHOLD).first};
+
+			THEN("it takes their coalesced chunks")
+			{
+				REQUIRE(address_of(&manager.get_base_of(live[1])) == address_of(first.second));
+			}
+		}
+
+		WHEN("their chunks are written and then evicted by others")
+		{
+			char* contents = payload_of(second.second);
+			for(std::size_t offset = 0; offset < CHUNK_SIZE + LARGE_THRESHOLD; offset += 4096)
+			{
+				contents[offset] = static_cast<char>(offset / 4096);
+			}
+
+			// Twice the default number of resident chunks, so that all of them are replaced
+			auto evicting = allocate(32 * CHUNK_SIZE);
+			live.push_back(evicting.first);
+
+			char* filler = payload_of(evicting.second);
+			for(std::size_t offset = 0; offset < 32 * CHUNK_SIZE; offset += CHUNK_SIZE)
+			{
+				filler[offset] = 1;
+			}
+
+			THEN("their contents are fetched again")
+			{
+				bool intact = true;
+				for(std::size_t offset = 0; offset < CHUNK_SIZE + LARGE_THRESHOLD; offset += 4096)
+				{
+					intact = intact && contents[offset] == static_cast<char>(offset / 4096);
+				}
+
+				REQUIRE(intact);
+			}
+		}
+
+		WHEN("an allocation below the threshold is paged in parts")
+		{
+			auto paged = allocate(LARGE_THRESHOLD / 2);
+			live.push_back(paged.first);
+
+			THEN("all of its parts have a page below the chunks")
+			{
+				std::size_t capacity = manager.get_part_capacity();
+				std::size_t parts = (paged.second->get_total_size() - 1) / 4096 + 1;
+
+				REQUIRE(paged.first + parts <= capacity);
+				REQUIRE(address_of(&manager.get_base_of(capacity - 1)) + 4096 <= address_of(first.second));
+			}
+		}
+
+		for(std::size_t id : live)
+		{
+			REQUIRE(manager.drop(id) == drop_result::lost);
+		}
+	}
+}